@@ -0,0 +1,85 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+ /**
+ * @file    bench/bench.h
+ * @brief   Timing and input helpers shared by the benchmarks
+ * @{
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+//Monotonic clock in nanoseconds
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+//xorshift32, deterministic inputs across runs
+static inline uint32_t bench_rand(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static inline float bench_randf(uint32_t *state, float lo, float hi)
+{
+    return lo + (hi - lo) * (float)(bench_rand(state) >> 8) / (float)(1u << 24);
+}
+
+//Spread of repeated timings, all in ns per operation
+typedef struct {
+    double min;
+    double median;
+    double mean;
+    double p95;
+    double stddev;
+} bench_stats_s;
+
+static inline int bench_cmp_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+//Sorts samples in place, percentiles by nearest rank
+static inline void bench_summarize(double *samples, uint32_t n, bench_stats_s *stats)
+{
+    double sum = 0, sq = 0;
+    uint32_t i;
+
+    qsort(samples, n, sizeof(double), bench_cmp_double);
+    for (i = 0; i < n; i++) {
+        sum += samples[i];
+    }
+    stats->mean = sum / n;
+    for (i = 0; i < n; i++) {
+        sq += (samples[i] - stats->mean) * (samples[i] - stats->mean);
+    }
+    stats->min = samples[0];
+    stats->median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    stats->p95 = samples[(uint32_t)ceil(0.95 * n) - 1];
+    stats->stddev = n > 1 ? sqrt(sq / (n - 1)) : 0;
+}
+
+//Keeps results alive so the timed loops are not optimized away
+extern volatile uint32_t bench_sink;
+
+#endif //BENCH_H
+
+ /** @} */
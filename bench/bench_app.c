@@ -0,0 +1,67 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Methods the library expects from the application. The benchmarks call
+ * the evaluation paths with their own inputs, these only have to link,
+ * except for signing, which flight log benchmarks time.
+ */
+
+#include <npnt.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+
+uint64_t npnt_utc_time()
+{
+    return 0;
+}
+
+int8_t npnt_abs_position(float *gps_lat, float *gps_lon, float *altitude_agl)
+{
+    (void)gps_lat;
+    (void)gps_lon;
+    (void)altitude_agl;
+    return -1;
+}
+
+int8_t npnt_log_write(const npnt_breach_snapshot_s *records, uint32_t count)
+{
+    (void)records;
+    (void)count;
+    return 0;
+}
+
+//RSA-SHA1 with a throwaway key made on first use, so signing can be timed
+int8_t npnt_sign_raw_data(npnt_s *handle, uint8_t* raw_data, uint16_t raw_data_len, uint8_t* signature, uint16_t* signature_len)
+{
+    static EVP_PKEY* key;
+    EVP_PKEY_CTX* ctx;
+    size_t len = *signature_len;
+    int ok;
+
+    (void)handle;
+    if (!key) {
+        ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+        if (ctx && EVP_PKEY_keygen_init(ctx) > 0 && EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) > 0) {
+            EVP_PKEY_keygen(ctx, &key);
+        }
+        EVP_PKEY_CTX_free(ctx);
+        if (!key) {
+            return -1;
+        }
+    }
+    ctx = EVP_PKEY_CTX_new(key, NULL);
+    ok = ctx && EVP_PKEY_sign_init(ctx) > 0 &&
+         EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) > 0 &&
+         EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha1()) > 0 &&
+         EVP_PKEY_sign(ctx, signature, &len, raw_data, raw_data_len) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    if (!ok) {
+        return -1;
+    }
+    *signature_len = (uint16_t)len;
+    return 0;
+}
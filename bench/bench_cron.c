@@ -0,0 +1,263 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Recurring window checks, compiled cron bitsets against a naive iterator
+ * stepping one second at a time through npnt_cron_match:
+ *   window naive    scan back over the window duration for a start
+ *   window prev     npnt_cron_prev plus one compare
+ *   window cached   npnt_recurrence_window on a 400 Hz sample stream
+ *   next naive      scan forward for the next start, capped at one day
+ *   next compiled   npnt_cron_next
+ * Before timing, every compiled answer is checked against a reference
+ * matcher written by hand for each expression, which reads the IST wall
+ * clock from gmtime_r and never touches the compiled bitsets: window
+ * verdicts for all queries and every 4000th stream sample, next starts
+ * for every 10th query within the naive cap. Any disagreement fails the
+ * run.
+ */
+
+#include <npnt_internal.h>
+#include <time.h>
+#include "bench.h"
+
+#define BENCH_QUERIES       2000
+#define BENCH_SAMPLES       2000000
+#define BENCH_NAIVE_CAP     86400
+#define BENCH_EPOCH         1700000000
+
+volatile uint32_t bench_sink;
+
+typedef bool (*bench_ref_fn)(const struct tm *tm);
+
+static bool on_minute(const struct tm *tm, int hour, int minute)
+{
+    return tm->tm_sec == 0 && tm->tm_min == minute && (hour < 0 || tm->tm_hour == hour);
+}
+
+static int month_days(const struct tm *tm)
+{
+    static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int year = tm->tm_year + 1900;
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return days[tm->tm_mon] + (tm->tm_mon == 1 && leap);
+}
+
+//0 */15 * * * ?
+static bool ref_quarter_hour(const struct tm *tm)
+{
+    return tm->tm_sec == 0 && tm->tm_min % 15 == 0;
+}
+
+//0 0 6 ? * MON-FRI
+static bool ref_weekday_morning(const struct tm *tm)
+{
+    return on_minute(tm, 6, 0) && tm->tm_wday >= 1 && tm->tm_wday <= 5;
+}
+
+//0 30 9 L * ?
+static bool ref_last_day(const struct tm *tm)
+{
+    return on_minute(tm, 9, 30) && tm->tm_mday == month_days(tm);
+}
+
+//0 0 12 ? * 6#2 2024-2030, Quartz day 6 is Friday
+static bool ref_second_friday(const struct tm *tm)
+{
+    return on_minute(tm, 12, 0) && tm->tm_wday == 5 && (tm->tm_mday - 1) / 7 == 1 &&
+           tm->tm_year + 1900 >= 2024 && tm->tm_year + 1900 <= 2030;
+}
+
+static const struct {
+    const char* expr;
+    uint32_t minutes;
+    bench_ref_fn ref;
+} schedules[] = {
+    {"0 */15 * * * ?", 5, ref_quarter_hour},
+    {"0 0 6 ? * MON-FRI", 120, ref_weekday_morning},
+    {"0 30 9 L * ?", 60, ref_last_day},
+    {"0 0 12 ? * 6#2 2024-2030", 240, ref_second_friday},
+};
+
+static bool ref_match(bench_ref_fn ref, int64_t t)
+{
+    time_t local = (time_t)(t + NPNT_IST_OFFSET);
+    struct tm tm;
+    gmtime_r(&local, &tm);
+    return ref(&tm);
+}
+
+static bool ref_inside(bench_ref_fn ref, uint32_t duration, int64_t t)
+{
+    uint32_t k;
+    for (k = 0; k < duration; k++) {
+        if (ref_match(ref, t - k)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int64_t ref_next(bench_ref_fn ref, int64_t t)
+{
+    uint32_t k;
+    for (k = 0; k < BENCH_NAIVE_CAP; k++) {
+        if (ref_match(ref, t + k)) {
+            return t + k;
+        }
+    }
+    return -1;
+}
+
+static bool naive_inside(const npnt_cron_s *cron, uint32_t duration, int64_t t)
+{
+    uint32_t k;
+    for (k = 0; k < duration; k++) {
+        if (npnt_cron_match(cron, t - k)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int64_t naive_next(const npnt_cron_s *cron, int64_t t)
+{
+    uint32_t k;
+    for (k = 0; k < BENCH_NAIVE_CAP; k++) {
+        if (npnt_cron_match(cron, t + k)) {
+            return t + k;
+        }
+    }
+    return -1;
+}
+
+static bool same_next(int64_t ref, int64_t compiled, int64_t t)
+{
+    if (ref >= 0) {
+        return compiled == ref;
+    }
+    //reference gave up, compiled must not have found anything inside the cap
+    return compiled < 0 || compiled >= t + BENCH_NAIVE_CAP;
+}
+
+static uint32_t check_schedule(npnt_s *handle, const char* expr, bench_ref_fn ref, const int64_t* times, uint32_t duration)
+{
+    const npnt_cron_s *cron = &handle->permit.info->cron;
+    uint32_t i, errors = 0;
+    int64_t t, prev, next_start;
+    bool expect, inside;
+    int8_t cached;
+
+    for (i = 0; i < BENCH_QUERIES; i++) {
+        t = times[i];
+        expect = ref_inside(ref, duration, t);
+        prev = npnt_cron_prev(cron, t);
+        inside = prev >= 0 && t < prev + duration;
+        cached = npnt_recurrence_window(handle, t, &next_start);
+        if (inside != expect || cached != (int8_t)expect) {
+            printf("%s: window at %lld reference %d prev %d cached %d\n", expr, (long long)t, expect, inside, cached);
+            errors++;
+        }
+        if (i % 10) {
+            continue;
+        }
+        if (!same_next(ref_next(ref, t), npnt_cron_next(cron, t), t)) {
+            printf("%s: next at %lld reference %lld compiled %lld\n", expr, (long long)t,
+                   (long long)ref_next(ref, t), (long long)npnt_cron_next(cron, t));
+            errors++;
+        }
+        //window cache reports the next start strictly after t
+        if (!same_next(ref_next(ref, t + 1), next_start, t + 1)) {
+            printf("%s: cached next at %lld reference %lld cached %lld\n", expr, (long long)t,
+                   (long long)ref_next(ref, t + 1), (long long)next_start);
+            errors++;
+        }
+    }
+
+    //the stream keeps the cache warm, its edges are what can go wrong
+    for (i = 0; i < BENCH_SAMPLES; i++) {
+        t = times[0] + i / 400;
+        cached = npnt_recurrence_window(handle, t, NULL);
+        prev = npnt_cron_prev(cron, t);
+        inside = prev >= 0 && t < prev + duration;
+        if (cached != (int8_t)inside || (i % 4000 == 0 && ref_inside(ref, duration, t) != inside)) {
+            printf("%s: stream at %lld prev %d cached %d\n", expr, (long long)t, inside, cached);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+int main(void)
+{
+    npnt_s handle;
+    npnt_permit_info_s info;
+    int64_t times[BENCH_QUERIES], t;
+    uint64_t start;
+    double t_naive, t_prev, t_cached, t_next_naive, t_next;
+    uint32_t s, i, duration, seed = 0x9E3779B9u, hits, errors = 0;
+
+    for (i = 0; i < BENCH_QUERIES; i++) {
+        times[i] = BENCH_EPOCH + (int64_t)(bench_rand(&seed) % (365 * 86400));
+    }
+    printf("%-28s %14s %14s %14s %14s %14s\n", "expression", "window naive", "window prev",
+           "window cached", "next naive", "next compiled");
+    for (s = 0; s < sizeof(schedules)/sizeof(schedules[0]); s++) {
+        npnt_init_handle(&handle);
+        handle.permit.info = &info;
+        if (npnt_cron_compile(&handle.permit.info->cron, schedules[s].expr, NPNT_IST_OFFSET) < 0) {
+            printf("compile failed: %s\n", schedules[s].expr);
+            return 1;
+        }
+        duration = schedules[s].minutes * 60;
+        handle.permit.window_len = duration;
+        handle.rcu.active = &handle.permit;
+        errors += check_schedule(&handle, schedules[s].expr, schedules[s].ref, times, duration);
+
+        hits = 0;
+        start = bench_now_ns();
+        for (i = 0; i < BENCH_QUERIES; i++) {
+            hits += naive_inside(&handle.permit.info->cron, duration, times[i]);
+        }
+        t_naive = (double)(bench_now_ns() - start) / BENCH_QUERIES;
+
+        start = bench_now_ns();
+        for (i = 0; i < BENCH_QUERIES; i++) {
+            t = npnt_cron_prev(&handle.permit.info->cron, times[i]);
+            hits += t >= 0 && times[i] < t + duration;
+        }
+        t_prev = (double)(bench_now_ns() - start) / BENCH_QUERIES;
+
+        //control loop: 400 samples per second of GPS time
+        start = bench_now_ns();
+        for (i = 0; i < BENCH_SAMPLES; i++) {
+            hits += npnt_recurrence_window(&handle, times[0] + i / 400, NULL) == 1;
+        }
+        t_cached = (double)(bench_now_ns() - start) / BENCH_SAMPLES;
+
+        start = bench_now_ns();
+        for (i = 0; i < BENCH_QUERIES / 20; i++) {
+            hits += naive_next(&handle.permit.info->cron, times[i]) >= 0;
+        }
+        t_next_naive = (double)(bench_now_ns() - start) / (BENCH_QUERIES / 20);
+
+        start = bench_now_ns();
+        for (i = 0; i < BENCH_QUERIES; i++) {
+            hits += npnt_cron_next(&handle.permit.info->cron, times[i]) >= 0;
+        }
+        t_next = (double)(bench_now_ns() - start) / BENCH_QUERIES;
+
+        bench_sink += hits;
+        printf("%-28s %11.1f ns %11.1f ns %11.1f ns %11.1f ns %11.1f ns\n", schedules[s].expr,
+               t_naive, t_prev, t_cached, t_next_naive, t_next);
+    }
+    printf("next naive gives up after %u s\n", BENCH_NAIVE_CAP);
+    if (errors) {
+        printf("%u compiled answers disagree with the reference matchers\n", errors);
+        return 1;
+    }
+    return 0;
+}
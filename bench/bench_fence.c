@@ -0,0 +1,277 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Fence containment cost per query, convex against concave fences at
+ * several vertex counts:
+ *   pnpoly      O(n) crossing count
+ *   grid        indexed zone test with the fan search turned off
+ *   fan         O(log n) fan search forced on, convex fences only
+ *   auto        fan search or grid as picked at load time
+ *   raster      auto path behind the default raster mask
+ * Fences go through npnt_fence_normalize like loaded ones. Before timing,
+ * every path's verdict is checked against pnpoly for every query, only
+ * points within NPNT_FENCE_EPS of an edge may differ, and self
+ * intersecting fences must be rejected. Any failure fails the run.
+ * The table reports ns per query, the JSON file given as argument holds
+ * the same numbers with the fan column null on concave fences.
+ *
+ * Usage: bench_fence [results.json]
+ */
+
+#include <npnt_internal.h>
+#include <fence_iface.h>
+#include <math.h>
+#include "bench.h"
+
+#define BENCH_QUERIES       200000
+#define BENCH_RADIUS        1000.0f
+
+volatile uint32_t bench_sink;
+
+static const uint32_t vertex_counts[] = {4, 8, 32, 128, 512, 2048};
+
+#define NCOUNTS (sizeof(vertex_counts)/sizeof(vertex_counts[0]))
+
+typedef struct {
+    bool concave;
+    uint32_t nverts;
+    double pnpoly, grid, fan, autoq, raster;    //ns per query, fan unset on concave fences
+} result_s;
+
+/*
+ * Regular polygon. The concave variant is a star with every other vertex
+ * pulled in, quads become a dart with vertex 0 pulled past the center.
+ */
+static void make_fence(float* x, float* y, uint32_t n, bool concave)
+{
+    uint32_t i;
+    float a, r;
+    for (i = 0; i < n; i++) {
+        a = 2 * (float)M_PI * i / n;
+        r = BENCH_RADIUS;
+        if (concave && n < 8) {
+            r = i == 0 ? -BENCH_RADIUS / 4 : BENCH_RADIUS;
+        } else if (concave && (i & 1)) {
+            r = BENCH_RADIUS / 2;
+        }
+        x[i] = r * cosf(a);
+        y[i] = r * sinf(a);
+    }
+}
+
+static int8_t make_set(npnt_fence_set_s *set, const float* x, const float* y, uint32_t n, uint32_t raster_bytes)
+{
+    int8_t ret;
+    float *vx = (float*)npnt_malloc(n*sizeof(float));
+    float *vy = (float*)npnt_malloc(n*sizeof(float));
+    if (!vx || !vy) {
+        npnt_free(vx);
+        npnt_free(vy);
+        return -1;
+    }
+    memcpy(vx, x, n*sizeof(float));
+    memcpy(vy, y, n*sizeof(float));
+    memset(set, 0, sizeof(npnt_fence_set_s));
+    set->raster_custom = true;
+    set->raster_max_bytes = raster_bytes;
+    ret = npnt_fence_normalize(vx, vy, NULL, NULL, &n);
+    if (ret < 0 || npnt_fence_set_add(set, NPNT_ZONE_INCLUDE, 0, vx, vy, n) < 0) {
+        npnt_free(vx);
+        npnt_free(vy);
+        return ret < 0 ? ret : -1;
+    }
+    return npnt_fence_set_build(set);
+}
+
+//Disagreements with pnpoly are only tolerated on the boundary, where float rounding decides
+static bool near_edge(const float* x, const float* y, uint32_t n, float px, float py)
+{
+    uint32_t i;
+    for (i = 0; i < n; i++) {
+        if (npnt_seg_dist_sq(px, py, x[i], y[i], x[(i + 1) % n], y[(i + 1) % n]) < NPNT_FENCE_EPS * NPNT_FENCE_EPS) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t check_set(const char* path, const npnt_fence_set_s *set, float* x, float* y, uint32_t n,
+                          const float* qx, const float* qy)
+{
+    uint32_t i, errors = 0;
+    bool inside;
+
+    for (i = 0; i < BENCH_QUERIES; i++) {
+        inside = npnt_fence_set_query(set, qx[i], qy[i], NULL) == NPNT_FENCE_INSIDE;
+        if (inside != npnt_pnpoly(n, x, y, qx[i], qy[i]) && !near_edge(x, y, n, qx[i], qy[i])) {
+            if (errors++ < 4) {
+                printf("%s, %u vertices: (%.3f, %.3f) %s, pnpoly disagrees\n", path, n, qx[i], qy[i],
+                       inside ? "inside" : "outside");
+            }
+        }
+    }
+    return errors;
+}
+
+//Bowtie, and a star whose points are joined every second vertex, both cross themselves
+static uint32_t check_self_intersecting(void)
+{
+    static const float bow_x[] = {0, BENCH_RADIUS, BENCH_RADIUS, 0};
+    static const float bow_y[] = {0, BENCH_RADIUS, 0, BENCH_RADIUS};
+    npnt_fence_set_s set;
+    float star_x[5], star_y[5];
+    uint32_t i, errors = 0;
+    int8_t ret;
+
+    for (i = 0; i < 5; i++) {
+        star_x[i] = BENCH_RADIUS * cosf(4 * (float)M_PI * i / 5);
+        star_y[i] = BENCH_RADIUS * sinf(4 * (float)M_PI * i / 5);
+    }
+    ret = make_set(&set, bow_x, bow_y, 4, 0);
+    if (ret != NPNT_BAD_FENCE) {
+        printf("bowtie fence loaded with %d\n", ret);
+        errors++;
+    }
+    npnt_fence_set_free(&set);
+    ret = make_set(&set, star_x, star_y, 5, 0);
+    if (ret != NPNT_BAD_FENCE) {
+        printf("pentagram fence loaded with %d\n", ret);
+        errors++;
+    }
+    npnt_fence_set_free(&set);
+    return errors;
+}
+
+static double time_pnpoly(float* x, float* y, uint32_t n, const float* qx, const float* qy)
+{
+    uint64_t start = bench_now_ns();
+    uint32_t i, hits = 0;
+    for (i = 0; i < BENCH_QUERIES; i++) {
+        hits += npnt_pnpoly(n, x, y, qx[i], qy[i]);
+    }
+    bench_sink += hits;
+    return (double)(bench_now_ns() - start) / BENCH_QUERIES;
+}
+
+static double time_set(const npnt_fence_set_s *set, const float* qx, const float* qy)
+{
+    uint64_t start = bench_now_ns();
+    uint32_t i, hits = 0;
+    for (i = 0; i < BENCH_QUERIES; i++) {
+        hits += npnt_fence_set_query(set, qx[i], qy[i], NULL) == NPNT_FENCE_INSIDE;
+    }
+    bench_sink += hits;
+    return (double)(bench_now_ns() - start) / BENCH_QUERIES;
+}
+
+static void write_json(FILE* fp, const result_s* results, uint32_t n)
+{
+    char fan[32];
+    uint32_t i;
+
+    fprintf(fp, "{\"queries\":%u,\"radius_m\":%.1f,\"unit\":\"ns/query\",\"results\":[", BENCH_QUERIES,
+            BENCH_RADIUS);
+    for (i = 0; i < n; i++) {
+        if (results[i].concave) {
+            snprintf(fan, sizeof(fan), "null");
+        } else {
+            snprintf(fan, sizeof(fan), "%.1f", results[i].fan);
+        }
+        fprintf(fp, "%s{\"shape\":\"%s\",\"nverts\":%u,\"pnpoly\":%.1f,\"grid\":%.1f,\"fan\":%s,"
+                "\"auto\":%.1f,\"raster\":%.1f}", i ? "," : "", results[i].concave ? "concave" : "convex",
+                results[i].nverts, results[i].pnpoly, results[i].grid, fan, results[i].autoq, results[i].raster);
+    }
+    fprintf(fp, "]}\n");
+}
+
+int main(int argc, char** argv)
+{
+    npnt_fence_set_s exact, cached;
+    result_s results[2 * NCOUNTS], *r;
+    float *x, *y, *qx, *qy;
+    char fan[16];
+    uint32_t c, i, n, nresults = 0, seed = 0x2545F491u, errors;
+    bool concave, picked;
+    FILE* fp;
+
+    qx = (float*)malloc(BENCH_QUERIES*sizeof(float));
+    qy = (float*)malloc(BENCH_QUERIES*sizeof(float));
+    x = (float*)malloc(vertex_counts[NCOUNTS - 1]*sizeof(float));
+    y = (float*)malloc(vertex_counts[NCOUNTS - 1]*sizeof(float));
+    if (!qx || !qy || !x || !y) {
+        return 1;
+    }
+    //samples over 1.2x the fence bounds, about half of them inside
+    for (i = 0; i < BENCH_QUERIES; i++) {
+        qx[i] = bench_randf(&seed, -1.2f * BENCH_RADIUS, 1.2f * BENCH_RADIUS);
+        qy[i] = bench_randf(&seed, -1.2f * BENCH_RADIUS, 1.2f * BENCH_RADIUS);
+    }
+
+    errors = check_self_intersecting();
+    printf("%-8s %6s %12s %12s %12s %12s %12s\n", "shape", "nverts", "pnpoly", "grid", "fan", "auto", "raster");
+    for (c = 0; c < 2; c++) {
+        concave = c == 1;
+        for (i = 0; i < NCOUNTS; i++) {
+            n = vertex_counts[i];
+            make_fence(x, y, n, concave);
+            if (make_set(&exact, x, y, n, 0) < 0 || make_set(&cached, x, y, n, NPNT_RASTER_MAX_BYTES) < 0) {
+                printf("fence setup failed\n");
+                return 1;
+            }
+            picked = exact.zones[0].convex;
+            errors += check_set("auto", &exact, x, y, n, qx, qy);
+            exact.zones[0].convex = false;
+            errors += check_set("grid", &exact, x, y, n, qx, qy);
+            if (!concave) {
+                exact.zones[0].convex = true;
+                errors += check_set("fan", &exact, x, y, n, qx, qy);
+            }
+            exact.zones[0].convex = picked;
+            errors += check_set("raster", &cached, x, y, n, qx, qy);
+
+            r = &results[nresults++];
+            r->concave = concave;
+            r->nverts = n;
+            r->pnpoly = time_pnpoly(x, y, n, qx, qy);
+            r->autoq = time_set(&exact, qx, qy);
+            exact.zones[0].convex = false;
+            r->grid = time_set(&exact, qx, qy);
+            r->fan = 0;
+            snprintf(fan, sizeof(fan), "-");
+            if (!concave) {
+                exact.zones[0].convex = true;
+                r->fan = time_set(&exact, qx, qy);
+                snprintf(fan, sizeof(fan), "%9.1f ns", r->fan);
+            }
+            exact.zones[0].convex = picked;
+            r->raster = time_set(&cached, qx, qy);
+            printf("%-8s %6u %9.1f ns %9.1f ns %12s %9.1f ns %9.1f ns\n", concave ? "concave" : "convex", n,
+                   r->pnpoly, r->grid, fan, r->autoq, r->raster);
+            npnt_fence_set_free(&exact);
+            npnt_fence_set_free(&cached);
+        }
+    }
+    free(qx);
+    free(qy);
+    free(x);
+    free(y);
+    if (errors) {
+        printf("%u fence verdicts wrong\n", errors);
+        return 1;
+    }
+
+    if (argc > 1) {
+        fp = fopen(argv[1], "w");
+        if (!fp) {
+            printf("cannot write %s\n", argv[1]);
+            return 1;
+        }
+        write_json(fp, results, nresults);
+        fclose(fp);
+    }
+    return 0;
+}
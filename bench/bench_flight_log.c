@@ -0,0 +1,231 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Flight log signing, linear chain against Merkle batches, on logs of
+ * multi-hour flights with a record every 100 ms:
+ *   append     npnt_flight_log_append, chain plus batch tree upkeep
+ *   sign       npnt_flight_log_sign once, or npnt_flight_log_sign_batch
+ *              for every batch, RSA-2048 through bench_app.c
+ *   check one  what a verifier rehashes for a single record: the whole
+ *              chain on reopen, or npnt_flight_log_verify_proof
+ *   proof      npnt_flight_log_proof on the logging side
+ *
+ * Appending runs BENCH_REPS times per log, on a fresh file each time. The
+ * table reports the median, the JSON file given as argument all numbers.
+ *
+ * Usage: bench_flight_log [results.json]
+ */
+
+#include <npnt_internal.h>
+#include <npnt.h>
+#include <unistd.h>
+#include "bench.h"
+
+#define BENCH_REPS          5
+#define BENCH_PROOFS        256
+#define BENCH_RATE_HZ       10
+#define BENCH_LOG_FILE      "bench_flight_log.flog"
+
+volatile uint32_t bench_sink;
+
+static const uint32_t hours[] = {1, 4, 8};
+static const uint32_t batches[] = {0, 256, 1024, 4096};
+
+#define NHOURS              (sizeof(hours) / sizeof(hours[0]))
+#define NBATCHES            (sizeof(batches) / sizeof(batches[0]))
+
+typedef struct {
+    uint32_t hours;
+    uint32_t batch;
+    uint32_t records;
+    bench_stats_s append;       //ns per record
+    uint32_t signatures;
+    double sign_ms;             //all signatures of the log
+    double check_us;            //single record check by a verifier
+    double proof_us;            //building one proof
+    uint32_t proof_bytes;
+} result_s;
+
+static int8_t fill_log(npnt_flight_log_s* log, uint32_t records, uint32_t batch, double* ns_per_record)
+{
+    npnt_breach_snapshot_s snapshot;
+    uint32_t state = 0x9e3779b9, i;
+    uint64_t t0;
+
+    unlink(BENCH_LOG_FILE);
+    if (npnt_flight_log_open(log, BENCH_LOG_FILE, records, batch, NULL) < 0) {
+        return -1;
+    }
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.utc_time = 1700000000000ull;
+    t0 = bench_now_ns();
+    for (i = 0; i < records; i++) {
+        snapshot.utc_time += 1000 / BENCH_RATE_HZ;
+        snapshot.lat = bench_randf(&state, 12.9f, 13.0f);
+        snapshot.lon = bench_randf(&state, 77.5f, 77.6f);
+        snapshot.altitude = bench_randf(&state, 0.0f, 120.0f);
+        snapshot.breach = bench_rand(&state) & NPNT_LOG_TRACK;
+        npnt_flight_log_append(log, i == 0 ? NPNT_FLOG_ARM : i + 1 == records ? NPNT_FLOG_DISARM :
+                               NPNT_FLOG_BREACH, &snapshot);
+    }
+    *ns_per_record = (double)(bench_now_ns() - t0) / records;
+    return 0;
+}
+
+static int8_t run_case(uint32_t h, uint32_t batch, result_s* result)
+{
+    npnt_flight_log_s log;
+    npnt_flight_proof_s proof;
+    double samples[BENCH_REPS];
+    uint8_t signature[512], root[NPNT_FLOG_HASH_LEN];
+    uint16_t signature_len;
+    uint32_t state = 12345, rep, i, seq;
+    uint64_t t0;
+
+    result->hours = h;
+    result->batch = batch;
+    result->records = h * 3600 * BENCH_RATE_HZ;
+    for (rep = 0; rep < BENCH_REPS; rep++) {
+        if (fill_log(&log, result->records, batch, &samples[rep]) < 0) {
+            return -1;
+        }
+        if (rep + 1 < BENCH_REPS) {
+            npnt_flight_log_close(&log);
+        }
+    }
+    bench_summarize(samples, BENCH_REPS, &result->append);
+
+    t0 = bench_now_ns();
+    if (batch == 0) {
+        signature_len = sizeof(signature);
+        if (npnt_flight_log_sign(NULL, &log, signature, &signature_len) < 0) {
+            goto fail;
+        }
+        result->signatures = 1;
+    } else {
+        result->signatures = (result->records + batch - 1) / batch;
+        for (i = 0; i < result->signatures; i++) {
+            signature_len = sizeof(signature);
+            if (npnt_flight_log_sign_batch(NULL, &log, i, signature, &signature_len) < 0) {
+                goto fail;
+            }
+        }
+    }
+    result->sign_ms = (double)(bench_now_ns() - t0) / 1e6;
+
+    if (batch == 0) {
+        //reopening rehashes the chain over every record
+        npnt_flight_log_close(&log);
+        t0 = bench_now_ns();
+        if (npnt_flight_log_open(&log, BENCH_LOG_FILE, 0, 0, NULL) < 0) {
+            return -1;
+        }
+        result->check_us = (double)(bench_now_ns() - t0) / 1e3;
+        result->proof_us = 0;
+        result->proof_bytes = 0;
+    } else {
+        double build = 0, check = 0;
+        uint32_t bytes = 0;
+
+        for (i = 0; i < BENCH_PROOFS; i++) {
+            seq = bench_rand(&state) % result->records;
+            t0 = bench_now_ns();
+            if (npnt_flight_log_proof(&log, seq, &proof) < 0) {
+                goto fail;
+            }
+            build += (double)(bench_now_ns() - t0);
+            npnt_flight_log_batch_root(&log, seq / batch, root);
+            t0 = bench_now_ns();
+            if (npnt_flight_log_verify_proof(&log.records[seq], &proof, root) < 0) {
+                goto fail;
+            }
+            check += (double)(bench_now_ns() - t0);
+            bytes += 3 * sizeof(uint32_t) + 1 + proof.depth * NPNT_FLOG_HASH_LEN;
+        }
+        result->proof_us = build / BENCH_PROOFS / 1e3;
+        result->check_us = check / BENCH_PROOFS / 1e3;
+        result->proof_bytes = bytes / BENCH_PROOFS;
+    }
+    npnt_flight_log_close(&log);
+    return 0;
+
+fail:
+    npnt_flight_log_close(&log);
+    return -1;
+}
+
+static void write_json(FILE* fp, const result_s* results, uint32_t n)
+{
+    uint32_t i;
+
+    fprintf(fp, "{\"rate_hz\":%u,\"reps\":%u,\"proofs\":%u,\"results\":[", BENCH_RATE_HZ, BENCH_REPS,
+            BENCH_PROOFS);
+    for (i = 0; i < n; i++) {
+        fprintf(fp, "%s{\"hours\":%u,\"batch\":%u,\"records\":%u,\"append_ns\":{\"min\":%.1f,\"median\":%.1f,"
+                "\"mean\":%.1f,\"p95\":%.1f,\"stddev\":%.1f},\"signatures\":%u,\"sign_ms\":%.3f,"
+                "\"sign_ns_per_record\":%.1f,\"check_one_us\":%.3f,\"proof_us\":%.3f,\"proof_bytes\":%u}",
+                i ? "," : "", results[i].hours, results[i].batch, results[i].records,
+                results[i].append.min, results[i].append.median, results[i].append.mean, results[i].append.p95,
+                results[i].append.stddev, results[i].signatures, results[i].sign_ms,
+                results[i].sign_ms * 1e6 / results[i].records, results[i].check_us, results[i].proof_us,
+                results[i].proof_bytes);
+    }
+    fprintf(fp, "]}\n");
+}
+
+int main(int argc, char** argv)
+{
+    result_s results[NHOURS * NBATCHES];
+    uint32_t n = 0, h, b;
+    char label[12];
+    FILE* fp;
+
+    //the signer makes its key on first use, keep that out of the timings
+    {
+        uint8_t digest[NPNT_FLOG_HASH_LEN] = {0}, signature[512];
+        uint16_t signature_len = sizeof(signature);
+
+        if (npnt_sign_raw_data(NULL, digest, sizeof(digest), signature, &signature_len) != 0) {
+            printf("signing failed\n");
+            return 1;
+        }
+    }
+    printf("%-5s %-6s %9s %12s %6s %10s %14s %12s %10s %7s\n", "hours", "batch", "records", "append",
+           "signs", "sign", "sign/record", "check one", "proof", "bytes");
+    for (h = 0; h < NHOURS; h++) {
+        for (b = 0; b < NBATCHES; b++) {
+            result_s* r = &results[n];
+
+            if (run_case(hours[h], batches[b], r) < 0) {
+                printf("flight log %u h batch %u failed\n", hours[h], batches[b]);
+                unlink(BENCH_LOG_FILE);
+                return 1;
+            }
+            if (r->batch) {
+                snprintf(label, sizeof(label), "%u", r->batch);
+            } else {
+                snprintf(label, sizeof(label), "chain");
+            }
+            printf("%-5u %-6s %9u %9.1f ns %6u %7.1f ms %11.1f ns %9.1f us %7.1f us %7u\n", r->hours,
+                   label, r->records, r->append.median, r->signatures, r->sign_ms,
+                   r->sign_ms * 1e6 / r->records, r->check_us, r->proof_us, r->proof_bytes);
+            n++;
+        }
+    }
+    unlink(BENCH_LOG_FILE);
+
+    if (argc > 1) {
+        fp = fopen(argv[1], "w");
+        if (!fp) {
+            printf("can't write %s\n", argv[1]);
+            return 1;
+        }
+        write_json(fp, results, n);
+        fclose(fp);
+    }
+    return 0;
+}
@@ -0,0 +1,471 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Artefact loading pipeline, one stage at a time on the test artefact:
+ *   base64 decode/encode   transport encoding of the whole artefact
+ *   mxmlLoadString         XML parse and tree release
+ *   canonical signedinfo   digest of SignedInfo as in npnt_verify_permart
+ *   canonical permission   digest of the permission as in npnt_verify_permart
+ *   check authenticity     RSA-SHA1 signature check
+ *   fence points           npnt_alloc_and_get_fence_points on the parsed tree
+ *   ist to unix time       npnt_ist_date_time_to_unix_time
+ *   pnpoly                 containment of points around the fence
+ *   set permart            all of the above through npnt_set_permart
+ *
+ * The artefact is signed by a key we do not hold, so its SignatureValue is
+ * replaced with one made by a throwaway RSA key whose public half is handed
+ * to the library as dgca_pubkey.pem for the run.
+ *
+ * Every stage runs a fixed number of warm-up batches, then BENCH_REPS timed
+ * batches of a fixed size. The table reports the spread over batches in ns
+ * per operation, the same numbers go to the JSON file given as argument.
+ *
+ * Usage: bench_pipeline [results.json] [artefact.xml]
+ */
+
+#include <npnt_internal.h>
+#include <npnt.h>
+#include <mxml.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include "bench.h"
+
+#define BENCH_REPS          31
+#define BENCH_WARMUP        3
+#define BENCH_POINTS        1024
+#define BENCH_ARTEFACT      "../test/permissionArtifact.xml"
+#define BENCH_KEY_FILE      "dgca_pubkey.pem"
+#define SIGNEDINFO_HEADER   "<SignedInfo xmlns=\"http://www.w3.org/2000/09/xmldsig#\">"
+
+volatile uint32_t bench_sink;
+
+typedef struct {
+    const char* name;
+    uint32_t (*run)(uint32_t iters);
+    uint32_t batch;
+} bench_case_s;
+
+//Inputs shared by the stages
+static char* xml;
+static uint32_t xml_len;
+static uint8_t* b64;
+static uint32_t b64_len;
+static const char* signed_info;
+static int32_t signedinfo_length;
+static const char* permission;
+static int32_t permission_length;
+static const char* sign_tail;
+static char digest[20];
+static uint8_t signature[512];
+static size_t signature_len;
+static npnt_s parsed;
+static npnt_permit_info_s parsed_info;
+static npnt_s scratch;
+static npnt_permit_info_s scratch_info;
+static const char* start_time;
+static float qx[BENCH_POINTS], qy[BENCH_POINTS];
+
+static uint32_t run_base64_decode(uint32_t iters)
+{
+    uint32_t i, hits = 0;
+    uint32_t len;
+    uint8_t* out;
+
+    for (i = 0; i < iters; i++) {
+        out = base64_decode(b64, b64_len, &len);
+        hits += len;
+        npnt_free(out);
+    }
+    return hits;
+}
+
+static uint32_t run_base64_encode(uint32_t iters)
+{
+    uint32_t i, hits = 0;
+    uint32_t len;
+    uint8_t* out;
+
+    for (i = 0; i < iters; i++) {
+        out = base64_encode((const uint8_t*)xml, xml_len, &len);
+        hits += len;
+        npnt_free(out);
+    }
+    return hits;
+}
+
+static uint32_t run_mxml_load(uint32_t iters)
+{
+    uint32_t i, hits = 0;
+    mxml_node_t* tree;
+
+    for (i = 0; i < iters; i++) {
+        tree = mxmlLoadString(NULL, xml, MXML_OPAQUE_CALLBACK);
+        hits += tree != NULL;
+        mxmlDelete(tree);
+    }
+    return hits;
+}
+
+static uint32_t run_canonical_signedinfo(uint32_t iters)
+{
+    uint32_t i, hits = 0;
+    char out[20];
+
+    for (i = 0; i < iters; i++) {
+        reset_sha1();
+        update_sha1(SIGNEDINFO_HEADER, strlen(SIGNEDINFO_HEADER));
+        npnt_digest_canonical(signed_info, signedinfo_length);
+        final_sha1(out);
+        hits += (uint8_t)out[0];
+    }
+    return hits;
+}
+
+static uint32_t run_canonical_permission(uint32_t iters)
+{
+    uint32_t i, hits = 0;
+    char out[20];
+
+    for (i = 0; i < iters; i++) {
+        reset_sha1();
+        npnt_digest_canonical(permission, permission_length);
+        update_sha1(sign_tail, strlen(sign_tail));
+        final_sha1(out);
+        hits += (uint8_t)out[0];
+    }
+    return hits;
+}
+
+static uint32_t run_check_authenticity(uint32_t iters)
+{
+    uint32_t i, hits = 0;
+
+    for (i = 0; i < iters; i++) {
+        hits += npnt_check_authenticity(&parsed, (uint8_t*)digest, 20, signature, signature_len) > 0;
+    }
+    return hits;
+}
+
+static uint32_t run_fence_points(uint32_t iters)
+{
+    uint32_t i, hits = 0;
+
+    for (i = 0; i < iters; i++) {
+        hits += npnt_alloc_and_get_fence_points(&scratch, NULL, NULL);
+        npnt_free(scratch_info.vertlat);
+    }
+    return hits;
+}
+
+static uint32_t run_ist_time(uint32_t iters)
+{
+    uint32_t i, hits = 0;
+    int64_t t;
+    struct tm tm;
+
+    for (i = 0; i < iters; i++) {
+        hits += npnt_ist_date_time_to_unix_time(start_time, &t, &tm) == 0;
+        hits += (uint32_t)t;
+    }
+    return hits;
+}
+
+static uint32_t run_pnpoly(uint32_t iters)
+{
+    uint32_t i, hits = 0;
+
+    for (i = 0; i < iters; i++) {
+        hits += npnt_pnpoly(parsed_info.nverts, parsed_info.vertlat, parsed_info.vertlon,
+                            qx[i % BENCH_POINTS], qy[i % BENCH_POINTS]);
+    }
+    return hits;
+}
+
+static uint32_t run_set_permart(uint32_t iters)
+{
+    uint32_t i, hits = 0;
+    npnt_s handle;
+
+    for (i = 0; i < iters; i++) {
+        npnt_init_handle(&handle);
+        hits += npnt_set_permart(&handle, (uint8_t*)xml, xml_len, 0) == 0;
+        npnt_reset_handle(&handle);
+    }
+    return hits;
+}
+
+static const bench_case_s cases[] = {
+    {"base64_decode", run_base64_decode, 2000},
+    {"base64_encode", run_base64_encode, 2000},
+    {"mxmlLoadString", run_mxml_load, 200},
+    {"canonical signedinfo", run_canonical_signedinfo, 2000},
+    {"canonical permission", run_canonical_permission, 1000},
+    {"npnt_check_authenticity", run_check_authenticity, 100},
+    {"npnt_alloc_and_get_fence_points", run_fence_points, 2000},
+    {"npnt_ist_date_time_to_unix_time", run_ist_time, 20000},
+    {"npnt_pnpoly", run_pnpoly, 200000},
+    {"npnt_set_permart", run_set_permart, 100},
+};
+
+#define BENCH_CASES (sizeof(cases)/sizeof(cases[0]))
+
+static void run_case(const bench_case_s *c, bench_stats_s *stats)
+{
+    double samples[BENCH_REPS];
+    uint64_t start;
+    uint32_t r;
+
+    bench_sink += c->run(c->batch * BENCH_WARMUP);
+    for (r = 0; r < BENCH_REPS; r++) {
+        start = bench_now_ns();
+        bench_sink += c->run(c->batch);
+        samples[r] = (double)(bench_now_ns() - start) / c->batch;
+    }
+    bench_summarize(samples, BENCH_REPS, stats);
+}
+
+static char* read_file(const char* path, uint32_t* len)
+{
+    FILE* fp = fopen(path, "rb");
+    char* buf = NULL;
+    long size;
+
+    if (!fp) {
+        return NULL;
+    }
+    if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) > 0 && size < UINT32_MAX &&
+        fseek(fp, 0, SEEK_SET) == 0) {
+        buf = (char*)malloc(size + 1);
+        if (buf && fread(buf, 1, size, fp) == (size_t)size) {
+            buf[size] = '\0';
+            *len = (uint32_t)size;
+        } else {
+            free(buf);
+            buf = NULL;
+        }
+    }
+    fclose(fp);
+    return buf;
+}
+
+static EVP_PKEY* make_key(void)
+{
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+    EVP_PKEY* key = NULL;
+
+    if (ctx && EVP_PKEY_keygen_init(ctx) > 0 && EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) > 0) {
+        EVP_PKEY_keygen(ctx, &key);
+    }
+    EVP_PKEY_CTX_free(ctx);
+    return key;
+}
+
+//Same scheme npnt_check_authenticity verifies: PKCS#1 v1.5 over a SHA1 digest
+static int sign_digest(EVP_PKEY* key)
+{
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(key, NULL);
+    int ok;
+
+    signature_len = sizeof(signature);
+    ok = ctx && EVP_PKEY_sign_init(ctx) > 0 &&
+         EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) > 0 &&
+         EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha1()) > 0 &&
+         EVP_PKEY_sign(ctx, signature, &signature_len, (const uint8_t*)digest, 20) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    return ok;
+}
+
+//Digests SignedInfo, signs it and swaps the SignatureValue of xml for ours
+static int resign(void)
+{
+    EVP_PKEY* key;
+    FILE* fp;
+    char *open_tag, *close_tag, *out;
+    uint8_t* sig64;
+    uint32_t sig64_len;
+    size_t head, tail;
+
+    reset_sha1();
+    update_sha1(SIGNEDINFO_HEADER, strlen(SIGNEDINFO_HEADER));
+    npnt_digest_canonical(signed_info, signedinfo_length);
+    final_sha1(digest);
+
+    key = make_key();
+    if (!key || !sign_digest(key)) {
+        EVP_PKEY_free(key);
+        return 0;
+    }
+    fp = fopen(BENCH_KEY_FILE, "w");
+    if (!fp || !PEM_write_PUBKEY(fp, key)) {
+        if (fp) {
+            fclose(fp);
+        }
+        EVP_PKEY_free(key);
+        return 0;
+    }
+    fclose(fp);
+    EVP_PKEY_free(key);
+
+    //the library keeps the key once read, the file is not needed after the first check
+    if (npnt_check_authenticity(&parsed, (uint8_t*)digest, 20, signature, signature_len) <= 0) {
+        remove(BENCH_KEY_FILE);
+        return 0;
+    }
+    remove(BENCH_KEY_FILE);
+
+    open_tag = strstr(xml, "<SignatureValue>");
+    close_tag = strstr(xml, "</SignatureValue>");
+    if (!open_tag || !close_tag || close_tag < open_tag) {
+        return 0;
+    }
+    sig64 = base64_encode(signature, signature_len, &sig64_len);
+    if (!sig64) {
+        return 0;
+    }
+    head = open_tag + strlen("<SignatureValue>") - xml;
+    tail = xml_len - (close_tag - xml);
+    if (head + sig64_len + tail >= UINT32_MAX) {
+        npnt_free(sig64);
+        return 0;
+    }
+    out = (char*)malloc(head + sig64_len + tail + 1);
+    if (!out) {
+        npnt_free(sig64);
+        return 0;
+    }
+    memcpy(out, xml, head);
+    memcpy(out + head, sig64, sig64_len);
+    memcpy(out + head + sig64_len, close_tag, tail);
+    out[head + sig64_len + tail] = '\0';
+    npnt_free(sig64);
+    free(xml);
+    xml = out;
+    xml_len = (uint32_t)(head + sig64_len + tail);
+    return 1;
+}
+
+//Points the stages at the current artefact, a fresh tree included
+static int locate(void)
+{
+    char* end;
+
+    signed_info = strstr(xml, "<SignedInfo>");
+    end = strstr(xml, "<SignatureValue");
+    permission = strstr(xml, "<UAPermission>");
+    sign_tail = strstr(xml, "</Signature>");
+    if (!signed_info || !end || !permission || !sign_tail || end < signed_info) {
+        return 0;
+    }
+    signed_info += strlen("<SignedInfo>");
+    signedinfo_length = (int32_t)(end - signed_info);
+    permission_length = (int32_t)(strstr(xml, "<Signature") - permission);
+    sign_tail += strlen("</Signature>");
+
+    if (parsed.parsed_permart) {
+        mxmlDelete(parsed.parsed_permart);
+    }
+    parsed.parsed_permart = mxmlLoadString(NULL, xml, MXML_OPAQUE_CALLBACK);
+    return parsed.parsed_permart != NULL;
+}
+
+static void write_json(FILE* fp, const char* path, const bench_stats_s* stats)
+{
+    uint32_t i;
+
+    fprintf(fp, "{\"artefact\":{\"path\":\"%s\",\"bytes\":%u,\"vertices\":%u},", path, xml_len,
+            parsed_info.nverts);
+    fprintf(fp, "\"warmup_batches\":%u,\"reps\":%u,\"unit\":\"ns/op\",\"results\":[", BENCH_WARMUP,
+            BENCH_REPS);
+    for (i = 0; i < BENCH_CASES; i++) {
+        fprintf(fp, "%s{\"name\":\"%s\",\"batch\":%u,\"min\":%.1f,\"median\":%.1f,\"mean\":%.1f,"
+                "\"p95\":%.1f,\"stddev\":%.1f}", i ? "," : "", cases[i].name, cases[i].batch,
+                stats[i].min, stats[i].median, stats[i].mean, stats[i].p95, stats[i].stddev);
+    }
+    fprintf(fp, "]}\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 2 ? argv[2] : BENCH_ARTEFACT;
+    bench_stats_s stats[BENCH_CASES];
+    mxml_node_t* flight_params;
+    float minx, maxx, miny, maxy;
+    uint32_t i, seed = 0x9E3779B9u;
+    FILE* fp;
+
+    xml = read_file(path, &xml_len);
+    if (!xml) {
+        printf("cannot read %s\n", path);
+        return 1;
+    }
+    npnt_init_handle(&parsed);
+    parsed.permit.info = &parsed_info;
+    if (!locate() || !resign() || !locate()) {
+        printf("cannot sign %s\n", path);
+        return 1;
+    }
+    b64 = base64_encode((const uint8_t*)xml, xml_len, &b64_len);
+    flight_params = mxmlFindElement(parsed.parsed_permart, parsed.parsed_permart, "FlightParameters",
+                                    NULL, NULL, MXML_DESCEND);
+    start_time = mxmlElementGetAttr(flight_params, "flightStartTime");
+    if (!b64 || !start_time) {
+        printf("artefact misses flight parameters\n");
+        return 1;
+    }
+
+    //fence kept for pnpoly, queries scattered over twice its bounding box
+    parsed_info.nverts = npnt_alloc_and_get_fence_points(&parsed, NULL, NULL);
+    if ((int32_t)parsed_info.nverts <= 0) {
+        printf("artefact has no fence\n");
+        return 1;
+    }
+    minx = maxx = parsed_info.vertlat[0];
+    miny = maxy = parsed_info.vertlon[0];
+    for (i = 1; i < parsed_info.nverts; i++) {
+        minx = parsed_info.vertlat[i] < minx ? parsed_info.vertlat[i] : minx;
+        maxx = parsed_info.vertlat[i] > maxx ? parsed_info.vertlat[i] : maxx;
+        miny = parsed_info.vertlon[i] < miny ? parsed_info.vertlon[i] : miny;
+        maxy = parsed_info.vertlon[i] > maxy ? parsed_info.vertlon[i] : maxy;
+    }
+    for (i = 0; i < BENCH_POINTS; i++) {
+        qx[i] = bench_randf(&seed, minx - (maxx - minx) / 2, maxx + (maxx - minx) / 2);
+        qy[i] = bench_randf(&seed, miny - (maxy - miny) / 2, maxy + (maxy - miny) / 2);
+    }
+    //fence points are collected into a scratch record, pnpoly keeps this one
+    scratch.parsed_permart = parsed.parsed_permart;
+    scratch.permit.info = &scratch_info;
+    if (run_set_permart(1) != 1) {
+        printf("npnt_set_permart rejects the signed artefact\n");
+        return 1;
+    }
+
+    printf("%s: %u bytes, %u vertices, %u reps after %u warm-up batches\n", path, xml_len,
+           parsed_info.nverts, BENCH_REPS, BENCH_WARMUP);
+    printf("%-32s %7s %12s %12s %12s %12s %12s\n", "stage", "batch", "min", "median", "mean", "p95",
+           "stddev");
+    for (i = 0; i < BENCH_CASES; i++) {
+        run_case(&cases[i], &stats[i]);
+        printf("%-32s %7u %9.1f ns %9.1f ns %9.1f ns %9.1f ns %9.1f ns\n", cases[i].name, cases[i].batch,
+               stats[i].min, stats[i].median, stats[i].mean, stats[i].p95, stats[i].stddev);
+    }
+
+    if (argc > 1) {
+        fp = fopen(argv[1], "w");
+        if (!fp) {
+            printf("cannot write %s\n", argv[1]);
+            return 1;
+        }
+        write_json(fp, path, stats);
+        fclose(fp);
+    }
+    npnt_free(parsed_info.vertlat);
+    mxmlDelete(parsed.parsed_permart);
+    npnt_free(b64);
+    free(xml);
+    return 0;
+}
@@ -48,7 +48,6 @@
  */
 
 #define HAVE_SNPRINTF 1
-#define HAVE_VASPRINTF 1
 #define HAVE_VSNPRINTF 1
 
 
@@ -67,3 +66,20 @@
 
 extern char	*_mxml_strdupf(const char *, ...);
 extern char	*_mxml_vstrdupf(const char *, va_list);
+
+
+/*
+ * libnpnt allocator: the XML tree is counted with the rest of the library
+ * and comes from the static pool in that profile...
+ */
+
+extern void	*npnt_malloc(size_t);
+extern void	*npnt_calloc(size_t, size_t);
+extern void	*npnt_realloc(void *, size_t);
+extern char	*npnt_strdup(const char *);
+extern void	npnt_free(void *);
+#define malloc npnt_malloc
+#define calloc npnt_calloc
+#define realloc npnt_realloc
+#define strdup npnt_strdup
+#define free npnt_free
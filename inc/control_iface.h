@@ -72,19 +72,57 @@ int8_t npnt_aircraft_state(npnt_s *npnt_handle);
 //Implemented by libnpnt
 /**
  * @brief   Returns Breach State.
- * @details This method checks based on the current info the state
- *          of the breach.
+ * @details This method returns the breach word last published by
+ *          npnt_breach_evaluate. It is a single atomic load, safe to call
+ *          from the flight control loop while the evaluator runs on
+ *          another thread or in an ISR.
  *
  * @param[in] npnt_handle        npnt handle
  * 
- * @return           Breach type, 0 if no breach
- * @retval NPNT_BR_TIME   There has been a time breach
- *         NPNT_BR_FENCE  There has been a fence breach
+ * @return           Breach bits, 0 if no breach
+ * @retval NPNT_BR_FENCE  outside all inclusion zones
+ *         NPNT_BR_EXCL   inside an exclusion zone
+ *         NPNT_BR_ALT    above maximum altitude
+ *         NPNT_BR_TIME   outside flight time window or recurring window
+ *         NPNT_BR_NOPOS  absolute position not available
+ *         NPNT_BR_NOTIME GPS time not available
+ *         NPNT_BR_NOPERM no artefact set
  *
  * @iclass control_iface
  */
 int8_t npnt_breach_state(npnt_s *npnt_handle);
 
+/**
+ * @brief   Evaluates and publishes Breach State.
+ * @details This method samples npnt_abs_position and npnt_utc_time,
+ *          checks fence and zones, altitude ceiling and flight time
+ *          window in one pass and publishes the combined breach bits.
+ *          Meant to be run periodically by a single evaluator thread,
+ *          timer or ISR.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * 
+ * @return           Breach bits as published, 0 if no breach
+ *
+ * @iclass control_iface
+ */
+int8_t npnt_breach_evaluate(npnt_s *npnt_handle);
+
+/**
+ * @brief   Reads last published breach evaluation.
+ * @details Copies breach bits together with the position and time they
+ *          were computed for. Lock free, retries if the evaluator
+ *          publishes while copying.
+ *
+ * @param[in]  npnt_handle        npnt handle
+ * @param[out] snapshot           last published evaluation
+ * 
+ * @return           Errcode of failure, 0 if successful
+ *
+ * @iclass control_iface
+ */
+int8_t npnt_breach_read(npnt_s *npnt_handle, npnt_breach_snapshot_s *snapshot);
+
 /**
  * @brief   Sets Current Permission Artifact.
  * @details This method consumes peremission artefact in raw format
@@ -99,22 +137,87 @@ int8_t npnt_breach_state(npnt_s *npnt_handle);
  * @param[in] signature_length  length of the signature of permart in base64 format 
  * 
  * @return           Error id if faillure, 0 if no breach
- * @retval NPNT_INV_ART   Invalid Artefact
+ * @retval NPNT_INV_ART   Invalid Artefact, or larger than NPNT_MAX_PERMART_SIZE
  *         NPNT_INCOMP_ART Incomplete Artefact
  *         NPNT_INV_AUTH  signed by unauthorised entity
  *         NPNT_INV_STATE artefact can't setup in current aircraft state
  *
  * @iclass control_iface
  */
-int8_t npnt_set_permart(npnt_s *handle, uint8_t *permart, uint16_t permart_length, uint8_t base64_encoded);
+int8_t npnt_set_permart(npnt_s *handle, uint8_t *permart, uint32_t permart_length, uint8_t base64_encoded);
+
+#if defined(__unix__) || defined(__APPLE__)
+/**
+ * @brief   Sets Current Permission Artifact from file.
+ * @details POSIX hosts only, see src/art_file.c.
+ *          Maps the file read only and loads it like npnt_set_permart.
+ *          An XML artefact is parsed, digested and verified in the
+ *          mapping without a copy, which stays mapped until
+ *          npnt_reset_handle. Anything not starting with '<' after
+ *          whitespace is taken for base64 and decoded straight from the
+ *          mapping. The mapping is not counted by npnt_mem_stats.
+ *
+ * @param[in] npnt_handle       npnt handle
+ * @param[in] path              artefact file, XML or base64
+ *
+ * @return           Error id if faillure, 0 if successful
+ * @retval NPNT_INV_ART   file can't be opened or mapped, is empty, or larger
+ *                        than NPNT_MAX_PERMART_SIZE
+ *         NPNT_INV_AUTH  signed by unauthorised entity
+ *         NPNT_ALREADY_SET artefact already set, free previous artefact first
+ *
+ * @iclass control_iface
+ */
+int8_t npnt_set_permart_file(npnt_s *handle, const char *path);
+#endif
+
+/**
+ * @brief   Sets Current Permission Artifact from JSON envelope.
+ * @details Consumes {"artefact": base64 permission, "signature": base64
+ *          signature}, the signature made over the digest of the artefact
+ *          text as sent. The permission uses the element and attribute
+ *          names of the XML artefact, see src/art_json.c. It is tokenized
+ *          by jsmn into a static array of NPNT_JSON_MAX_TOKENS and read
+ *          without building a tree or canonicalizing, loads must not run
+ *          concurrently. Fails like npnt_set_permart otherwise.
+ *
+ * @param[in] npnt_handle       npnt handle
+ * @param[in] envelope          JSON envelope as received from server
+ * @param[in] envelope_length   size of envelope
+ *
+ * @return           Error id if faillure, 0 if successful
+ * @retval NPNT_INV_ART   No envelope, larger than NPNT_MAX_PERMART_SIZE, or
+ *                        more tokens than NPNT_JSON_MAX_TOKENS
+ *         NPNT_INV_AUTH  signed by unauthorised entity
+ *         NPNT_ALREADY_SET artefact already set, free previous artefact first
+ *
+ * @iclass control_iface
+ */
+int8_t npnt_set_permart_json(npnt_s *handle, const uint8_t *envelope, uint32_t envelope_length);
 
 int8_t npnt_init_handle(npnt_s *handle);
 
+/**
+ * @brief   Frees everything loaded into the handle.
+ * @details Unpublishes the active permit first and waits for the read
+ *          sections still using it, so lookups on other threads such as
+ *          npnt_fence_query see no permit instead of freed memory. The
+ *          read section counters survive the reset. Breach evaluation and
+ *          npnt_log_flush write handle state themselves and must not run
+ *          concurrently.
+ *
+ * @param[in] npnt_handle       npnt handle
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_UNALLOC_HANDLE  no handle
+ *
+ * @iclass control_iface
+ */
 int8_t npnt_reset_handle(npnt_s *handle);
 
 int8_t npnt_verify_permart(npnt_s *handle);
 
-int8_t npnt_alloc_and_get_fence_points(npnt_s* handle, float* vertx, float* verty);
+int32_t npnt_alloc_and_get_fence_points(npnt_s* handle, float* vertx, float* verty);
 
 int8_t npnt_get_max_altitude(npnt_s* handle, float* altitude);
 
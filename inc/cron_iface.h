@@ -0,0 +1,106 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef CRON_IFACE_H
+#define CRON_IFACE_H
+ /**
+ * @file    inc/cron_iface.h
+ * @brief   Interface definitions for NPNT recurring flight windows
+ * @{
+ */
+
+#include <defines.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//Implemented by libnpnt
+/**
+ * @brief   Compiles Quartz cron expression.
+ * @details Accepts "sec min hour day-of-month month day-of-week [year]"
+ *          with "*", "?", lists, ranges, steps and JAN-DEC/SUN-SAT names.
+ *          Day of month also takes "L" and "L-n", day of week "L", "dL"
+ *          and "d#n". Nearest weekday ("W") is not supported.
+ *
+ * @param[out] cron              compiled expression
+ * @param[in]  expr              Quartz cron expression
+ * @param[in]  tz_offset         seconds east of UTC the expression is read in
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_FPARAMS   malformed or unsupported expression
+ *
+ * @iclass cron_iface
+ */
+int8_t npnt_cron_compile(npnt_cron_s *cron, const char* expr, int32_t tz_offset);
+
+/**
+ * @brief   Checks if a time matches the expression.
+ * @details One bit test per field.
+ *
+ * @param[in] cron               compiled expression
+ * @param[in] t                  UTC epoch seconds
+ *
+ * @return           true if the expression fires at t
+ *
+ * @iclass cron_iface
+ */
+bool npnt_cron_match(const npnt_cron_s *cron, int64_t t);
+
+/**
+ * @brief   Returns first time the expression fires at or after t.
+ * @details Each field jumps to its next set bit, so the cost does not
+ *          depend on the distance to the result.
+ *
+ * @param[in] cron               compiled expression
+ * @param[in] t                  UTC epoch seconds
+ *
+ * @return           UTC epoch seconds, -1 if the expression never fires again
+ *
+ * @iclass cron_iface
+ */
+int64_t npnt_cron_next(const npnt_cron_s *cron, int64_t t);
+
+/**
+ * @brief   Returns last time the expression fired at or before t.
+ *
+ * @param[in] cron               compiled expression
+ * @param[in] t                  UTC epoch seconds
+ *
+ * @return           UTC epoch seconds, -1 if the expression never fired
+ *
+ * @iclass cron_iface
+ */
+int64_t npnt_cron_prev(const npnt_cron_s *cron, int64_t t);
+
+/**
+ * @brief   Checks if time lies inside a recurring flight window.
+ * @details Windows open whenever recurrenceTimeExpression fires and stay
+ *          open for recurringTimeDurationInMinutes. The verdict is cached
+ *          with the interval it holds for, so calling it every control
+ *          cycle costs two compares until the next window edge.
+ *
+ * @param[in]  npnt_handle        npnt handle
+ * @param[in]  now                UTC epoch seconds
+ * @param[out] next_start         start of the next window after now, -1 if
+ *                                none, may be NULL
+ *
+ * @return           1 if inside a window, 0 if not, Errcode if failure
+ * @retval NPNT_INV_STATE   no active permit or it has no recurrence
+ *
+ * @iclass cron_iface
+ */
+int8_t npnt_recurrence_window(npnt_s *handle, int64_t now, int64_t* next_start);
+
+/** @} */
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif //CRON_IFACE_H
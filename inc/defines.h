@@ -16,7 +16,9 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <time.h>
 #include <mxml.h>
@@ -27,26 +29,396 @@ extern "C"
 {
 #endif
 
+//Cache line the hot parts of npnt_s and npnt_permit_s are laid out for
+#ifndef NPNT_CACHE_LINE
+#define NPNT_CACHE_LINE             64
+#endif
+#define NPNT_CACHE_ALIGNED          __attribute__((aligned(NPNT_CACHE_LINE)))
+
+//Length of the flight log hash chain, a SHA1 digest
+#define NPNT_FLOG_HASH_LEN          20
+
+//Flight log Merkle batches hold up to 2^NPNT_FLOG_MAX_DEPTH records
+#ifndef NPNT_FLOG_MAX_DEPTH
+#define NPNT_FLOG_MAX_DEPTH         16
+#endif
+
+//Evaluations the breach log holds until flushed, a power of two
+#ifndef NPNT_LOG_SIZE
+#define NPNT_LOG_SIZE               256
+#endif
+
+/**
+ * Local East-North tangent plane used for all fence math.
+ * Geodetic positions map to it through a fixed affine transform:
+ *   x = (lon - origin_lon) * m_per_deg_lon   (metres east)
+ *   y = (lat - origin_lat) * m_per_deg_lat   (metres north)
+ */
+typedef struct {
+    double origin_lat;      //degrees
+    double origin_lon;      //degrees
+    double m_per_deg_lat;   //meters per degree of latitude at origin
+    double m_per_deg_lon;   //meters per degree of longitude at origin
+} npnt_frame_s;
+
+/**
+ * Uniform grid over a polygon in local frame meters. Every cell lists the
+ * edges passing through it (edge i joins vertex i and i+1, in CSR layout)
+ * and whether its reference point lies inside the polygon. Reference
+ * points sit at the same place in every cell, the center unless an edge
+ * runs through one of the centers.
+ */
+typedef struct {
+    float minx, miny;       //meters, lower left corner of the grid
+    float cell;             //meters, cell edge length
+    float refx, refy;       //reference point offset from the cell corner, fractions of cell
+    uint16_t ncols, nrows;
+    uint32_t* cell_start;   //ncols*nrows + 1 offsets into cell_edges
+    uint32_t* cell_edges;   //edge ids
+    uint8_t* ref_in;        //bitset, cell reference point inside polygon
+} npnt_grid_s;
+
+/**
+ * Raster mask over a polygon's bounds in local frame meters, two bits per
+ * cell telling whether the cell lies fully outside, fully inside or on the
+ * boundary. bits is NULL when no mask is built.
+ */
+typedef struct {
+    float minx, miny;       //meters, lower left corner of the mask
+    float cell;             //meters, cell edge length
+    uint16_t ncols, nrows;
+    uint8_t* bits;          //NPNT_RASTER_* per cell, four cells per byte
+} npnt_raster_s;
+
+/**
+ * Single fence polygon in local frame meters. The artefact polygon is
+ * always zone 0, further inclusion and exclusion zones can be added from
+ * local files. Fields up to the raster mask are all a containment test of
+ * a convex or rasterised zone reads, the grid only serves the rest.
+ */
+typedef struct {
+    float minx, miny, maxx, maxy;
+    float* vertx;           //meters east of frame origin
+    float* verty;           //meters north of frame origin, same allocation as vertx
+    uint32_t nverts;
+    uint8_t kind;           //NPNT_ZONE_INCLUDE or NPNT_ZONE_EXCLUDE
+    bool convex;            //containment by binary search over the fan from vertex 0
+    npnt_raster_s raster;   //inside/outside cache, exact test only on boundary cells
+    uint32_t id;            //caller assigned zone id
+    npnt_grid_s grid;       //edge index over vertx/verty
+} npnt_zone_s;
+
+/**
+ * Bounding volume hierarchy node over zone bounds. The left child of an
+ * inner node directly follows it in the node array.
+ */
+typedef struct {
+    float minx, miny, maxx, maxy;
+    uint32_t index;         //leaf: first entry in zone order, inner: right child node
+    uint32_t count;         //leaf: number of zones, 0 for inner nodes
+} npnt_bvh_node_s;
+
+typedef struct {
+    float minx, miny, maxx, maxy;   //bounds of all inclusion zones, nothing outside is permitted
+    npnt_zone_s* zones;
+    uint32_t nzones;
+    uint32_t nnodes;
+    npnt_bvh_node_s* nodes;
+    uint32_t* order;        //zone indices in leaf order
+    uint32_t max_zones;
+    bool raster_custom;     //raster_cell/raster_max_bytes replace the compile time defaults
+    float raster_cell;      //meters, 0 for the finest cell within raster_max_bytes
+    uint32_t raster_max_bytes; //per zone, 0 disables the raster masks
+} npnt_fence_set_s;
+
+/**
+ * Breach tracker state. Successive position samples reuse the verdict of
+ * the last full query while they stay closer to it than the clearance to
+ * the nearest zone boundary.
+ */
+typedef struct {
+    float x, y;             //meters, anchor of the last full query
+    float last_x, last_y;   //meters, previous sample
+    float clearance;        //meters, distance from anchor to nearest zone boundary
+    uint32_t anchor_zone;   //zone index reported at anchor
+    int8_t anchor_verdict;  //verdict at anchor
+    uint32_t zone;          //zone index reported at last sample
+    int8_t verdict;         //verdict at last sample
+    bool valid;
+    uint32_t serial;        //permit the anchor was computed for
+    uint16_t local_streak;  //samples since last full query
+    struct {
+        uint32_t samples;
+        uint32_t coherent;  //verdict reused without touching any edge
+        uint32_t local;     //zone set query without nearest boundary search
+        uint32_t full;      //full query including nearest boundary search
+    } stats;
+} npnt_tracker_s;
+
+/**
+ * Result of one breach evaluation.
+ */
+typedef struct {
+    uint32_t breach;        //NPNT_BR_* bits, 0 if no breach
+    float lat, lon;         //degrees, sample the result was computed for
+    float altitude;         //meters Above Ground Level
+    uint64_t utc_time;      //as returned by npnt_utc_time
+    uint32_t count;         //evaluations published so far
+} npnt_breach_snapshot_s;
+
+/**
+ * Breach result published by the evaluator. seq is odd while the single
+ * writer updates the snapshot, readers retry until they observe the same
+ * even value before and after copying.
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t word;          //copy of snapshot.breach, readable with one atomic load
+    npnt_breach_snapshot_s snapshot;
+} npnt_breach_pub_s;
+
+/**
+ * Breach log between the evaluator and the flusher, a single producer
+ * single consumer ring of NPNT_LOG_SIZE evaluations. head and tail run
+ * freely and are masked on access. Each side writes only its own line,
+ * the evaluator keeps a stale copy of tail so it only reads the
+ * flusher's line when the ring looks full.
+ */
+typedef struct {
+    uint32_t head NPNT_CACHE_ALIGNED;   //records written, advanced by the evaluator
+    uint32_t tail_cache;                //tail as last seen by the evaluator
+    uint32_t dropped;                   //records lost to a full ring
+    uint32_t last;                      //breach word of the last logged evaluation
+    uint32_t tail NPNT_CACHE_ALIGNED;   //records read, advanced by the flusher
+    npnt_breach_snapshot_s records[NPNT_LOG_SIZE] NPNT_CACHE_ALIGNED;
+} npnt_log_s;
+
+/**
+ * Quartz cron expression compiled to one bitset per field. Bit v of a
+ * field is set when value v matches, years are stored from 1970 on.
+ * Days match through dom unless day_by_dow is set.
+ */
+typedef struct {
+    uint64_t second;        //0..59
+    uint64_t minute;        //0..59
+    uint32_t hour;          //0..23
+    uint32_t dom;           //1..31
+    int8_t dom_last;        //"L-n" as n, -1 if unused
+    uint16_t month;         //1..12
+    uint8_t dow;            //1 (SUN)..7 (SAT)
+    uint8_t dow_last;       //"dL", last such weekday of the month
+    uint8_t dow_nth[8];     //"d#k", bit k set in dow_nth[d]
+    bool day_by_dow;
+    uint64_t year[3];       //1970..2161
+    int32_t tz_offset;      //seconds east of UTC the expression is read in
+} npnt_cron_s;
+
+/**
+ * Permit fields only needed while loading, matching and reporting.
+ */
+typedef struct {
+    char* uinNo;
+    char* adcNumber;
+    char* ficNumber;
+    struct tm flightStartTime;  //UTC
+    struct tm flightEndTime;    //UTC
+    float* vertlat;             //degrees, artefact fence after cleanup
+    float* vertlon;             //degrees, same allocation as vertlat
+    uint32_t nverts;
+    npnt_cron_s cron;           //recurring window start times, valid if window_len is set
+} npnt_permit_info_s;
+
+/**
+ * Verified permission artefact reduced to what breach evaluation reads.
+ * The first cache line holds everything a breach evaluation needs while
+ * the tracker reuses its verdict, the second one the zone lookup, the
+ * rest sits behind info.
+ *
+ * Records held by the permit store are never modified after they are
+ * built, so switching permissions only swaps npnt_s.rcu.active. Readers pick
+ * the pointer up inside npnt_permit_read_begin/end, and records are only
+ * freed once every read section that could have seen them has ended.
+ */
+typedef struct {
+    npnt_frame_s frame;             //anchored at fence centroid
+    int64_t flightStart;            //UTC epoch seconds
+    int64_t flightEnd;              //UTC epoch seconds
+    float maxAltitude;              //meters
+    uint32_t window_len;            //seconds each recurring window stays open, 0 if not recurring
+    uint32_t serial;                //unique per handle, renewed when the record changes
+    bool verified;                  //complete record of a verified artefact
+    npnt_fence_set_s set NPNT_CACHE_ALIGNED; //zone 0 is the artefact fence
+    npnt_permit_info_s* info;
+} npnt_permit_s;
+
+typedef struct {
+    int64_t start;          //flightStart of permit
+    int64_t end;            //flightEnd of permit
+    int64_t reach;          //latest end of this and all earlier entries
+    npnt_permit_s* permit;
+} npnt_permit_entry_s;
+
+typedef struct {
+    npnt_permit_entry_s* entries;   //sorted by start
+    uint16_t count;
+    uint16_t max;
+} npnt_permit_store_s;
+
+/**
+ * Library handle. Lines written by different parties are kept apart: read
+ * sections, the evaluator's own state, the published breach word, and the
+ * cold loading state at the end.
+ */
 typedef struct {
-    char *raw_permart;
-    uint16_t raw_permart_len;
-    void*   security_handle;
-    mxml_node_t *parsed_permart;
     struct {
-        float* vertlat;     //degrees
-        float* vertlon;     //degrees
-        float maxAltitude; //meters
-        uint8_t nverts;
-    } fence;
+        const npnt_permit_s* active;    //permit breaches are evaluated against, NULL if none
+        uint32_t epoch;             //parity picks the counter new read sections enter
+        uint32_t readers[2];        //open read sections per parity
+        uint32_t serial;            //last permit serial handed out
+    } rcu NPNT_CACHE_ALIGNED;
+    npnt_tracker_s tracker NPNT_CACHE_ALIGNED;
     struct {
-        char* uinNo;
-        char* adcNumber;
-        char* ficNumber;
-        struct tm flightStartTime;
-        struct tm flightEndTime;
-    } params;
+        int64_t from, until;        //cached recurrence verdict holds for from <= t < until
+        bool inside;
+        uint32_t serial;            //permit the verdict was computed for
+    } window;
+    npnt_breach_pub_s breach NPNT_CACHE_ALIGNED;
+    npnt_log_s* log;                //breach log ring from npnt_log_init, NULL logs nothing
+    char *raw_permart NPNT_CACHE_ALIGNED;
+    uint32_t raw_permart_len;
+    size_t raw_permart_map_len;     //file mapping raw_permart points to, 0 if from npnt_malloc
+    void*   security_handle;
+    mxml_node_t *parsed_permart;
+    npnt_permit_store_s store;
+    npnt_permit_s permit;           //artefact set with npnt_set_permart
 } npnt_s;
 
+//Loading stages library allocations are booked to, see npnt_mem_stats
+#define NPNT_MEM_OTHER              0       //outside npnt_set_permart
+#define NPNT_MEM_DECODE             1       //base64 decoding and raw copy of the artefact
+#define NPNT_MEM_PARSE              2       //XML tree
+#define NPNT_MEM_VERIFY             3       //digest and signature check
+#define NPNT_MEM_FENCE              4       //fence vertices, zone set and indexes
+#define NPNT_MEM_PARAMS             5       //identifiers and flight parameters
+#define NPNT_MEM_STAGES             6
+
+typedef struct {
+    uint32_t allocs;        //allocations made in the stage
+    uint32_t bytes;         //bytes allocated in the stage
+    uint32_t live;          //bytes allocated in the stage and not freed yet
+    uint32_t peak;          //largest live
+} npnt_mem_stage_s;
+
+/**
+ * Library heap usage, see npnt_mem_stats. Sizes count what callers asked
+ * for, the static pool additionally rounds each block up to its class.
+ */
+typedef struct {
+    uint32_t in_use;        //bytes currently allocated
+    uint32_t peak;          //largest in_use seen
+    uint32_t allocs;        //successful allocations
+    uint32_t failures;      //allocations that returned NULL
+    uint32_t pool_size;     //static pool bytes, 0 when backed by the C heap or hooks
+    uint32_t pool_used;     //static pool bytes carved into blocks so far
+    npnt_mem_stage_s stage[NPNT_MEM_STAGES];
+} npnt_mem_stats_s;
+
+/**
+ * Replacement backend for library allocations, see npnt_mem_set_hooks.
+ * Returned memory needs the alignment of malloc.
+ */
+typedef struct {
+    void* (*alloc)(size_t size, void* ctx);
+    void (*release)(void* ptr, void* ctx);
+    void* ctx;
+} npnt_mem_hooks_s;
+
+//Loading stages reported to the trace callback, see npnt_trace_set_callback
+#define NPNT_TRACE_LOAD             0       //npnt_set_permart as a whole
+#define NPNT_TRACE_DECODE           1       //base64 decoding or raw copy of the artefact
+#define NPNT_TRACE_PARSE            2       //XML parse
+#define NPNT_TRACE_SIGNEDINFO       3       //SignedInfo digest
+#define NPNT_TRACE_RSA_VERIFY       4       //signature check against the DGCA key
+#define NPNT_TRACE_PERMISSION       5       //permission digest
+#define NPNT_TRACE_FENCE            6       //fence extraction and projection
+#define NPNT_TRACE_PARAMS           7       //altitude and flight parameters
+#define NPNT_TRACE_STAGES           8
+
+typedef struct {
+    uint64_t ts_ns;         //monotonic clock, NPNT_TRACE_CLOCK_NS
+    uint8_t stage;          //NPNT_TRACE_*
+    bool begin;             //stage starts, ends otherwise
+} npnt_trace_event_s;
+
+typedef void (*npnt_trace_cb)(const npnt_trace_event_s* ev, void* ctx);
+
+/**
+ * Chrome trace sink state, see npnt_trace_chrome_open.
+ */
+typedef struct {
+    FILE* fp;               //events go here
+    uint32_t events;        //events written so far
+} npnt_trace_chrome_s;
+
+/**
+ * Flight log file, a header followed by fixed size records. Every record
+ * extends the hash chain, chain = SHA1(chain | record), starting from
+ * seed, so the chain value in the header covers the whole log.
+ * Logs opened with batches also group records into Merkle trees of batch
+ * records, leaf = SHA1(0 | record), node = SHA1(1 | left | right), an odd
+ * last node moves up unpaired. The roots of complete batches follow the
+ * records.
+ */
+typedef struct {
+    char magic[8];                      //NPNT_FLOG_MAGIC
+    uint32_t version;                   //NPNT_FLOG_VERSION
+    uint32_t record_size;               //sizeof(npnt_flight_record_s)
+    uint32_t capacity;                  //records the file has room for
+    uint32_t count;                     //records appended
+    uint32_t batch;                     //records per Merkle batch, 0 without batches
+    uint8_t seed[NPNT_FLOG_HASH_LEN];   //chain before the first record, hash of the previous log
+    uint8_t chain[NPNT_FLOG_HASH_LEN];  //chain after the last record
+    uint32_t reserved;                  //zero, keeps the records 8 byte aligned
+} npnt_flight_log_hdr_s;
+
+/**
+ * Flight log record, hashed as stored, reserved bytes are zero.
+ */
+typedef struct {
+    uint64_t utc_time;      //as returned by npnt_utc_time
+    float lat, lon;         //degrees
+    float altitude;         //meters Above Ground Level
+    uint32_t breach;        //NPNT_BR_* bits of NPNT_FLOG_BREACH records
+    uint32_t seq;           //position in the log, from 0
+    uint8_t type;           //NPNT_FLOG_*
+    uint8_t reserved[3];
+} npnt_flight_record_s;
+
+/**
+ * Open flight log, the whole file is mapped so appending only writes memory.
+ */
+typedef struct {
+    int fd;
+    size_t map_len;
+    npnt_flight_log_hdr_s* hdr;
+    npnt_flight_record_s* records;
+    uint8_t (*roots)[NPNT_FLOG_HASH_LEN];   //one per complete batch
+    uint8_t frontier[NPNT_FLOG_MAX_DEPTH][NPNT_FLOG_HASH_LEN]; //complete subtrees of the open batch
+} npnt_flight_log_s;
+
+/**
+ * Inclusion proof of one record in the Merkle tree of its batch, the
+ * siblings from the leaf up, skipping levels where the path moves up
+ * unpaired.
+ */
+typedef struct {
+    uint32_t seq;           //record the proof is for
+    uint32_t batch;         //records per batch of the log
+    uint32_t count;         //records in the batch the root covers
+    uint8_t depth;          //siblings used
+    uint8_t siblings[NPNT_FLOG_MAX_DEPTH][NPNT_FLOG_HASH_LEN];
+} npnt_flight_proof_s;
+
 #define NPNT_INV_ART                -1
 #define NPNT_INV_AUTH               -3
 #define NPNT_INV_STATE              -4
@@ -59,6 +431,125 @@ typedef struct {
 #define NPNT_INV_FPARAMS            -11
 #define NPNT_INV_BAD_ALT            -12
 
+//Breach bits, combined into the breach word
+#define NPNT_BR_FENCE               0x01    //outside all inclusion zones
+#define NPNT_BR_EXCL                0x02    //inside an exclusion zone
+#define NPNT_BR_ALT                 0x04    //above maxAltitude
+#define NPNT_BR_TIME                0x08    //outside flight time window or recurring window
+#define NPNT_BR_NOPOS               0x10    //absolute position not available
+#define NPNT_BR_NOTIME              0x20    //GPS time not available
+#define NPNT_BR_NOPERM              0x40    //no permission artefact set
+
+//Breach bits logged at every evaluation they are set in, other changes of the word are logged once
+#ifndef NPNT_LOG_TRACK
+#define NPNT_LOG_TRACK              (NPNT_BR_FENCE | NPNT_BR_EXCL | NPNT_BR_ALT | NPNT_BR_TIME)
+#endif
+
+//Offset of artefact times without zone suffix from UTC, IST
+#define NPNT_IST_OFFSET             (5 * 3600 + 30 * 60)
+
+#define NPNT_ZONE_INCLUDE           0
+#define NPNT_ZONE_EXCLUDE           1
+
+//Flight log record types
+#define NPNT_FLOG_ARM               0       //takeoff or arming
+#define NPNT_FLOG_DISARM            1       //landing or disarming
+#define NPNT_FLOG_BREACH            2       //breach evaluation, see breach bits
+#define NPNT_FLOG_MAGIC             "NPNTFLOG"
+#define NPNT_FLOG_VERSION           1
+
+//Vertices closer than this many meters, or as close to the line through their neighbours, are merged
+#ifndef NPNT_FENCE_EPS
+#define NPNT_FENCE_EPS              0.01f
+#endif
+
+//Convex zones up to this many vertices skip the grid for the O(log n) fan search
+#ifndef NPNT_FENCE_FAN_MAX
+#define NPNT_FENCE_FAN_MAX          64
+#endif
+
+#define NPNT_RASTER_OUT             0
+#define NPNT_RASTER_IN              1
+#define NPNT_RASTER_EDGE            2
+
+//Raster mask cell in meters, 0 picks the finest cell within NPNT_RASTER_MAX_BYTES
+#ifndef NPNT_RASTER_CELL
+#define NPNT_RASTER_CELL            0.0f
+#endif
+//Raster mask memory cap per zone in bytes, 0 disables the masks
+#ifndef NPNT_RASTER_MAX_BYTES
+#ifdef NPNT_STATIC_MEMORY
+#define NPNT_RASTER_MAX_BYTES       4096
+#else
+#define NPNT_RASTER_MAX_BYTES       16384
+#endif
+#endif
+
+/*
+ * Static memory profile. With NPNT_STATIC_MEMORY defined every library
+ * allocation, including the XML tree, comes from a fixed pool of
+ * NPNT_POOL_SIZE bytes instead of the C heap, and artefacts beyond the
+ * limits below are rejected before anything is allocated for them.
+ */
+#ifdef NPNT_STATIC_MEMORY
+#ifndef NPNT_MAX_PERMART_SIZE
+#define NPNT_MAX_PERMART_SIZE       8192
+#endif
+#ifndef NPNT_MAX_FENCE_VERTS
+#define NPNT_MAX_FENCE_VERTS        256
+#endif
+#ifndef NPNT_MAX_STR_LEN
+#define NPNT_MAX_STR_LEN            64
+#endif
+#ifndef NPNT_MAX_PERMITS
+#define NPNT_MAX_PERMITS            2
+#endif
+//jsmn tokens of a JSON artefact, five per fence vertex
+#ifndef NPNT_JSON_MAX_TOKENS
+#define NPNT_JSON_MAX_TOKENS        (5 * NPNT_MAX_FENCE_VERTS + 64)
+#endif
+//Raw and parsed artefact, about 12 times its size after class rounding, plus the fence of every permit
+#ifndef NPNT_POOL_SIZE
+#define NPNT_POOL_SIZE              (12 * NPNT_MAX_PERMART_SIZE + \
+                                     (NPNT_MAX_PERMITS + 1) * (2 * NPNT_RASTER_MAX_BYTES + 64 * NPNT_MAX_FENCE_VERTS))
+#endif
+#else
+#ifndef NPNT_MAX_PERMART_SIZE
+#define NPNT_MAX_PERMART_SIZE       UINT32_MAX
+#endif
+#ifndef NPNT_MAX_FENCE_VERTS
+#define NPNT_MAX_FENCE_VERTS        (INT32_MAX / (2 * sizeof(float)))
+#endif
+#ifndef NPNT_MAX_STR_LEN
+#define NPNT_MAX_STR_LEN            UINT16_MAX
+#endif
+#ifndef NPNT_MAX_PERMITS
+#define NPNT_MAX_PERMITS            UINT16_MAX
+#endif
+//jsmn tokens of a JSON artefact, five per fence vertex, 20 bytes each with parent links in a static array
+#ifndef NPNT_JSON_MAX_TOKENS
+#define NPNT_JSON_MAX_TOKENS        (5 * 1024 + 64)
+#endif
+#endif
+
+//Run by the loading thread while it waits for read sections to end, a plain spin without a scheduler
+#ifndef NPNT_PERMIT_WAIT
+#if defined(__unix__) || defined(__APPLE__)
+#define NPNT_PERMIT_WAIT()          sched_yield()
+#else
+#define NPNT_PERMIT_WAIT()          __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#endif
+#endif
+
+//Step in meters between samples beyond which the tracker runs a full query
+#ifndef NPNT_TRACK_JUMP
+#define NPNT_TRACK_JUMP             50.0f
+#endif
+//Local samples after which the tracker refreshes its clearance
+#ifndef NPNT_TRACK_REFRESH
+#define NPNT_TRACK_REFRESH          16
+#endif
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
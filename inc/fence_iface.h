@@ -0,0 +1,252 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef FENCE_IFACE_H
+#define FENCE_IFACE_H
+ /**
+ * @file    inc/fence_iface.h
+ * @brief   Interface definitions for NPNT fence geometry
+ * @{
+ */
+
+#include <defines.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Distance of a position to the limits of the permitted volume.
+ */
+typedef struct {
+    float fence_dist;       //meters to nearest fence edge, positive inside, negative outside
+    float ceiling_dist;     //meters below maxAltitude, negative above
+    float time_to_breach;   //seconds at current velocity, INFINITY if never, 0 if breached
+    uint32_t nearest_edge;  //nearest edge of nearest_zone, joins vertex i and i+1
+    uint32_t nearest_zone;  //id of zone owning the nearest boundary
+} npnt_fence_margin_s;
+
+#define NPNT_FENCE_INSIDE           0   //inside an inclusion zone and no exclusion zone
+#define NPNT_FENCE_OUTSIDE          1   //outside every inclusion zone
+#define NPNT_FENCE_EXCLUDED         2   //inside an exclusion zone
+
+//Implemented by libnpnt
+/**
+ * @brief   Projects fence into local tangent plane.
+ * @details Anchors a local East-North frame at the area centroid of the
+ *          fence polygon and converts every vertex into meters. Called
+ *          once by npnt_set_permart after the fence points are read.
+ *
+ * @param[in] npnt_handle        npnt handle with fence.vertlat/vertlon set
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_BAD_FENCE   fence has no vertices or allocation failed
+ *
+ * @iclass fence_iface
+ */
+int8_t npnt_fence_project(npnt_s *handle);
+
+/**
+ * @brief   Converts geodetic position to local frame.
+ * @details Applies the precomputed affine transform of the frame, no
+ *          trigonometry is evaluated per call.
+ *
+ * @param[in]  frame     local frame
+ * @param[in]  lat       latitude in degrees
+ * @param[in]  lon       longitude in degrees
+ * @param[out] x         meters east of frame origin
+ * @param[out] y         meters north of frame origin
+ *
+ * @iclass fence_iface
+ */
+void npnt_frame_to_local(const npnt_frame_s *frame, float lat, float lon, float *x, float *y);
+
+/**
+ * @brief   Converts local frame position back to geodetic.
+ *
+ * @param[in]  frame     local frame
+ * @param[in]  x         meters east of frame origin
+ * @param[in]  y         meters north of frame origin
+ * @param[out] lat       latitude in degrees
+ * @param[out] lon       longitude in degrees
+ *
+ * @iclass fence_iface
+ */
+void npnt_frame_to_geo(const npnt_frame_s *frame, float x, float y, float *lat, float *lon);
+
+/**
+ * @brief   Checks if position lies inside the fence.
+ * @details Shorthand for npnt_fence_query returning NPNT_FENCE_INSIDE.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] lat                latitude in degrees
+ * @param[in] lon                longitude in degrees
+ *
+ * @return           true if inside fence, false otherwise or if no fence is set
+ *
+ * @iclass fence_iface
+ */
+bool npnt_fence_contains(npnt_s *handle, float lat, float lon);
+
+/**
+ * @brief   Adds inclusion or exclusion zone to the fence.
+ * @details Projects the polygon into the artefact fence frame, indexes it
+ *          and rebuilds the zone hierarchy. Needs an artefact to be set.
+ *          Zones extend the artefact set with npnt_set_permart, permits
+ *          in the store are immutable and keep their own fence only.
+ *          The zones are edited on a copy that replaces the published
+ *          set once no breach evaluation can still read the old one.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] kind               NPNT_ZONE_INCLUDE or NPNT_ZONE_EXCLUDE
+ * @param[in] id                 zone id reported by queries
+ * @param[in] lat                vertex latitudes in degrees
+ * @param[in] lon                vertex longitudes in degrees
+ * @param[in] nverts             number of vertices
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   no artefact fence set
+ *         NPNT_BAD_FENCE   invalid polygon, more than NPNT_MAX_FENCE_VERTS
+ *                          vertices or allocation failed
+ *
+ * @iclass fence_iface
+ */
+int8_t npnt_fence_add_zone(npnt_s *handle, uint8_t kind, uint32_t id, const float* lat, const float* lon, uint32_t nverts);
+
+/**
+ * @brief   Loads inclusion and exclusion zones from a local file.
+ * @details Each zone starts with a line "include <id>" or "exclude <id>",
+ *          followed by one "<lat> <lon>" line per vertex in degrees.
+ *          Blank lines and lines starting with '#' are ignored.
+ *          Zones are only added if the whole file loads.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] path               zone file path
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE     no artefact fence set
+ *         NPNT_PARSE_FAILED  file missing or malformed
+ *
+ * @iclass fence_iface
+ */
+int8_t npnt_fence_load_zones(npnt_s *handle, const char* path);
+
+/**
+ * @brief   Configures the raster masks of the fence zones.
+ * @details Every zone keeps a mask over its bounds classifying cells as
+ *          inside, outside or boundary, so that only samples in boundary
+ *          cells run the exact polygon test. Masks are built at load time
+ *          with NPNT_RASTER_CELL and NPNT_RASTER_MAX_BYTES, this call
+ *          rebuilds them for all zones and applies to zones added later.
+ *          The cell grows as needed to keep each mask within max_bytes.
+ *          The setting lasts until npnt_reset_handle and applies to the
+ *          artefact set with npnt_set_permart, stored permits keep the
+ *          compile time defaults. Like npnt_fence_add_zone it swaps
+ *          in a rebuilt copy of the zone set.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] cell               cell edge in meters, 0 for the finest within max_bytes
+ * @param[in] max_bytes          memory cap per zone, 0 disables the masks
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_BAD_FENCE   allocation failed, affected zones use the exact test only
+ *
+ * @iclass fence_iface
+ */
+int8_t npnt_fence_raster_config(npnt_s *handle, float cell, uint32_t max_bytes);
+
+/**
+ * @brief   Returns containment verdict of position.
+ * @details Walks the bounding volume hierarchy over zone bounds, so only
+ *          zones whose bounds hold the position are tested, each through
+ *          its own grid index.
+ *
+ * @param[in]  npnt_handle        npnt handle
+ * @param[in]  lat                latitude in degrees
+ * @param[in]  lon                longitude in degrees
+ * @param[out] zone_id            id of containing zone, may be NULL
+ *
+ * @return           Verdict, or Errcode if failure
+ * @retval NPNT_FENCE_INSIDE     position is permitted
+ *         NPNT_FENCE_OUTSIDE    position outside all inclusion zones
+ *         NPNT_FENCE_EXCLUDED   position inside exclusion zone zone_id
+ *         NPNT_BAD_FENCE        no fence set
+ *
+ * @iclass fence_iface
+ */
+int8_t npnt_fence_query(npnt_s *handle, float lat, float lon, uint32_t* zone_id);
+
+/**
+ * @brief   Returns containment verdict of position using breach tracker.
+ * @details Same verdict as npnt_fence_query, but exploits that successive
+ *          samples lie close together. Samples within the clearance of the
+ *          last full query reuse its verdict without touching any edge,
+ *          short steps only test the grid cells holding the sample, and a
+ *          full query runs after a jump of more than NPNT_TRACK_JUMP meters
+ *          or every NPNT_TRACK_REFRESH local samples. Hit counters are kept
+ *          in npnt_handle->tracker.stats.
+ *
+ * @param[in]  npnt_handle        npnt handle
+ * @param[in]  lat                latitude in degrees
+ * @param[in]  lon                longitude in degrees
+ * @param[out] zone_id            id of containing zone, may be NULL
+ *
+ * @return           Verdict, or Errcode if failure
+ * @retval NPNT_FENCE_INSIDE     position is permitted
+ *         NPNT_FENCE_OUTSIDE    position outside all inclusion zones
+ *         NPNT_FENCE_EXCLUDED   position inside exclusion zone zone_id
+ *         NPNT_BAD_FENCE        no fence set
+ *
+ * @iclass fence_iface
+ */
+int8_t npnt_track_position(npnt_s *handle, float lat, float lon, uint32_t* zone_id);
+
+/**
+ * @brief   Resets breach tracker state and counters.
+ * @details Not needed when the zone set or active permit changes, the
+ *          tracker notices that on its next sample. Clears the counters.
+ *
+ * @param[in] npnt_handle        npnt handle
+ *
+ * @iclass fence_iface
+ */
+void npnt_track_reset(npnt_s *handle);
+
+/**
+ * @brief   Returns margin to the fence and ceiling.
+ * @details Computes signed distance to the nearest fence edge and to the
+ *          altitude ceiling, and the time until the current velocity
+ *          carries the aircraft out of the permitted volume. Distances
+ *          cover the boundaries of every zone. Zone and edge lookups go
+ *          through the indexes built at load time, so only edges near the
+ *          position or along the velocity ray are visited.
+ *
+ * @param[in]  npnt_handle        npnt handle
+ * @param[in]  lat                latitude in degrees
+ * @param[in]  lon                longitude in degrees
+ * @param[in]  altitude_agl       altitude in meters Above Ground Level
+ * @param[in]  vel_n              velocity north in m/s
+ * @param[in]  vel_e              velocity east in m/s
+ * @param[in]  vel_d              velocity down in m/s
+ * @param[out] margin             computed margins
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_BAD_FENCE   no indexed fence is set
+ *
+ * @iclass fence_iface
+ */
+int8_t npnt_fence_margin(npnt_s *handle, float lat, float lon, float altitude_agl,
+                         float vel_n, float vel_e, float vel_d, npnt_fence_margin_s *margin);
+
+/** @} */
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif //FENCE_IFACE_H
@@ -1,10 +1,11 @@
 /*
  *  This Source Code Form is subject to the terms of the Mozilla Public
  *  License, v. 2.0. If a copy of the MPL was not distributed with this
- *  file, You can obtain one at http://mozilla.org/MPL/2.0/. 
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
-
+#ifndef LOG_IFACE_H
+#define LOG_IFACE_H
  /**
  * @file    inc/log_iface.h
  * @brief   Interface definitions for NPNT Breach logging
@@ -13,8 +14,291 @@
 
 
 #include <defines.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
 
 //User Implemented Methods
+/**
+ * @brief   Writes breach log records to storage.
+ * @details Called by npnt_log_flush on the flusher's thread with records
+ *          in the order they were logged, never from the flight loop.
+ *          Records stay in the log until this returns success, so a
+ *          failed write is retried by the next flush.
+ *
+ * @param[in] records            logged evaluations
+ * @param[in] count              number of records, at least 1
+ *
+ * @return           -Errorcode if failure, 0 if all records were stored
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_log_write(const npnt_breach_snapshot_s *records, uint32_t count);
+
+//Implemented by libnpnt
+/**
+ * @brief   Attaches breach log ring to handle.
+ * @details The ring is caller storage, sizeof(npnt_log_s) grows with
+ *          NPNT_LOG_SIZE, so handles without a flusher carry no log at
+ *          all. It is cleared here and must outlive the handle or the
+ *          next npnt_log_init. npnt_reset_handle detaches it. Call it
+ *          before the flight loop starts evaluating.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] log                ring storage, NULL to stop logging
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_UNALLOC_HANDLE  no handle
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_log_init(npnt_s *npnt_handle, npnt_log_s *log);
+
+/**
+ * @brief   Moves logged breach evaluations to storage.
+ * @details npnt_breach_evaluate logs every evaluation with one of the
+ *          NPNT_LOG_TRACK bits set, and every other change of the breach
+ *          word once, into the ring given to npnt_log_init.
+ *          Logging takes no locks, allocations or system calls, when the
+ *          ring is full the record is dropped and counted instead.
+ *          This method hands the waiting records to npnt_log_write, at
+ *          most two calls per flush as the ring wraps. Call it from a
+ *          single thread other than the flight loop, concurrently with
+ *          npnt_breach_evaluate but not with npnt_reset_handle.
+ *
+ * @param[in] npnt_handle        npnt handle
+ *
+ * @return           -Errcode of failure, number of records stored otherwise,
+ *                   0 without a ring
+ * @retval NPNT_UNALLOC_HANDLE  no handle
+ *         NPNT_INV_STATE       npnt_log_write failed, unstored records are kept
+ *
+ * @iclass log_iface
+ */
+int32_t npnt_log_flush(npnt_s *npnt_handle);
+
+/**
+ * @brief   Copies logged breach evaluations out of the log.
+ * @details Alternative to npnt_log_flush for flushers that format the
+ *          records themselves, the same single consumer rule applies.
+ *
+ * @param[in]  npnt_handle       npnt handle
+ * @param[out] records           room for max records
+ * @param[in]  max               records to take at most
+ *
+ * @return           Number of records copied, 0 if the log is empty
+ *
+ * @iclass log_iface
+ */
+uint32_t npnt_log_read(npnt_s *npnt_handle, npnt_breach_snapshot_s *records, uint32_t max);
+
+/**
+ * @brief   Returns number of breach evaluations lost to a full log.
+ *
+ * @param[in] npnt_handle        npnt handle
+ *
+ * @return           Records dropped since npnt_log_init
+ *
+ * @iclass log_iface
+ */
+uint32_t npnt_log_dropped(npnt_s *npnt_handle);
+
+#if defined(__unix__) || defined(__APPLE__)
+/**
+ * @brief   Opens or creates flight log.
+ * @details POSIX hosts only, see src/flight_log.c.
+ *          Maps the whole log file. A new file gets room for capacity
+ *          records up front, so appending never grows it. An existing log
+ *          is reopened with its own capacity, batch and seed, after its hash
+ *          chain is checked against every record; a record appended right
+ *          before a crash but not yet counted is taken over if the chain
+ *          covers it. Batch roots are rebuilt from the records.
+ *
+ * @param[out] log               log state
+ * @param[in]  path              log file
+ * @param[in]  capacity          records a new log has room for
+ * @param[in]  batch             records per Merkle batch of a new log, a power of two
+ *                               up to 2^NPNT_FLOG_MAX_DEPTH, 0 for the chain only
+ * @param[in]  seed              NPNT_FLOG_HASH_LEN bytes a new chain starts from,
+ *                               typically the chain of the previous log, NULL for zeros
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE      file could not be created or mapped, or bad batch
+ *         NPNT_PARSE_FAILED   file is not a flight log of this version
+ *         NPNT_INV_DGST       records do not match the hash chain
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_flight_log_open(npnt_flight_log_s* log, const char* path, uint32_t capacity, uint32_t batch,
+                            const uint8_t* seed);
+
+/**
+ * @brief   Appends record to flight log.
+ * @details Writes the record into the mapping and extends the hash chain
+ *          with it, one SHA1 over NPNT_FLOG_HASH_LEN + 32 bytes. With batches
+ *          it also adds the leaf to the open batch, one more SHA1 and one
+ *          node on average, and stores the root once the batch is complete.
+ *          No system calls, the kernel writes the pages back, npnt_flight_log_sync
+ *          forces it. Uses the reset/update/final_sha1 helpers, so it must
+ *          not run concurrently with npnt_set_permart.
+ *
+ * @param[in] log                log state
+ * @param[in] type               NPNT_FLOG_*
+ * @param[in] snapshot           time, position and breach bits to record
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   log not open or full
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_flight_log_append(npnt_flight_log_s* log, uint8_t type, const npnt_breach_snapshot_s* snapshot);
+
+/**
+ * @brief   Writes flight log to storage.
+ *
+ * @param[in] log                log state
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   log not open or write back failed
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_flight_log_sync(npnt_flight_log_s* log);
+
+/**
+ * @brief   Signs flight log.
+ * @details Passes the current chain value to npnt_sign_raw_data, the
+ *          cost does not depend on the length of the log.
+ *
+ * @param[in]     npnt_handle    npnt handle
+ * @param[in]     log            log state
+ * @param[out]    signature      signature of the chain value
+ * @param[in,out] signature_len  room in signature, updated to its length
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   log not open
+ *         NPNT_INV_SIGN    npnt_sign_raw_data failed
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_flight_log_sign(npnt_s* npnt_handle, npnt_flight_log_s* log, uint8_t* signature, uint16_t* signature_len);
+
+/**
+ * @brief   Returns Merkle root of a batch.
+ * @details Complete batches return their stored root, the open batch the
+ *          root over its records so far, folded from its complete subtrees.
+ *
+ * @param[in]  log               log state
+ * @param[in]  batch_no          batch, record seq / batch
+ * @param[out] root              NPNT_FLOG_HASH_LEN bytes
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   log not open, without batches, or batch has no records
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_flight_log_batch_root(const npnt_flight_log_s* log, uint32_t batch_no, uint8_t* root);
+
+/**
+ * @brief   Signs Merkle root of a batch.
+ * @details Passes the root from npnt_flight_log_batch_root to
+ *          npnt_sign_raw_data, one signature covers the whole batch.
+ *
+ * @param[in]     npnt_handle    npnt handle
+ * @param[in]     log            log state
+ * @param[in]     batch_no       batch, record seq / batch
+ * @param[out]    signature      signature of the root
+ * @param[in,out] signature_len  room in signature, updated to its length
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   no such batch
+ *         NPNT_INV_SIGN    npnt_sign_raw_data failed
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_flight_log_sign_batch(npnt_s* npnt_handle, const npnt_flight_log_s* log, uint32_t batch_no,
+                                  uint8_t* signature, uint16_t* signature_len);
+
+/**
+ * @brief   Builds inclusion proof of a record.
+ * @details Rehashes the records of the record's batch, as far as they are
+ *          logged, into a scratch buffer from npnt_malloc. The proof is
+ *          checked against the root npnt_flight_log_batch_root returns at
+ *          the same count.
+ *
+ * @param[in]  log               log state
+ * @param[in]  seq               record
+ * @param[out] proof             proof
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   log not open, without batches, record not logged
+ *                          or out of memory
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_flight_log_proof(const npnt_flight_log_s* log, uint32_t seq, npnt_flight_proof_s* proof);
+
+/**
+ * @brief   Checks a record against a batch root.
+ * @details Needs neither the log nor the other records, depth SHA1s.
+ *
+ * @param[in] record             record as logged
+ * @param[in] proof              from npnt_flight_log_proof
+ * @param[in] root               signed batch root
+ *
+ * @return           Errcode of failure, 0 if the record is in the batch
+ * @retval NPNT_INV_DGST    record, proof and root do not match
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_flight_log_verify_proof(const npnt_flight_record_s* record, const npnt_flight_proof_s* proof,
+                                    const uint8_t* root);
+
+/**
+ * @brief   Exports flight log in the regulator's JSON format.
+ * @details Writes {"FlightLog":{"PermissionArtefact", "previous_log_hash",
+ *          "LogHash", "LogEntries":[...]}, "Signature"} in one pass over
+ *          the mapped records. Entry_type is TAKEOFF/ARM, LAND/DISARM,
+ *          TIME_BREACH for breaches of the time window only and
+ *          GEOFENCE_BREACH for all other breaches. Logs with batches add
+ *          "BatchSize" and "BatchRoots", the open batch's root last. Hashes
+ *          are hex, the signature base64.
+ *
+ * @param[in] log                log state
+ * @param[in] fp                 open file, stays owned by the caller
+ * @param[in] permission_id      artefact the flight was made under
+ * @param[in] signature          from npnt_flight_log_sign, NULL to leave it empty
+ * @param[in] signature_len      length of signature
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   log not open or write failed
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_flight_log_export(const npnt_flight_log_s* log, FILE* fp, const char* permission_id,
+                              const uint8_t* signature, uint16_t signature_len);
+
+/**
+ * @brief   Syncs, unmaps and closes flight log.
+ *
+ * @param[in] log                log state
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   log not open or write back failed
+ *
+ * @iclass log_iface
+ */
+int8_t npnt_flight_log_close(npnt_flight_log_s* log);
+#endif
 
+/** @} */
+#ifdef __cplusplus
+} // extern "C"
+#endif
 
- /** @} */
+#endif //LOG_IFACE_H
@@ -0,0 +1,167 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef MEMORY_IFACE_H
+#define MEMORY_IFACE_H
+ /**
+ * @file    inc/memory_iface.h
+ * @brief   Interface definitions for NPNT memory allocation
+ * @{
+ */
+
+#include <defines.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//Implemented by libnpnt
+/**
+ * @brief   Allocates memory for the library.
+ * @details Every allocation of libnpnt, and of the bundled XML parser in
+ *          the static profile, goes through these calls. By default they
+ *          forward to the C heap. Built with NPNT_STATIC_MEMORY they carve
+ *          blocks out of a static pool of NPNT_POOL_SIZE bytes: one free
+ *          list per power of two size class, so allocating and freeing
+ *          take a bounded number of steps and repeated load and reset
+ *          cycles settle on the same blocks. Not thread safe, only the
+ *          loading thread allocates.
+ *
+ * @param[in] size               bytes
+ *
+ * @return           Memory, NULL if exhausted
+ *
+ * @iclass memory_iface
+ */
+void* npnt_malloc(size_t size);
+
+/**
+ * @brief   Allocates zeroed memory for the library.
+ *
+ * @param[in] nmemb              number of elements
+ * @param[in] size               bytes per element
+ *
+ * @return           Memory, NULL if exhausted or nmemb * size overflows
+ *
+ * @iclass memory_iface
+ */
+void* npnt_calloc(size_t nmemb, size_t size);
+
+/**
+ * @brief   Resizes memory from npnt_malloc.
+ * @details Same contract as realloc. In the static profile a block is
+ *          kept while the new size still fits its class.
+ *
+ * @param[in] ptr                memory to resize, may be NULL
+ * @param[in] size               bytes
+ *
+ * @return           Memory, NULL if exhausted and ptr left untouched
+ *
+ * @iclass memory_iface
+ */
+void* npnt_realloc(void* ptr, size_t size);
+
+/**
+ * @brief   Allocates aligned memory for the library.
+ *
+ * @param[in] align              power of two alignment in bytes
+ * @param[in] size               bytes
+ *
+ * @return           Memory, release with npnt_free, NULL if exhausted
+ *
+ * @iclass memory_iface
+ */
+void* npnt_aligned_alloc(size_t align, size_t size);
+
+/**
+ * @brief   Duplicates string with npnt_malloc.
+ *
+ * @param[in] str                nul terminated string
+ *
+ * @return           Copy, NULL if exhausted
+ *
+ * @iclass memory_iface
+ */
+char* npnt_strdup(const char* str);
+
+/**
+ * @brief   Releases memory from any of the calls above.
+ *
+ * @param[in] ptr                memory, may be NULL
+ *
+ * @iclass memory_iface
+ */
+void npnt_free(void* ptr);
+
+/**
+ * @brief   Reports library heap usage.
+ * @details The peak after loading the largest expected artefacts is what
+ *          NPNT_POOL_SIZE has to cover in the static profile. Every
+ *          allocation is also booked to the loading stage that made it,
+ *          NPNT_MEM_DECODE to NPNT_MEM_PARAMS inside npnt_set_permart and
+ *          npnt_permit_add, NPNT_MEM_OTHER elsewhere, so stage live bytes
+ *          show what each stage leaves behind once loading is done.
+ *
+ * @param[out] stats             usage counters
+ *
+ * @iclass memory_iface
+ */
+void npnt_mem_stats(npnt_mem_stats_s* stats);
+
+/**
+ * @brief   Restarts usage counters.
+ * @details Clears allocation, failure and byte counts and drops peaks to
+ *          the bytes still allocated, so the next load is measured on its
+ *          own.
+ *
+ * @iclass memory_iface
+ */
+void npnt_mem_stats_reset(void);
+
+/**
+ * @brief   Writes usage counters as JSON.
+ * @details One object with the totals of npnt_mem_stats_s and a "stages"
+ *          object holding allocs, bytes, live and peak per stage, keyed
+ *          "other", "decode", "parse", "verify", "fence" and "params".
+ *          Truncated and nul terminated if it does not fit, as snprintf.
+ *
+ * @param[out] buf               output, may be NULL to size it
+ * @param[in]  len               size of buf
+ *
+ * @return           Length of the full JSON text without the nul, -1 if
+ *                   formatting failed
+ *
+ * @iclass memory_iface
+ */
+int32_t npnt_mem_stats_json(char* buf, uint32_t len);
+
+/**
+ * @brief   Replaces the backend of library allocations.
+ * @details The default backend is the C heap, or the static pool with
+ *          NPNT_STATIC_MEMORY. Hooks can route allocations to an RTOS
+ *          heap or count them in a test harness, stage accounting keeps
+ *          working on top of them. Can only be changed while no library
+ *          memory is allocated, that is before the first load or after
+ *          every handle was reset.
+ *
+ * @param[in] hooks              backend, NULL restores the default
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   library memory still allocated, or a hook missing
+ *
+ * @iclass memory_iface
+ */
+int8_t npnt_mem_set_hooks(const npnt_mem_hooks_s* hooks);
+
+/** @} */
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif //MEMORY_IFACE_H
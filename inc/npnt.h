@@ -15,6 +15,11 @@
 #include <log_iface.h>
 #include <security_iface.h>
 #include <control_iface.h>
+#include <fence_iface.h>
+#include <cron_iface.h>
+#include <permit_iface.h>
+#include <memory_iface.h>
+#include <trace_iface.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -22,7 +27,7 @@ extern "C"
 #endif
 //Common helper headers
 void reset_sha1();
-void update_sha1(const char* data, uint16_t data_len);
+void update_sha1(const char* data, uint32_t data_len);
 void final_sha1(char* hash);
 
 #ifdef __cplusplus
@@ -13,6 +13,11 @@
 #include <log_iface.h>
 #include <security_iface.h>
 #include <control_iface.h>
+#include <fence_iface.h>
+#include <cron_iface.h>
+#include <permit_iface.h>
+#include <memory_iface.h>
+#include <trace_iface.h>
 
 
 #ifdef __cplusplus
@@ -32,7 +37,7 @@ extern "C"
  * null terminated to make it easier to use as a C string. The nul terminator is
  * not included in out_len.
  */
-uint8_t* base64_encode(const uint8_t *src, uint16_t len, uint16_t *out_len);
+uint8_t* base64_encode(const uint8_t *src, uint32_t len, uint32_t *out_len);
 
 /**
  * base64_decode - Base64 decode
@@ -42,12 +47,76 @@ uint8_t* base64_encode(const uint8_t *src, uint16_t len, uint16_t *out_len);
  * Returns: Allocated buffer of out_len bytes of decoded data,
  * or %NULL on failure
  *
- * Caller is responsible for freeing the returned buffer.
+ * Caller is responsible for freeing the returned buffer. Returned buffer is
+ * nul terminated so decoded text can be used as a C string. The nul
+ * terminator is not included in out_len.
  */
-uint8_t* base64_decode(const uint8_t *src, uint16_t len, uint16_t *out_len);
+uint8_t* base64_decode(const uint8_t *src, uint32_t len, uint32_t *out_len);
+
+//Proleptic Gregorian calendar, see src/calendar.c
+int64_t npnt_days_from_civil(int32_t year, uint8_t month, uint8_t day);
+void npnt_civil_from_days(int64_t days, int32_t* year, uint8_t* month, uint8_t* day);
+uint8_t npnt_days_in_month(int32_t year, uint8_t month);
 
-int8_t npnt_ist_date_time_to_unix_time(const char* dt_string, struct tm* date_time);
+int8_t npnt_ist_date_time_to_unix_time(const char* dt_string, int64_t* unix_time, struct tm* date_time);
 char* npnt_get_attr(mxml_node_t *node, const char* attr);
+void npnt_digest_canonical(const char* data, int32_t length);
+//Loading steps after raw_permart holds the XML text, shared by the ingest paths
+int8_t npnt_permart_parse(npnt_s *handle);
+int8_t npnt_set_recurrence(npnt_permit_s* permit, const char* expr, const char* type, const char* duration);
+
+//Fence grid index, see src/fence_grid.c
+int8_t npnt_grid_build(npnt_grid_s *grid, const float* vertx, const float* verty, uint32_t nverts);
+void npnt_grid_free(npnt_grid_s *grid);
+bool npnt_grid_contains(const npnt_grid_s *grid, const float* vertx, const float* verty, uint32_t nverts,
+                        float x, float y);
+float npnt_grid_nearest_edge(const npnt_grid_s *grid, const float* vertx, const float* verty, uint32_t nverts,
+                             float x, float y, uint32_t* edge);
+float npnt_grid_raycast(const npnt_grid_s *grid, const float* vertx, const float* verty, uint32_t nverts,
+                        float x, float y, float dx, float dy);
+float npnt_seg_dist_sq(float px, float py, float ax, float ay, float bx, float by);
+
+//Fence raster mask, see src/fence_raster.c
+int8_t npnt_raster_build(npnt_raster_s *raster, const npnt_zone_s *zone, float cell, uint32_t max_bytes);
+void npnt_raster_free(npnt_raster_s *raster);
+uint8_t npnt_raster_lookup(const npnt_raster_s *raster, float x, float y);
+
+//Fence cleanup and validation, see src/fence_norm.c
+int8_t npnt_fence_normalize(float* vertx, float* verty, float* lat, float* lon, uint32_t* nverts);
+
+//Zone set and bounding volume hierarchy, see src/fence_set.c
+int8_t npnt_fence_set_add(npnt_fence_set_s *set, uint8_t kind, uint32_t id, float* vertx, float* verty, uint32_t nverts);
+int8_t npnt_fence_set_build(npnt_fence_set_s *set);
+void npnt_fence_set_free(npnt_fence_set_s *set);
+int8_t npnt_fence_set_query(const npnt_fence_set_s *set, float x, float y, uint32_t* zone_idx);
+float npnt_fence_set_nearest(const npnt_fence_set_s *set, float x, float y, uint32_t* zone_idx, uint32_t* edge);
+float npnt_fence_set_raycast(const npnt_fence_set_s *set, float x, float y, float dx, float dy);
+
+//Permit records and store, see src/permit_store.c
+void npnt_permit_free(npnt_permit_s *permit);
+void npnt_permit_switch(npnt_s *handle, const npnt_permit_s *permit);
+void npnt_permit_synchronize(npnt_s *handle);
+void npnt_permit_store_free(npnt_permit_store_s *store);
+
+//Breach log producer, called by the evaluator after publishing, see src/logger.c
+void npnt_log_breach(npnt_log_s *log, const npnt_breach_snapshot_s *snapshot);
+
+//Books following allocations to stage NPNT_MEM_*, returns the previous stage
+uint8_t npnt_mem_stage(uint8_t stage);
+
+//Loading stage tracepoints, nothing is left of them without NPNT_TRACE
+#ifdef NPNT_TRACE
+void npnt_trace_emit(uint8_t stage, bool begin);
+#define NPNT_TRACE_BEGIN(stage)     npnt_trace_emit(stage, true)
+#define NPNT_TRACE_END(stage)       npnt_trace_emit(stage, false)
+#else
+#define NPNT_TRACE_BEGIN(stage)     do { } while (0)
+#define NPNT_TRACE_END(stage)       do { } while (0)
+#endif
+
+//Readers of a permit picked up inside npnt_permit_read_begin/end
+int8_t npnt_track_permit(npnt_s *handle, const npnt_permit_s *permit, float lat, float lon, uint32_t* zone_id);
+int8_t npnt_recurrence_permit(npnt_s *handle, const npnt_permit_s *permit, int64_t now, int64_t* next_start);
 
 #ifdef __cplusplus
 } // extern "C"
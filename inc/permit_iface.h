@@ -0,0 +1,200 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef PERMIT_IFACE_H
+#define PERMIT_IFACE_H
+ /**
+ * @file    inc/permit_iface.h
+ * @brief   Interface definitions for NPNT permit store
+ * @{
+ */
+
+#include <defines.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//Implemented by libnpnt
+/**
+ * @brief   Adds permission artefact to the permit store.
+ * @details Parses, verifies and projects the artefact exactly as
+ *          npnt_set_permart does, then keeps only the resulting permit
+ *          record and drops the raw and parsed XML. Records are indexed
+ *          by flight window and never change afterwards, so any of them
+ *          can be made active without further checks. Adding does not
+ *          change the active permit.
+ *
+ * @param[in] npnt_handle       npnt handle
+ * @param[in] permart           permission artefact
+ * @param[in] permart_length    size of permission artefact
+ * @param[in] base64_encoded    1 if permart is base64 encoded
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_ALREADY_SET   artefact with same adcNumber, ficNumber and
+ *                            flight window already in store
+ *         NPNT_PARSE_FAILED  allocation failed or store already holds
+ *                            NPNT_MAX_PERMITS permits
+ *         other              as npnt_set_permart
+ *
+ * @iclass permit_iface
+ */
+int8_t npnt_permit_add(npnt_s *handle, uint8_t *permart, uint32_t permart_length, uint8_t base64_encoded);
+
+/**
+ * @brief   Returns number of permits in the store.
+ *
+ * @param[in] npnt_handle        npnt handle
+ *
+ * @return           Number of stored permits
+ *
+ * @iclass permit_iface
+ */
+uint16_t npnt_permit_count(npnt_s *handle);
+
+/**
+ * @brief   Returns stored permit by index.
+ * @details Permits are ordered by flight window start. Indices shift
+ *          when permits are added, the returned records do not move.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] index              index below npnt_permit_count
+ *
+ * @return           Permit record, NULL if index out of range
+ *
+ * @iclass permit_iface
+ */
+const npnt_permit_s* npnt_permit_get(npnt_s *handle, uint16_t index);
+
+/**
+ * @brief   Makes permit active.
+ * @details Breach evaluation, fence queries and the recurring window use
+ *          the active permit. Switching is one atomic pointer store, safe
+ *          while another thread evaluates breaches: a pass that already
+ *          began finishes on the previous permit, the next one picks up
+ *          the new permit and restarts the breach tracker and recurrence
+ *          cache. Store changes and activation have to come from a single
+ *          loading thread.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] permit             stored permit, or &npnt_handle->permit
+ *                               once npnt_set_permart succeeded
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   permit does not belong to this handle
+ *
+ * @iclass permit_iface
+ */
+int8_t npnt_permit_activate(npnt_s *handle, const npnt_permit_s *permit);
+
+/**
+ * @brief   Removes permit from the store and frees it.
+ * @details Waits until every read section that could still hold the
+ *          permit has ended, then frees it. Never blocks readers.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] permit             stored permit, not the active one
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   permit is active or not in store
+ *
+ * @iclass permit_iface
+ */
+int8_t npnt_permit_remove(npnt_s *handle, const npnt_permit_s *permit);
+
+/**
+ * @brief   Frees stored permits whose flight window ended.
+ * @details Same as npnt_permit_remove for every permit whose window ended
+ *          before now, except the active one, with a single wait for
+ *          readers.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] now                UTC epoch seconds
+ *
+ * @return           Number of permits freed
+ *
+ * @iclass permit_iface
+ */
+uint16_t npnt_permit_prune(npnt_s *handle, int64_t now);
+
+/**
+ * @brief   Activates next stored permit.
+ * @details Picks the stored permit following the active one in flight
+ *          window order, skipping permits whose window ended before now.
+ *          If the active permit is not from the store, picks the first
+ *          permit whose window has not ended.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] now                UTC epoch seconds
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   no later permit in store, active permit unchanged
+ *
+ * @iclass permit_iface
+ */
+int8_t npnt_permit_next(npnt_s *handle, int64_t now);
+
+/**
+ * @brief   Activates stored permit covering time and position.
+ * @details Looks up the permits whose flight window, and recurring window
+ *          if any, holds now, with a binary search over window starts.
+ *          Among those the first one whose fence permits the position is
+ *          made active, otherwise the first one by window start, so that
+ *          breach evaluation reports the fence breach. Meant to be called
+ *          before arming and between sorties.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] now                UTC epoch seconds
+ * @param[in] lat                latitude in degrees
+ * @param[in] lon                longitude in degrees
+ *
+ * @return           Verdict of the position against the selected permit,
+ *                   or Errcode if failure
+ * @retval NPNT_FENCE_INSIDE     position is permitted
+ *         NPNT_FENCE_OUTSIDE    no covering permit holds the position
+ *         NPNT_FENCE_EXCLUDED   no covering permit holds the position
+ *         NPNT_INV_STATE        no permit covers now, active permit unchanged
+ *
+ * @iclass permit_iface
+ */
+int8_t npnt_permit_select(npnt_s *handle, int64_t now, float lat, float lon);
+
+/**
+ * @brief   Begins read section on the active permit.
+ * @details The returned permit stays valid until the matching
+ *          npnt_permit_read_end, whatever the loading thread does in the
+ *          meantime. One atomic increment and two loads, no locks, safe
+ *          from an ISR. Sections may nest but must be short, the loading
+ *          thread waits for them before freeing a permit.
+ *
+ * @param[in]  npnt_handle        npnt handle
+ * @param[out] slot               token to pass to npnt_permit_read_end
+ *
+ * @return           Active permit, NULL if none
+ *
+ * @iclass permit_iface
+ */
+const npnt_permit_s* npnt_permit_read_begin(npnt_s *handle, uint8_t* slot);
+
+/**
+ * @brief   Ends read section.
+ *
+ * @param[in] npnt_handle        npnt handle
+ * @param[in] slot               token from npnt_permit_read_begin
+ *
+ * @iclass permit_iface
+ */
+void npnt_permit_read_end(npnt_s *handle, uint8_t slot);
+
+/** @} */
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif //PERMIT_IFACE_H
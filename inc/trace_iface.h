@@ -0,0 +1,102 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef TRACE_IFACE_H
+#define TRACE_IFACE_H
+ /**
+ * @file    inc/trace_iface.h
+ * @brief   Interface definitions for NPNT loading stage traces
+ * @{
+ */
+
+#include <defines.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//Implemented by libnpnt
+/**
+ * @brief   Registers receiver of loading stage events.
+ * @details npnt_set_permart reports the start and end of each
+ *          NPNT_TRACE_* stage with a monotonic timestamp, every start is
+ *          matched by an end, also when the stage fails. The callback runs
+ *          on the loading thread and should only record the event.
+ *          Timestamps come from clock_gettime(CLOCK_MONOTONIC) unless
+ *          NPNT_TRACE_CLOCK_NS() is defined to another nanosecond clock.
+ *          Tracepoints only exist in builds with NPNT_TRACE defined,
+ *          otherwise they compile to nothing and registering fails.
+ *
+ * @param[in] cb                 receiver, NULL stops tracing
+ * @param[in] ctx                passed to cb with each event
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   library built without NPNT_TRACE
+ *
+ * @iclass trace_iface
+ */
+int8_t npnt_trace_set_callback(npnt_trace_cb cb, void* ctx);
+
+/**
+ * @brief   Returns name of a loading stage.
+ *
+ * @param[in] stage              NPNT_TRACE_*
+ *
+ * @return           Name, "unknown" for other values
+ *
+ * @iclass trace_iface
+ */
+const char* npnt_trace_stage_name(uint8_t stage);
+
+/**
+ * @brief   Starts Chrome trace file.
+ * @details Writes the head of a JSON trace that chrome://tracing and
+ *          Perfetto open. Register npnt_trace_chrome_event with the sink
+ *          as context, and finish the file with npnt_trace_chrome_close.
+ *
+ * @param[out] sink              sink state
+ * @param[in]  fp                open file, stays owned by the caller
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   write failed
+ *
+ * @iclass trace_iface
+ */
+int8_t npnt_trace_chrome_open(npnt_trace_chrome_s* sink, FILE* fp);
+
+/**
+ * @brief   Writes one event as Chrome trace duration event.
+ * @details Trace callback, ctx is the npnt_trace_chrome_s sink.
+ *
+ * @param[in] ev                 event
+ * @param[in] ctx                sink
+ *
+ * @iclass trace_iface
+ */
+void npnt_trace_chrome_event(const npnt_trace_event_s* ev, void* ctx);
+
+/**
+ * @brief   Finishes Chrome trace file.
+ *
+ * @param[in] sink               sink state
+ *
+ * @return           Errcode of failure, 0 if successful
+ * @retval NPNT_INV_STATE   write failed
+ *
+ * @iclass trace_iface
+ */
+int8_t npnt_trace_chrome_close(npnt_trace_chrome_s* sink);
+
+/** @} */
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif //TRACE_IFACE_H
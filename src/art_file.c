@@ -0,0 +1,110 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+
+//File ingest maps the artefact, POSIX hosts only
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//Maps the file read only, followed by at least one zero byte so the text ends like a C string
+static char* permart_map(const char *path, uint32_t *length, size_t *map_len)
+{
+    struct stat st;
+    size_t page;
+    char *map;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size <= 0 || (uint64_t)st.st_size >= UINT32_MAX) {
+        close(fd);
+        return NULL;
+    }
+    *length = (uint32_t)st.st_size;
+    //file pages over an anonymous zero page, the tail of the last file page reads as zeros too
+    page = (size_t)sysconf(_SC_PAGESIZE);
+    *map_len = (*length / page + 1) * page;
+    map = (char*)mmap(NULL, *map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map != MAP_FAILED &&
+        mmap(map, *length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(map, *map_len);
+        map = MAP_FAILED;
+    }
+    close(fd);
+    return map == MAP_FAILED ? NULL : map;
+}
+
+static int8_t permart_load_file(npnt_s *handle, const char *path)
+{
+    uint32_t length, i;
+    size_t map_len;
+    char *map;
+
+    if (handle->raw_permart) {
+        return NPNT_ALREADY_SET;
+    }
+    if (!path) {
+        return NPNT_INV_ART;
+    }
+    NPNT_TRACE_BEGIN(NPNT_TRACE_DECODE);
+    map = permart_map(path, &length, &map_len);
+    if (!map) {
+        NPNT_TRACE_END(NPNT_TRACE_DECODE);
+        return NPNT_INV_ART;
+    }
+#if NPNT_MAX_PERMART_SIZE < UINT32_MAX
+    if (length > NPNT_MAX_PERMART_SIZE) {
+        munmap(map, map_len);
+        NPNT_TRACE_END(NPNT_TRACE_DECODE);
+        return NPNT_INV_ART;
+    }
+#endif
+
+    //XML starts with its declaration or root element past whitespace and BOM, base64 never has '<'
+    for (i = 0; i < length && isspace((unsigned char)map[i]); i++);
+    if (length - i >= 3 && memcmp(&map[i], "\xef\xbb\xbf", 3) == 0) {
+        i += 3;
+    }
+    if (i < length && map[i] == '<') {
+        handle->raw_permart = map;
+        handle->raw_permart_len = length;
+        handle->raw_permart_map_len = map_len;
+    } else {
+        handle->raw_permart = (char*)base64_decode((const uint8_t*)map, length, &handle->raw_permart_len);
+        munmap(map, map_len);
+    }
+    NPNT_TRACE_END(NPNT_TRACE_DECODE);
+    if (!handle->raw_permart) {
+        return NPNT_PARSE_FAILED;
+    }
+    return npnt_permart_parse(handle);
+}
+
+int8_t npnt_set_permart_file(npnt_s *handle, const char *path)
+{
+    uint8_t stage;
+    int8_t ret;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    stage = npnt_mem_stage(NPNT_MEM_DECODE);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_LOAD);
+    ret = permart_load_file(handle, path);
+    NPNT_TRACE_END(NPNT_TRACE_LOAD);
+    npnt_mem_stage(stage);
+    return ret;
+}
+
+#endif
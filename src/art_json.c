@@ -0,0 +1,337 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#include <npnt.h>
+#include <jsmn/jsmn.h>
+
+/*
+ * JSON permission artefacts. The envelope is
+ *   {"artefact": "<base64 permission>", "signature": "<base64 signature>"}
+ * with the signature made over the digest of the artefact string as sent.
+ * The permission keeps the names of the XML artefact, elements become
+ * objects, attributes members and Coordinates an array:
+ *   {"UAPermission":{"Permission":{"FlightDetails":{
+ *       "UADetails":{"uinNo":"..."},
+ *       "FlightParameters":{"adcNumber":"...","ficNumber":"...",
+ *           "flightStartTime":"...","flightEndTime":"...","maxAltitude":19,
+ *           "recurrenceTimeExpression":"","recurrenceTimeExpressionType":"CRON_QUARTZ",
+ *           "recurringTimeDurationInMinutes":"",
+ *           "Coordinates":[{"latitude":18.8086,"longitude":78.4426}, ...]}}}}}
+ *
+ * Both documents are tokenized by jsmn into one static token array and the
+ * permit is filled straight from the tokens, there is no tree and nothing
+ * to canonicalize. Values are terminated in place in the decoded copy.
+ * Like the XML path with its digest helpers, loading is not reentrant.
+ * The Makefiles build jsmn with JSMN_PARENT_LINKS, without them closing
+ * each coordinate rescans all earlier tokens and parsing is quadratic.
+ */
+
+static jsmntok_t json_tokens[NPNT_JSON_MAX_TOKENS];
+
+static bool json_eq(const char* js, const jsmntok_t* tok, const char* str)
+{
+    size_t len = strlen(str);
+    return tok->type == JSMN_STRING && (size_t)(tok->end - tok->start) == len &&
+           strncmp(js + tok->start, str, len) == 0;
+}
+
+//Index of the token following tok[i] and everything nested in it
+static int32_t json_skip(const jsmntok_t* tok, int32_t i, int32_t ntok)
+{
+    int32_t pending = tok[i].size;
+
+    for (i++; pending > 0 && i < ntok; i++) {
+        pending += tok[i].size - 1;
+    }
+    return i;
+}
+
+//Value of member key of the object at obj, -1 if missing
+static int32_t json_member(const char* js, const jsmntok_t* tok, int32_t ntok, int32_t obj, const char* key)
+{
+    int32_t i, n;
+
+    if (obj < 0 || tok[obj].type != JSMN_OBJECT) {
+        return -1;
+    }
+    i = obj + 1;
+    for (n = 0; n < tok[obj].size && i + 1 < ntok; n++) {
+        if (json_eq(js, &tok[i], key)) {
+            return i + 1;
+        }
+        i = json_skip(tok, i + 1, ntok);
+    }
+    return -1;
+}
+
+//First object named key at any depth, as mxmlFindElement with MXML_DESCEND
+static int32_t json_find(const char* js, const jsmntok_t* tok, int32_t ntok, const char* key)
+{
+    int32_t i;
+
+    for (i = 0; i + 1 < ntok; i++) {
+        if (tok[i].size == 1 && tok[i + 1].type == JSMN_OBJECT && json_eq(js, &tok[i], key)) {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+//String or number value as C string, terminated in place
+static const char* json_value(char* js, const jsmntok_t* tok, int32_t i)
+{
+    if (i < 0 || (tok[i].type != JSMN_STRING && tok[i].type != JSMN_PRIMITIVE)) {
+        return NULL;
+    }
+    js[tok[i].end] = '\0';
+    return js + tok[i].start;
+}
+
+static char* json_dup(char* js, const jsmntok_t* tok, int32_t i)
+{
+    const char* value = json_value(js, tok, i);
+    char* ret;
+
+    if (!value || strlen(value) > NPNT_MAX_STR_LEN) {
+        return NULL;
+    }
+    ret = (char*)npnt_malloc(strlen(value) + 1);
+    if (!ret) {
+        return NULL;
+    }
+    strcpy(ret, value);
+    return ret;
+}
+
+static int8_t json_fence(npnt_s* handle, char* js, int32_t ntok, int32_t params)
+{
+    const jsmntok_t* tok = json_tokens;
+    const char *lat_str, *lon_str;
+    float *vertlat, *vertlon;
+    int32_t coords, i;
+    uint32_t nverts, n;
+
+    coords = json_member(js, tok, ntok, params, "Coordinates");
+    if (coords < 0 || tok[coords].type != JSMN_ARRAY) {
+        return -1;
+    }
+    nverts = (uint32_t)tok[coords].size;
+    if (nverts == 0 || nverts > NPNT_MAX_FENCE_VERTS) {
+        return -1;
+    }
+    //longitudes follow latitudes in the same block
+    vertlat = (float*)npnt_malloc(2*nverts*sizeof(float));
+    if (!vertlat) {
+        return -1;
+    }
+    vertlon = vertlat + nverts;
+    i = coords + 1;
+    for (n = 0; n < nverts; n++) {
+        lat_str = json_value(js, tok, json_member(js, tok, ntok, i, "latitude"));
+        lon_str = json_value(js, tok, json_member(js, tok, ntok, i, "longitude"));
+        if (!lat_str || !lon_str) {
+            goto fail;
+        }
+        vertlat[n] = atof(lat_str);
+        vertlon[n] = atof(lon_str);
+        i = json_skip(tok, i, ntok);
+    }
+    handle->permit.info->vertlat = vertlat;
+    handle->permit.info->vertlon = vertlon;
+    handle->permit.info->nverts = nverts;
+    return 0;
+fail:
+    npnt_free(vertlat);
+    return -1;
+}
+
+static int8_t json_flight_params(npnt_s* handle, char* js, int32_t ntok, int32_t params)
+{
+    const jsmntok_t* tok = json_tokens;
+    npnt_permit_info_s* info = handle->permit.info;
+    int32_t ua_detail;
+
+    ua_detail = json_find(js, tok, ntok, "UADetails");
+    info->uinNo = json_dup(js, tok, json_member(js, tok, ntok, ua_detail, "uinNo"));
+    if (!info->uinNo) {
+        return NPNT_INV_FPARAMS;
+    }
+    info->adcNumber = json_dup(js, tok, json_member(js, tok, ntok, params, "adcNumber"));
+    if (!info->adcNumber) {
+        return NPNT_INV_FPARAMS;
+    }
+    info->ficNumber = json_dup(js, tok, json_member(js, tok, ntok, params, "ficNumber"));
+    if (!info->ficNumber) {
+        return NPNT_INV_FPARAMS;
+    }
+    if (npnt_ist_date_time_to_unix_time(json_value(js, tok, json_member(js, tok, ntok, params, "flightEndTime")),
+                                        &handle->permit.flightEnd, &info->flightEndTime) < 0) {
+        return NPNT_INV_FPARAMS;
+    }
+    if (npnt_ist_date_time_to_unix_time(json_value(js, tok, json_member(js, tok, ntok, params, "flightStartTime")),
+                                        &handle->permit.flightStart, &info->flightStartTime) < 0) {
+        return NPNT_INV_FPARAMS;
+    }
+    return npnt_set_recurrence(&handle->permit,
+                               json_value(js, tok, json_member(js, tok, ntok, params, "recurrenceTimeExpression")),
+                               json_value(js, tok, json_member(js, tok, ntok, params, "recurrenceTimeExpressionType")),
+                               json_value(js, tok, json_member(js, tok, ntok, params, "recurringTimeDurationInMinutes")));
+}
+
+//Checks the envelope signature and leaves the decoded permission in raw_permart
+static int8_t json_open_envelope(npnt_s* handle, const char* envelope, uint32_t envelope_length)
+{
+    const jsmntok_t* tok = json_tokens;
+    jsmn_parser parser;
+    int32_t ntok, artefact, signature;
+    uint8_t* raw_signature;
+    uint32_t raw_signature_len;
+    char digest_value[32];      //room for helpers built with SHA-256
+    int8_t ret;
+
+    jsmn_init(&parser);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_PARSE);
+    ntok = jsmn_parse(&parser, envelope, envelope_length, json_tokens, NPNT_JSON_MAX_TOKENS);
+    NPNT_TRACE_END(NPNT_TRACE_PARSE);
+    if (ntok < 1) {
+        return NPNT_PARSE_FAILED;
+    }
+    artefact = json_member(envelope, tok, ntok, 0, "artefact");
+    signature = json_member(envelope, tok, ntok, 0, "signature");
+    if (artefact < 0 || signature < 0 || tok[artefact].type != JSMN_STRING || tok[signature].type != JSMN_STRING) {
+        return NPNT_INV_ART;
+    }
+
+    //the artefact is signed as sent, before decoding
+    npnt_mem_stage(NPNT_MEM_VERIFY);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_PERMISSION);
+    reset_sha1();
+    update_sha1(envelope + tok[artefact].start, (uint32_t)(tok[artefact].end - tok[artefact].start));
+    final_sha1(digest_value);
+    NPNT_TRACE_END(NPNT_TRACE_PERMISSION);
+
+    NPNT_TRACE_BEGIN(NPNT_TRACE_RSA_VERIFY);
+    raw_signature = base64_decode((const uint8_t*)envelope + tok[signature].start,
+                                  (uint32_t)(tok[signature].end - tok[signature].start), &raw_signature_len);
+    if (!raw_signature || raw_signature_len > UINT16_MAX) {
+        ret = NPNT_INV_SIGN;
+    } else {
+        ret = npnt_check_authenticity(handle, (uint8_t*)digest_value, 20, raw_signature,
+                                      (uint16_t)raw_signature_len) <= 0 ? NPNT_INV_AUTH : 0;
+    }
+    NPNT_TRACE_END(NPNT_TRACE_RSA_VERIFY);
+    npnt_free(raw_signature);
+    if (ret < 0) {
+        return ret;
+    }
+
+    npnt_mem_stage(NPNT_MEM_DECODE);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_DECODE);
+    handle->raw_permart = (char*)base64_decode((const uint8_t*)envelope + tok[artefact].start,
+                                               (uint32_t)(tok[artefact].end - tok[artefact].start),
+                                               &handle->raw_permart_len);
+    NPNT_TRACE_END(NPNT_TRACE_DECODE);
+    if (!handle->raw_permart) {
+        return NPNT_PARSE_FAILED;
+    }
+    return 0;
+}
+
+static int8_t json_load(npnt_s *handle, const uint8_t *envelope, uint32_t envelope_length)
+{
+    jsmn_parser parser;
+    int32_t ntok, params;
+    const char* alt_str;
+    char* js;
+    int8_t ret;
+
+    if (handle->raw_permart) {
+        return NPNT_ALREADY_SET;
+    }
+    if (!envelope) {
+        return NPNT_INV_ART;
+    }
+#if NPNT_MAX_PERMART_SIZE < UINT32_MAX
+    if (envelope_length > NPNT_MAX_PERMART_SIZE) {
+        return NPNT_INV_ART;
+    }
+#endif
+    ret = json_open_envelope(handle, (const char*)envelope, envelope_length);
+    if (ret < 0) {
+        return ret;
+    }
+
+    npnt_mem_stage(NPNT_MEM_PARAMS);
+    handle->permit.info = (npnt_permit_info_s*)npnt_calloc(1, sizeof(npnt_permit_info_s));
+    if (!handle->permit.info) {
+        return NPNT_PARSE_FAILED;
+    }
+
+    js = handle->raw_permart;
+    jsmn_init(&parser);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_PARSE);
+    ntok = jsmn_parse(&parser, js, handle->raw_permart_len, json_tokens, NPNT_JSON_MAX_TOKENS);
+    NPNT_TRACE_END(NPNT_TRACE_PARSE);
+    if (ntok < 1) {
+        return ntok == JSMN_ERROR_NOMEM ? NPNT_INV_ART : NPNT_PARSE_FAILED;
+    }
+    params = json_find(js, json_tokens, ntok, "FlightParameters");
+    if (params < 0) {
+        return NPNT_INV_FPARAMS;
+    }
+
+    //Fence points, projected into local frame for metric containment checks
+    npnt_mem_stage(NPNT_MEM_FENCE);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_FENCE);
+    ret = json_fence(handle, js, ntok, params);
+    if (ret == 0) {
+        ret = npnt_fence_project(handle);
+    }
+    NPNT_TRACE_END(NPNT_TRACE_FENCE);
+    if (ret < 0) {
+        handle->permit.info->nverts = 0;
+        return NPNT_BAD_FENCE;
+    }
+
+    //Max altitude and flight params
+    npnt_mem_stage(NPNT_MEM_PARAMS);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_PARAMS);
+    alt_str = json_value(js, json_tokens, json_member(js, json_tokens, ntok, params, "maxAltitude"));
+    if (alt_str) {
+        handle->permit.maxAltitude = atof(alt_str);
+        ret = json_flight_params(handle, js, ntok, params);
+    } else {
+        ret = NPNT_INV_BAD_ALT;
+    }
+    NPNT_TRACE_END(NPNT_TRACE_PARAMS);
+    if (ret < 0) {
+        handle->permit.info->nverts = 0;
+        return ret == NPNT_INV_BAD_ALT ? ret : NPNT_INV_FPARAMS;
+    }
+
+    //Evaluate breaches against the new artefact
+    handle->permit.verified = true;
+    handle->permit.serial = ++handle->rcu.serial;
+    npnt_permit_switch(handle, &handle->permit);
+    return 0;
+}
+
+int8_t npnt_set_permart_json(npnt_s *handle, const uint8_t *envelope, uint32_t envelope_length)
+{
+    uint8_t stage;
+    int8_t ret;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    stage = npnt_mem_stage(NPNT_MEM_PARSE);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_LOAD);
+    ret = json_load(handle, envelope, envelope_length);
+    NPNT_TRACE_END(NPNT_TRACE_LOAD);
+    npnt_mem_stage(stage);
+    return ret;
+}
@@ -8,87 +8,187 @@
 #include <npnt.h>
 #include <mxml.h>
 
-/**
- * @brief   Sets Current Permission Artifact.
- * @details This method consumes peremission artefact in raw format
- *          and sets up npnt structure.
- *
- * @param[in] npnt_handle       npnt handle
- * @param[in] permart           permission json artefact in base64 format as received
- *                              from server
- * @param[in] permart_length    size of permission json artefact in base64 format as received
- *                              from server
- * @param[in] signature         signature of permart in base64 format
- * @param[in] signature_length  length of the signature of permart in base64 format 
- * 
- * @return           Error id if faillure, 0 if no breach
- * @retval NPNT_INV_ART   Invalid Artefact
- *         NPNT_INV_AUTH  signed by unauthorised entity
- *         NPNT_INV_STATE artefact can't setup in current aircraft state
- *         NPNT_ALREADY_SET artefact already set, free previous artefact first
- * @iclass control_iface
- */
-int8_t npnt_set_permart(npnt_s *handle, uint8_t *permart, uint16_t permart_length, uint8_t base64_encoded)
+//Loading steps of npnt_set_permart, allocations are booked to the step making them
+static int8_t permart_load(npnt_s *handle, uint8_t *permart, uint32_t permart_length, uint8_t base64_encoded)
 {
-    if (!handle) {
-        return NPNT_UNALLOC_HANDLE;
-    }
-    int16_t ret = 0;
     //Extract XML from base64 encoded permart
     if (handle->raw_permart) {
         return NPNT_ALREADY_SET;
     }
+#if NPNT_MAX_PERMART_SIZE < UINT32_MAX
+    if (permart_length > NPNT_MAX_PERMART_SIZE) {
+        return NPNT_INV_ART;
+    }
+#endif
+
+    if (!base64_encoded && permart_length == UINT32_MAX) {
+        return NPNT_INV_ART;
+    }
 
+    NPNT_TRACE_BEGIN(NPNT_TRACE_DECODE);
     if (base64_encoded) {
         handle->raw_permart = (char*)base64_decode(permart, permart_length, &handle->raw_permart_len);
-        if (!handle->raw_permart) {
-            return NPNT_PARSE_FAILED;
-        }
     } else {
-        handle->raw_permart = (char*)malloc(permart_length);
-        if (!handle->raw_permart) {
-            return NPNT_PARSE_FAILED;
+        handle->raw_permart = (char*)npnt_malloc(permart_length + 1);
+        if (handle->raw_permart) {
+            memcpy(handle->raw_permart, permart, permart_length);
+            handle->raw_permart[permart_length] = '\0';
+            handle->raw_permart_len = permart_length;
         }
-        memcpy(handle->raw_permart, permart, permart_length);
+    }
+    NPNT_TRACE_END(NPNT_TRACE_DECODE);
+    if (!handle->raw_permart) {
+        return NPNT_PARSE_FAILED;
+    }
+    return npnt_permart_parse(handle);
+}
+
+//Steps after raw_permart holds the XML text
+int8_t npnt_permart_parse(npnt_s *handle)
+{
+    int32_t ret = 0;
+
+    //Cold permit fields live apart from the hot record
+    npnt_mem_stage(NPNT_MEM_PARAMS);
+    handle->permit.info = (npnt_permit_info_s*)npnt_calloc(1, sizeof(npnt_permit_info_s));
+    if (!handle->permit.info) {
+        return NPNT_PARSE_FAILED;
     }
 
     //parse XML permart
+    npnt_mem_stage(NPNT_MEM_PARSE);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_PARSE);
     handle->parsed_permart = mxmlLoadString(NULL, handle->raw_permart, MXML_OPAQUE_CALLBACK);
+    NPNT_TRACE_END(NPNT_TRACE_PARSE);
     if (!handle->parsed_permart) {
         return NPNT_PARSE_FAILED;
     }
 
     //Verify Artifact against Sender's Public Key
+    npnt_mem_stage(NPNT_MEM_VERIFY);
     ret = npnt_verify_permart(handle);
     if (ret < 0) {
         return ret;
     }
 
     //Collect Fence points from verified artefact
-    ret = npnt_alloc_and_get_fence_points(handle, handle->fence.vertlat, handle->fence.vertlon);
-    if (ret <= 0) {
-        handle->fence.nverts = 0;
+    npnt_mem_stage(NPNT_MEM_FENCE);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_FENCE);
+    ret = npnt_alloc_and_get_fence_points(handle, handle->permit.info->vertlat, handle->permit.info->vertlon);
+    if (ret > 0) {
+        handle->permit.info->nverts = ret;
+        //Project fence into local frame for metric containment checks
+        ret = npnt_fence_project(handle);
+    } else {
+        ret = NPNT_BAD_FENCE;
+    }
+    NPNT_TRACE_END(NPNT_TRACE_FENCE);
+    if (ret < 0) {
+        handle->permit.info->nverts = 0;
         return NPNT_BAD_FENCE;
     }
-    handle->fence.nverts = ret;
-    ret = 0;
 
     //Get Max Altitude
-    ret = npnt_get_max_altitude(handle, &handle->fence.maxAltitude);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_PARAMS);
+    ret = npnt_get_max_altitude(handle, &handle->permit.maxAltitude);
     if (ret < 0) {
+        NPNT_TRACE_END(NPNT_TRACE_PARAMS);
         return NPNT_INV_BAD_ALT;
     }
 
     //Set Flight Params from artefact
+    npnt_mem_stage(NPNT_MEM_PARAMS);
     ret = npnt_populate_flight_params(handle);
+    NPNT_TRACE_END(NPNT_TRACE_PARAMS);
     if (ret < 0) {
-        handle->fence.nverts = 0;
+        handle->permit.info->nverts = 0;
         return NPNT_INV_FPARAMS;
     }
+
+    //Evaluate breaches against the new artefact
+    handle->permit.verified = true;
+    handle->permit.serial = ++handle->rcu.serial;
+    npnt_permit_switch(handle, &handle->permit);
     ret = 0;
     return ret;
 }
 
+/**
+ * @brief   Sets Current Permission Artifact.
+ * @details This method consumes peremission artefact in raw format
+ *          and sets up npnt structure.
+ *
+ * @param[in] npnt_handle       npnt handle
+ * @param[in] permart           permission json artefact in base64 format as received
+ *                              from server
+ * @param[in] permart_length    size of permission json artefact in base64 format as received
+ *                              from server
+ * @param[in] signature         signature of permart in base64 format
+ * @param[in] signature_length  length of the signature of permart in base64 format 
+ * 
+ * @return           Error id if faillure, 0 if no breach
+ * @retval NPNT_INV_ART   Invalid Artefact, or larger than NPNT_MAX_PERMART_SIZE
+ *         NPNT_INV_AUTH  signed by unauthorised entity
+ *         NPNT_INV_STATE artefact can't setup in current aircraft state
+ *         NPNT_ALREADY_SET artefact already set, free previous artefact first
+ * @iclass control_iface
+ */
+int8_t npnt_set_permart(npnt_s *handle, uint8_t *permart, uint32_t permart_length, uint8_t base64_encoded)
+{
+    uint8_t stage;
+    int8_t ret;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    stage = npnt_mem_stage(NPNT_MEM_DECODE);
+    NPNT_TRACE_BEGIN(NPNT_TRACE_LOAD);
+    ret = permart_load(handle, permart, permart_length, base64_encoded);
+    NPNT_TRACE_END(NPNT_TRACE_LOAD);
+    npnt_mem_stage(stage);
+    return ret;
+}
+
+//Feeds data to the running digest with empty elements written as start-end tag pairs
+void npnt_digest_canonical(const char* data, int32_t length)
+{
+    char last_empty_element[64];
+    uint32_t curr_ptr = 0, curr_length, name_len;
+
+    last_empty_element[0] = '\0';
+    while (curr_ptr < length) {
+        curr_length = 1;
+        if (data[curr_ptr] == '<') {
+            name_len = 0;
+            while ((curr_ptr + curr_length) < length) {
+                if (data[curr_ptr + curr_length] == ' ') {
+                    last_empty_element[name_len] = '\0';
+                    break;
+                } else if (data[curr_ptr + curr_length] == '>') {
+                    last_empty_element[0] = '\0';
+                    break;
+                }
+                //longer names are cut, the digest then fails to match
+                if (name_len < sizeof(last_empty_element) - 1) {
+                    last_empty_element[name_len++] = data[curr_ptr + curr_length];
+                }
+                curr_length++;
+            }
+        }
+
+        if (last_empty_element[0] != '\0' && data[curr_ptr] == '/' && data[curr_ptr + 1] == '>') {
+            update_sha1("></", 3);
+            update_sha1(last_empty_element, strlen(last_empty_element));
+            last_empty_element[0] = '\0';
+            curr_ptr += curr_length;
+            continue;
+        }
+
+        update_sha1(&data[curr_ptr], curr_length);
+        curr_ptr += curr_length;
+    }
+}
+
 //Verify the data contained in parsed XML
 int8_t npnt_verify_permart(npnt_s *handle)
 {
@@ -96,64 +196,30 @@ int8_t npnt_verify_permart(npnt_s *handle)
     char* signed_info;
     const uint8_t* rcvd_digest_value;
     // char *test_str;
-    int16_t permission_length, signedinfo_length;
+    int32_t permission_length, signedinfo_length;
     char digest_value[20];
     const uint8_t* signature = NULL;
     uint8_t* raw_signature = NULL;
-    uint16_t signature_len, raw_signature_len;
+    uint32_t signature_len, raw_signature_len;
     uint8_t* base64_digest_value = NULL;
-    uint16_t base64_digest_value_len;
-    uint16_t curr_ptr = 0, curr_length;
-    char last_empty_element[20];
+    uint32_t base64_digest_value_len;
     int8_t ret = 0;
-    
-    reset_sha1();
-    
+
     //Digest Signed Info
-    update_sha1("<SignedInfo xmlns=\"http://www.w3.org/2000/09/xmldsig#\">", 
-                strlen("<SignedInfo xmlns=\"http://www.w3.org/2000/09/xmldsig#\">"));
-    signed_info = strstr(handle->raw_permart, "<SignedInfo>") + strlen("<SignedInfo>");
-    if (signed_info == NULL) {
+    signed_info = strstr(handle->raw_permart, "<SignedInfo>");
+    if (signed_info == NULL || strstr(signed_info, "<SignatureValue") == NULL) {
         ret = NPNT_INV_ART;
         goto fail;
     }
-    signedinfo_length = strstr(handle->raw_permart, "<SignatureValue") - signed_info;
-    if (signedinfo_length < 0) {
-        ret = NPNT_INV_ART;
-        goto fail;
-    }
-    while (curr_ptr < signedinfo_length) {
-        curr_length = 1;
-        if (signed_info[curr_ptr] == '<') {
-            while((curr_ptr + curr_length) < signedinfo_length) {
-                if (signed_info[curr_ptr + curr_length] == ' ') {
-                    last_empty_element[curr_length - 1] = '\0';
-                    break;
-                } else if (signed_info[curr_ptr + curr_length] == '>') {
-                    last_empty_element[0] = '\0';
-                    break;
-                }
-                last_empty_element[curr_length - 1] = signed_info[curr_ptr + curr_length];
-                curr_length++;
-            }
-        }
-
-        if (strlen(last_empty_element) != 0) {
-            if (signed_info[curr_ptr] == '/') {
-                if (signed_info[curr_ptr + 1] == '>') {
-                    update_sha1("></", 3);
-                    update_sha1(last_empty_element, strlen(last_empty_element));
-                    last_empty_element[0] = '\0';
-                    curr_ptr += curr_length;
-                    continue;
-                }
-            }
-        }
-
-        update_sha1(&signed_info[curr_ptr], curr_length);
-        curr_ptr += curr_length;
-    }
+    signed_info += strlen("<SignedInfo>");
+    signedinfo_length = strstr(signed_info, "<SignatureValue") - signed_info;
+    NPNT_TRACE_BEGIN(NPNT_TRACE_SIGNEDINFO);
+    reset_sha1();
+    update_sha1("<SignedInfo xmlns=\"http://www.w3.org/2000/09/xmldsig#\">", 
+                strlen("<SignedInfo xmlns=\"http://www.w3.org/2000/09/xmldsig#\">"));
+    npnt_digest_canonical(signed_info, signedinfo_length);
     final_sha1(digest_value);
+    NPNT_TRACE_END(NPNT_TRACE_SIGNEDINFO);
 
     //fetch SignatureValue from xml
     signature = (const uint8_t*)mxmlGetOpaque(mxmlFindElement(handle->parsed_permart, handle->parsed_permart, "SignatureValue", NULL, NULL, MXML_DESCEND));
@@ -163,9 +229,15 @@ int8_t npnt_verify_permart(npnt_s *handle)
     }
     signature_len = strlen(signature);
     raw_signature = base64_decode(signature, signature_len, &raw_signature_len);
+    if (!raw_signature || raw_signature_len > UINT16_MAX) {
+        ret = NPNT_INV_SIGN;
+        goto fail;
+    }
     //Check authenticity of the artifact
-    if (npnt_check_authenticity(handle, digest_value, 20, raw_signature, raw_signature_len) <= 0) {
-        ret = NPNT_INV_AUTH;
+    NPNT_TRACE_BEGIN(NPNT_TRACE_RSA_VERIFY);
+    ret = npnt_check_authenticity(handle, digest_value, 20, raw_signature, raw_signature_len) <= 0 ? NPNT_INV_AUTH : 0;
+    NPNT_TRACE_END(NPNT_TRACE_RSA_VERIFY);
+    if (ret < 0) {
         goto fail;
     }
 
@@ -185,53 +257,30 @@ int8_t npnt_verify_permart(npnt_s *handle)
     // test_str[permission_length] = '\0';
     // printf("\n RAW PERMISSION: \n%s", test_str);
 
+    NPNT_TRACE_BEGIN(NPNT_TRACE_PERMISSION);
     reset_sha1();
-    curr_ptr = 0;
-    curr_length = 0;
     //Canonicalise Permission Artefact by converting Empty elements to start-end tag pairs
-    while (curr_ptr < permission_length) {
-        curr_length = 1;
-        if (raw_perm_without_sign[curr_ptr] == '<') {
-            while((curr_ptr + curr_length) < permission_length) {
-                if (raw_perm_without_sign[curr_ptr + curr_length] == ' ') {
-                    last_empty_element[curr_length - 1] = '\0';
-                    break;
-                } else if (raw_perm_without_sign[curr_ptr + curr_length] == '>') {
-                    last_empty_element[0] = '\0';
-                    break;
-                }
-                last_empty_element[curr_length - 1] = raw_perm_without_sign[curr_ptr + curr_length];
-                curr_length++;
-            }
-        }
-
-        if (strlen(last_empty_element) != 0) {
-            if (raw_perm_without_sign[curr_ptr] == '/') {
-                if (raw_perm_without_sign[curr_ptr + 1] == '>') {
-                    update_sha1("></", 3);
-                    update_sha1(last_empty_element, strlen(last_empty_element));
-                    last_empty_element[0] = '\0';
-                    curr_ptr += curr_length;
-                    continue;
-                }
-            }
-        }
-
-        update_sha1(&raw_perm_without_sign[curr_ptr], curr_length);
-        curr_ptr += curr_length;
-    }
+    npnt_digest_canonical(raw_perm_without_sign, permission_length);
 
     //Skip Signature for Digestion
-    raw_perm_without_sign = strstr(handle->raw_permart, "</Signature>") + strlen("</Signature>");
-    update_sha1(raw_perm_without_sign, strlen(raw_perm_without_sign));
+    raw_perm_without_sign = strstr(handle->raw_permart, "</Signature>");
+    if (raw_perm_without_sign) {
+        raw_perm_without_sign += strlen("</Signature>");
+        update_sha1(raw_perm_without_sign, strlen(raw_perm_without_sign));
+    }
     final_sha1(digest_value);
+    NPNT_TRACE_END(NPNT_TRACE_PERMISSION);
+    if (!raw_perm_without_sign) {
+        ret = NPNT_INV_ART;
+        goto fail;
+    }
     base64_digest_value = base64_encode(digest_value, 20, &base64_digest_value_len);
     // printf("\nDigest Value: \n%s\n", base64_digest_value);
     // printf("\nDigest Value: \n%s\n", mxmlGetOpaque(mxmlFindElement(handle->parsed_permart, handle->parsed_permart, "DigestValue", NULL, NULL, MXML_DESCEND)));
     
     //Check Digestion
     rcvd_digest_value = (const uint8_t*)mxmlGetOpaque(mxmlFindElement(handle->parsed_permart, handle->parsed_permart, "DigestValue", NULL, NULL, MXML_DESCEND));
-    for (uint16_t i = 0; i < base64_digest_value_len - 1; i++) {
+    for (uint32_t i = 0; i < base64_digest_value_len - 1; i++) {
         if (base64_digest_value[i] != rcvd_digest_value[i]) {
             ret = NPNT_INV_DGST;
             goto fail;
@@ -239,20 +288,21 @@ int8_t npnt_verify_permart(npnt_s *handle)
     }
 
     //base64_digest_value no longer needed
-    free(base64_digest_value);
+    npnt_free(base64_digest_value);
     base64_digest_value = NULL;
 fail:
     if (base64_digest_value) {
-        free(base64_digest_value);
+        npnt_free(base64_digest_value);
     }
+    npnt_free(raw_signature);
     return ret;
 }
 
-int8_t npnt_alloc_and_get_fence_points(npnt_s* handle, float* vertlat, float* vertlon)
+int32_t npnt_alloc_and_get_fence_points(npnt_s* handle, float* vertlat, float* vertlon)
 {
     //Calculate number of vertices
     mxml_node_t *first_coordinate, *current_coordinate;
-    uint16_t nverts = 0;
+    uint32_t nverts = 0;
     const char* lat_str;
     const char* lon_str;
     first_coordinate = mxmlGetFirstChild(mxmlFindElement(handle->parsed_permart, handle->parsed_permart, "Coordinates", NULL, NULL, MXML_DESCEND));
@@ -270,13 +320,15 @@ int8_t npnt_alloc_and_get_fence_points(npnt_s* handle, float* vertlat, float* ve
         nverts++;
     }
 
-    //Allocate vertices
-    vertlat = (float*)malloc(nverts*sizeof(float));
-    vertlon = (float*)malloc(nverts*sizeof(float));
-
-    if (!vertlat || !vertlon) {
+    //Allocate vertices, longitudes follow latitudes in the same block
+    if (nverts == 0 || nverts > NPNT_MAX_FENCE_VERTS) {
         return -1;
     }
+    vertlat = (float*)npnt_malloc(2*nverts*sizeof(float));
+    if (!vertlat) {
+        return -1;
+    }
+    vertlon = vertlat + nverts;
     //read coordinates
     nverts = 0;
     current_coordinate = first_coordinate;
@@ -305,10 +357,11 @@ int8_t npnt_alloc_and_get_fence_points(npnt_s* handle, float* vertlat, float* ve
         current_coordinate = mxmlGetNextSibling(current_coordinate);
         nverts++;
     }
+    handle->permit.info->vertlat = vertlat;
+    handle->permit.info->vertlon = vertlon;
     return nverts;
 fail:
-    free(vertlat);
-    free(vertlon);
+    npnt_free(vertlat);
     return -1;
 }
 
@@ -333,45 +386,85 @@ int8_t npnt_get_max_altitude(npnt_s* handle, float* altitude)
     return 0;
 }
 
-int8_t npnt_ist_date_time_to_unix_time(const char* dt_string, struct tm* date_time)
+static int8_t parse_digits(const char* str, uint8_t count, int32_t* value)
+{
+    uint8_t i;
+    *value = 0;
+    for (i = 0; i < count; i++) {
+        if (str[i] < '0' || str[i] > '9') {
+            return -1;
+        }
+        *value = *value * 10 + (str[i] - '0');
+    }
+    return 0;
+}
+
+/*
+ * Converts "YYYY-MM-DDTHH:MM:SS" to UTC epoch seconds. Artefact times carry
+ * no zone and are IST, an explicit "Z" or "+HH:MM"/"-HH:MM" suffix
+ * overrides that offset. date_time, if given, receives the UTC time with
+ * struct tm conventions (tm_mon from 0, tm_year from 1900).
+ */
+int8_t npnt_ist_date_time_to_unix_time(const char* dt_string, int64_t* unix_time, struct tm* date_time)
 {
-    char data[5] = {};
-    if (strlen(dt_string) != 19) {
+    int32_t year, month, day, hour, minute, second, off_h, off_m;
+    int32_t offset = NPNT_IST_OFFSET;
+    int64_t days, secs;
+    int32_t y;
+    uint8_t m, d;
+    size_t len;
+
+    if (!dt_string || !unix_time) {
+        return -1;
+    }
+    len = strlen(dt_string);
+    if (len < 19 || dt_string[4] != '-' || dt_string[7] != '-' || dt_string[10] != 'T' ||
+        dt_string[13] != ':' || dt_string[16] != ':') {
         return -1;
     }
-    if (!date_time) {
+    if (parse_digits(&dt_string[0], 4, &year) < 0 || parse_digits(&dt_string[5], 2, &month) < 0 ||
+        parse_digits(&dt_string[8], 2, &day) < 0 || parse_digits(&dt_string[11], 2, &hour) < 0 ||
+        parse_digits(&dt_string[14], 2, &minute) < 0 || parse_digits(&dt_string[17], 2, &second) < 0) {
         return -1;
     }
-    memset(date_time, 0, sizeof(struct tm));
-
-    //read year
-    memcpy(data, dt_string, 4);
-    data[4] = '\0';
-    date_time->tm_year = atoi(data) - 1900;
-    //read month
-    memcpy(data, &dt_string[5], 2);
-    data[2] = '\0';
-    date_time->tm_mon = atoi(data);
-    //read day
-    memcpy(data, &dt_string[8], 2);
-    data[2] = '\0';
-    date_time->tm_mday = atoi(data);
-    //read hour
-    memcpy(data, &dt_string[11], 2);
-    data[2] = '\0';
-    date_time->tm_hour = atoi(data) - 5; //also apply IST to UTC offset
-    //read minute
-    memcpy(data, &dt_string[14], 2); //also apply IST to UTC offset
-    data[2] = '\0';
-    date_time->tm_min = atoi(data) - 30;
-    //read second
-    memcpy(data, &dt_string[17], 2);
-    data[2] = '\0';
-    date_time->tm_sec = atoi(data);
+    if (len == 20 && dt_string[19] == 'Z') {
+        offset = 0;
+    } else if (len == 25 && (dt_string[19] == '+' || dt_string[19] == '-') && dt_string[22] == ':') {
+        if (parse_digits(&dt_string[20], 2, &off_h) < 0 || parse_digits(&dt_string[23], 2, &off_m) < 0 ||
+            off_h > 23 || off_m > 59) {
+            return -1;
+        }
+        offset = (off_h * 3600 + off_m * 60) * (dt_string[19] == '-' ? -1 : 1);
+    } else if (len != 19) {
+        return -1;
+    }
+
+    if (year < 1 || month < 1 || month > 12 || day < 1 || day > npnt_days_in_month(year, (uint8_t)month) ||
+        hour > 23 || minute > 59 || second > 60) {
+        return -1;
+    }
+    days = npnt_days_from_civil(year, (uint8_t)month, (uint8_t)day);
+    *unix_time = days * 86400 + hour * 3600 + minute * 60 + second - offset;
 
+    if (date_time) {
+        memset(date_time, 0, sizeof(struct tm));
+        days = *unix_time / 86400;
+        secs = *unix_time % 86400;
+        if (secs < 0) {
+            days--;
+            secs += 86400;
+        }
+        npnt_civil_from_days(days, &y, &m, &d);
+        date_time->tm_year = y - 1900;
+        date_time->tm_mon = m - 1;
+        date_time->tm_mday = d;
+        date_time->tm_hour = (int)(secs / 3600);
+        date_time->tm_min = (int)(secs / 60 % 60);
+        date_time->tm_sec = (int)(secs % 60);
+        date_time->tm_wday = (int)(((days % 7) + 11) % 7);
+        date_time->tm_yday = (int)(days - npnt_days_from_civil(y, 1, 1));
+    }
     return 0;
-    // time_t tim = mktime(date_time);
-    // printf("\nUnixTime: %s\n", ctime(&tim));
 }
 
 char* npnt_get_attr(mxml_node_t *node, const char* attr)
@@ -379,10 +472,10 @@ char* npnt_get_attr(mxml_node_t *node, const char* attr)
     const char* tmp = NULL;
     char* ret = NULL;
     tmp = mxmlElementGetAttr(node, attr);
-    if (!tmp) {
+    if (!tmp || strlen(tmp) > NPNT_MAX_STR_LEN) {
         return NULL;
     }
-    ret = (char*)malloc(strlen(tmp) + 1);
+    ret = (char*)npnt_malloc(strlen(tmp) + 1);
     if (!ret) {
         return NULL;
     }
@@ -390,6 +483,33 @@ char* npnt_get_attr(mxml_node_t *node, const char* attr)
     return ret;
 }
 
+//Optional recurring windows, an empty expression means a single window
+int8_t npnt_set_recurrence(npnt_permit_s* permit, const char* expr, const char* type, const char* duration)
+{
+    char* end;
+    unsigned long minutes;
+
+    permit->window_len = 0;
+    if (!expr || expr[0] == '\0') {
+        return 0;
+    }
+    if (!type || strcmp(type, "CRON_QUARTZ") != 0) {
+        return NPNT_INV_FPARAMS;
+    }
+    if (!duration || duration[0] == '\0') {
+        return NPNT_INV_FPARAMS;
+    }
+    minutes = strtoul(duration, &end, 10);
+    if (*end != '\0' || minutes == 0 || minutes > UINT32_MAX / 60) {
+        return NPNT_INV_FPARAMS;
+    }
+    if (npnt_cron_compile(&permit->info->cron, expr, NPNT_IST_OFFSET) < 0) {
+        return NPNT_INV_FPARAMS;
+    }
+    permit->window_len = (uint32_t)(minutes * 60);
+    return 0;
+}
+
 int8_t npnt_populate_flight_params(npnt_s* handle)
 {
     mxml_node_t *ua_detail, *flight_params;
@@ -402,27 +522,31 @@ int8_t npnt_populate_flight_params(npnt_s* handle)
         return NPNT_INV_FPARAMS;
     }
 
-    handle->params.uinNo = npnt_get_attr(ua_detail, "uinNo");
-    if (!handle->params.uinNo) {
+    handle->permit.info->uinNo = npnt_get_attr(ua_detail, "uinNo");
+    if (!handle->permit.info->uinNo) {
         return NPNT_INV_FPARAMS;
     }
 
-    handle->params.adcNumber = npnt_get_attr(flight_params, "adcNumber");
-    if (!handle->params.adcNumber) {
+    handle->permit.info->adcNumber = npnt_get_attr(flight_params, "adcNumber");
+    if (!handle->permit.info->adcNumber) {
         return NPNT_INV_FPARAMS;
     }
 
-    handle->params.ficNumber = npnt_get_attr(flight_params, "ficNumber");
-    if (!handle->params.ficNumber) {
+    handle->permit.info->ficNumber = npnt_get_attr(flight_params, "ficNumber");
+    if (!handle->permit.info->ficNumber) {
         return NPNT_INV_FPARAMS;
     }
-    if (npnt_ist_date_time_to_unix_time(mxmlElementGetAttr(flight_params, "flightEndTime"), &handle->params.flightEndTime) < 0) {
+    if (npnt_ist_date_time_to_unix_time(mxmlElementGetAttr(flight_params, "flightEndTime"),
+                                        &handle->permit.flightEnd, &handle->permit.info->flightEndTime) < 0) {
         return NPNT_INV_FPARAMS;
     }
-    if (npnt_ist_date_time_to_unix_time(mxmlElementGetAttr(flight_params, "flightStartTime"), &handle->params.flightStartTime) < 0) {
+    if (npnt_ist_date_time_to_unix_time(mxmlElementGetAttr(flight_params, "flightStartTime"),
+                                        &handle->permit.flightStart, &handle->permit.info->flightStartTime) < 0) {
         return NPNT_INV_FPARAMS;
     }
-    return 0;
+    return npnt_set_recurrence(&handle->permit, mxmlElementGetAttr(flight_params, "recurrenceTimeExpression"),
+                               mxmlElementGetAttr(flight_params, "recurrenceTimeExpressionType"),
+                               mxmlElementGetAttr(flight_params, "recurringTimeDurationInMinutes"));
 }
 
 
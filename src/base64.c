@@ -22,20 +22,23 @@ static const uint8_t base64_table[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklm
  * nul terminated to make it easier to use as a C string. The nul terminator is
  * not included in out_len.
  */
-uint8_t* base64_encode(const uint8_t *src, uint16_t len, uint16_t *out_len)
+uint8_t* base64_encode(const uint8_t *src, uint32_t len, uint32_t *out_len)
 {
 	uint8_t *out, *pos;
 	const uint8_t *end, *in;
-	uint16_t olen;
+	uint32_t olen;
 	int16_t line_len;
 
+	if (len > UINT32_MAX / 4) {
+		return NULL; /* integer overflow */
+	}
 	olen = len * 4 / 3 + 4; /* 3-byte blocks to 4-byte */
 	olen += olen / 72; /* line feeds */
 	olen++; /* nul termination */
 	if (olen < len) {
 		return NULL; /* integer overflow */
 	}
-	out = malloc(olen);
+	out = npnt_malloc(olen);
 	if (out == NULL) {
 		return NULL;
 	}
@@ -91,12 +94,14 @@ uint8_t* base64_encode(const uint8_t *src, uint16_t len, uint16_t *out_len)
  * Returns: Allocated buffer of out_len bytes of decoded data,
  * or %NULL on failure
  *
- * Caller is responsible for freeing the returned buffer.
+ * Caller is responsible for freeing the returned buffer. Returned buffer is
+ * nul terminated so decoded text can be used as a C string. The nul
+ * terminator is not included in out_len.
  */
-uint8_t* base64_decode(const uint8_t *src, uint16_t len, uint16_t *out_len)
+uint8_t* base64_decode(const uint8_t *src, uint32_t len, uint32_t *out_len)
 {
 	uint8_t dtable[256], *out, *pos, block[4], tmp;
-	uint16_t i, count, olen;
+	uint32_t i, count, olen;
 	int16_t pad = 0;
 
 	memset(dtable, 0x80, 256);
@@ -117,7 +122,7 @@ uint8_t* base64_decode(const uint8_t *src, uint16_t len, uint16_t *out_len)
 	}
 
 	olen = count / 4 * 3;
-	pos = out = malloc(olen);
+	pos = out = npnt_malloc(olen + 1);
 	if (out == NULL) {
 		return NULL;
 	}
@@ -146,7 +151,7 @@ uint8_t* base64_decode(const uint8_t *src, uint16_t len, uint16_t *out_len)
 					pos -= 2;
 				} else {
 					/* Invalid padding */
-					free(out);
+					npnt_free(out);
 					return NULL;
 				}
 				break;
@@ -154,6 +159,7 @@ uint8_t* base64_decode(const uint8_t *src, uint16_t len, uint16_t *out_len)
 		}
 	}
 
+	*pos = '\0';
 	*out_len = pos - out;
 	return out;
 }
\ No newline at end of file
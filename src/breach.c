@@ -0,0 +1,104 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+
+static void breach_publish(npnt_breach_pub_s *pub, const npnt_breach_snapshot_s *snapshot)
+{
+    uint32_t seq = __atomic_load_n(&pub->seq, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&pub->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    pub->snapshot = *snapshot;
+    __atomic_store_n(&pub->word, snapshot->breach, __ATOMIC_RELAXED);
+    __atomic_store_n(&pub->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+int8_t npnt_breach_evaluate(npnt_s *handle)
+{
+    npnt_breach_snapshot_s snapshot;
+    const npnt_permit_s *permit;
+    uint8_t slot;
+    int8_t verdict;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.count = handle->breach.snapshot.count + 1;
+
+    //one permit for the whole pass, even if the loader switches meanwhile
+    permit = npnt_permit_read_begin(handle, &slot);
+    if (!permit) {
+        npnt_permit_read_end(handle, slot);
+        snapshot.breach = NPNT_BR_NOPERM;
+        breach_publish(&handle->breach, &snapshot);
+        if (handle->log) {
+            npnt_log_breach(handle->log, &snapshot);
+        }
+        return (int8_t)snapshot.breach;
+    }
+
+    //Position: fence, exclusion zones and ceiling
+    if (npnt_abs_position(&snapshot.lat, &snapshot.lon, &snapshot.altitude) < 0) {
+        snapshot.breach |= NPNT_BR_NOPOS;
+    } else {
+        verdict = npnt_track_permit(handle, permit, snapshot.lat, snapshot.lon, NULL);
+        if (verdict == NPNT_FENCE_OUTSIDE) {
+            snapshot.breach |= NPNT_BR_FENCE;
+        } else if (verdict == NPNT_FENCE_EXCLUDED) {
+            snapshot.breach |= NPNT_BR_EXCL;
+        }
+        if (snapshot.altitude > permit->maxAltitude) {
+            snapshot.breach |= NPNT_BR_ALT;
+        }
+    }
+
+    //Time window
+    snapshot.utc_time = npnt_utc_time();
+    if (snapshot.utc_time == 0) {
+        snapshot.breach |= NPNT_BR_NOTIME;
+    } else if ((int64_t)snapshot.utc_time < permit->flightStart ||
+               (int64_t)snapshot.utc_time > permit->flightEnd ||
+               (permit->window_len &&
+                npnt_recurrence_permit(handle, permit, (int64_t)snapshot.utc_time, NULL) == 0)) {
+        snapshot.breach |= NPNT_BR_TIME;
+    }
+    npnt_permit_read_end(handle, slot);
+
+    breach_publish(&handle->breach, &snapshot);
+    if (handle->log) {
+        npnt_log_breach(handle->log, &snapshot);
+    }
+    return (int8_t)snapshot.breach;
+}
+
+int8_t npnt_breach_state(npnt_s *handle)
+{
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    return (int8_t)__atomic_load_n(&handle->breach.word, __ATOMIC_ACQUIRE);
+}
+
+int8_t npnt_breach_read(npnt_s *handle, npnt_breach_snapshot_s *snapshot)
+{
+    uint32_t seq0, seq1;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    if (!snapshot) {
+        return -1;
+    }
+    do {
+        seq0 = __atomic_load_n(&handle->breach.seq, __ATOMIC_ACQUIRE);
+        *snapshot = handle->breach.snapshot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq1 = __atomic_load_n(&handle->breach.seq, __ATOMIC_RELAXED);
+    } while ((seq0 & 1) || seq0 != seq1);
+    return 0;
+}
@@ -0,0 +1,625 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#include <ctype.h>
+
+/*
+ * Calendar arithmetic and Quartz cron schedules. All conversions work on
+ * epoch seconds with a fixed zone offset, no libc time zone state is used.
+ */
+
+#define CRON_YEAR_MIN       1970
+#define CRON_YEAR_MAX       2161
+#define CRON_MAX_FIELD      64
+
+//Days before the first of each month, counted in a year starting March 1st
+static const uint16_t days_before_month[12] = {306, 337, 0, 31, 61, 92, 122, 153, 184, 214, 245, 275};
+static const uint8_t days_in_month[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+static const char* const month_names[] = {"JAN", "FEB", "MAR", "APR", "MAY", "JUN",
+                                          "JUL", "AUG", "SEP", "OCT", "NOV", "DEC", NULL};
+static const char* const dow_names[] = {"SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT", NULL};
+
+/*
+ * Years start in March so the leap day is last and the month offset comes
+ * from a table, the only conditional is the year shift for January and
+ * February.
+ */
+int64_t npnt_days_from_civil(int32_t year, uint8_t month, uint8_t day)
+{
+    int64_t y = year - (month <= 2);
+    return 365 * y + y / 4 - y / 100 + y / 400 + days_before_month[month - 1] + day - 1 - 719468;
+}
+
+void npnt_civil_from_days(int64_t days, int32_t* year, uint8_t* month, uint8_t* day)
+{
+    int64_t z = days + 719468;
+    int64_t era = z / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    *day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    *month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    *year = (int32_t)(yoe + era * 400 + (*month <= 2));
+}
+
+uint8_t npnt_days_in_month(int32_t year, uint8_t month)
+{
+    return days_in_month[month - 1] +
+           (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
+}
+
+static int8_t cron_value(const char** str, uint16_t lo, uint16_t hi, const char* const* names, uint16_t* value)
+{
+    const char* p = *str;
+    uint16_t i;
+    uint32_t v = 0;
+
+    if (names) {
+        for (i = 0; names[i]; i++) {
+            if (toupper((unsigned char)p[0]) == names[i][0] && toupper((unsigned char)p[1]) == names[i][1] &&
+                toupper((unsigned char)p[2]) == names[i][2]) {
+                *value = i + lo;
+                *str = p + 3;
+                return 0;
+            }
+        }
+    }
+    if (!isdigit((unsigned char)*p)) {
+        return -1;
+    }
+    while (isdigit((unsigned char)*p) && v <= hi) {
+        v = v * 10 + (*p++ - '0');
+    }
+    if (v < lo || v > hi) {
+        return -1;
+    }
+    *value = (uint16_t)v;
+    *str = p;
+    return 0;
+}
+
+/*
+ * Generic field: comma separated "*", "v", "a-b" items, each with an
+ * optional "/step". Ranges with a > b wrap around, as in "FRI-MON".
+ * Sets bit v - lo of bits.
+ */
+static int8_t cron_field(const char* str, uint16_t lo, uint16_t hi, const char* const* names, uint64_t* bits)
+{
+    uint16_t a, b, step, v, span;
+    uint32_t k;
+
+    for (;;) {
+        if (*str == '*') {
+            a = lo;
+            b = hi;
+            str++;
+        } else {
+            if (cron_value(&str, lo, hi, names, &a) < 0) {
+                return -1;
+            }
+            b = a;
+            if (*str == '-') {
+                str++;
+                if (cron_value(&str, lo, hi, names, &b) < 0) {
+                    return -1;
+                }
+            } else if (*str == '/') {
+                //"a/step" runs to the end of the range
+                b = hi;
+            }
+        }
+        step = 1;
+        if (*str == '/') {
+            str++;
+            if (cron_value(&str, 1, hi - lo + 1, NULL, &step) < 0) {
+                return -1;
+            }
+        }
+        span = b >= a ? b - a : (hi - a) + (b - lo) + 1;
+        for (k = 0; k <= span; k += step) {
+            v = (uint16_t)(a + k > hi ? a + k - (hi - lo + 1) : a + k);
+            bits[(v - lo) >> 6] |= 1ull << ((v - lo) & 63);
+        }
+        if (*str == '\0') {
+            return 0;
+        }
+        if (*str++ != ',') {
+            return -1;
+        }
+    }
+}
+
+static int8_t cron_dom(npnt_cron_s *cron, const char* str)
+{
+    uint64_t bits[1] = {0};
+    uint16_t n;
+
+    cron->dom_last = -1;
+    if (strcmp(str, "?") == 0) {
+        cron->day_by_dow = true;
+        return 0;
+    }
+    if (str[0] == 'L') {
+        str++;
+        cron->dom_last = 0;
+        if (*str == '-') {
+            str++;
+            if (cron_value(&str, 0, 30, NULL, &n) < 0) {
+                return -1;
+            }
+            cron->dom_last = (int8_t)n;
+        }
+        //no nearest weekday support, "LW" ends up here as well
+        return *str == '\0' ? 0 : -1;
+    }
+    if (strchr(str, 'W')) {
+        return -1;
+    }
+    if (cron_field(str, 1, 31, NULL, bits) < 0) {
+        return -1;
+    }
+    cron->dom = (uint32_t)(bits[0] << 1);
+    return 0;
+}
+
+static int8_t cron_dow(npnt_cron_s *cron, const char* str)
+{
+    uint64_t bits[1] = {0};
+    uint16_t d, k;
+
+    if (strcmp(str, "?") == 0) {
+        return cron->day_by_dow ? -1 : 0;
+    }
+    if (!cron->day_by_dow) {
+        //Quartz needs '?' in one of the two day fields, "*" in dom is accepted as well
+        if (cron->dom != 0xFFFFFFFEu || cron->dom_last >= 0) {
+            return -1;
+        }
+        cron->day_by_dow = true;
+    }
+    if (strcmp(str, "L") == 0) {
+        //plain "L" is the last day of the week
+        cron->dow |= 1 << 7;
+        return 0;
+    }
+    if (str[0] && (strchr(str, '#') || str[strlen(str) - 1] == 'L')) {
+        if (cron_value(&str, 1, 7, dow_names, &d) < 0) {
+            return -1;
+        }
+        if (*str == 'L' && str[1] == '\0') {
+            cron->dow_last |= (uint8_t)(1 << d);
+            return 0;
+        }
+        if (*str++ != '#' || cron_value(&str, 1, 5, NULL, &k) < 0 || *str != '\0') {
+            return -1;
+        }
+        cron->dow_nth[d] |= (uint8_t)(1 << k);
+        return 0;
+    }
+    if (cron_field(str, 1, 7, dow_names, bits) < 0) {
+        return -1;
+    }
+    cron->dow = (uint8_t)(bits[0] << 1);
+    return 0;
+}
+
+int8_t npnt_cron_compile(npnt_cron_s *cron, const char* expr, int32_t tz_offset)
+{
+    char buf[CRON_MAX_FIELD * 7];
+    char* field[7];
+    uint64_t bits[3];
+    uint8_t nfields = 0;
+    char* p;
+
+    if (!cron || !expr || strlen(expr) >= sizeof(buf)) {
+        return NPNT_INV_FPARAMS;
+    }
+    memset(cron, 0, sizeof(npnt_cron_s));
+    cron->tz_offset = tz_offset;
+    strcpy(buf, expr);
+    p = buf;
+    for (;;) {
+        while (*p == ' ' || *p == '\t') {
+            *p++ = '\0';
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (nfields == 7) {
+            return NPNT_INV_FPARAMS;
+        }
+        field[nfields++] = p;
+        while (*p && *p != ' ' && *p != '\t') {
+            p++;
+        }
+    }
+    if (nfields < 6) {
+        return NPNT_INV_FPARAMS;
+    }
+
+    memset(bits, 0, sizeof(bits));
+    if (cron_field(field[0], 0, 59, NULL, bits) < 0) {
+        return NPNT_INV_FPARAMS;
+    }
+    cron->second = bits[0];
+    memset(bits, 0, sizeof(bits));
+    if (cron_field(field[1], 0, 59, NULL, bits) < 0) {
+        return NPNT_INV_FPARAMS;
+    }
+    cron->minute = bits[0];
+    memset(bits, 0, sizeof(bits));
+    if (cron_field(field[2], 0, 23, NULL, bits) < 0) {
+        return NPNT_INV_FPARAMS;
+    }
+    cron->hour = (uint32_t)bits[0];
+    memset(bits, 0, sizeof(bits));
+    if (cron_field(field[4], 1, 12, month_names, bits) < 0) {
+        return NPNT_INV_FPARAMS;
+    }
+    cron->month = (uint16_t)(bits[0] << 1);
+    if (cron_dom(cron, field[3]) < 0 || cron_dow(cron, field[5]) < 0) {
+        return NPNT_INV_FPARAMS;
+    }
+    if (nfields == 7) {
+        if (cron_field(field[6], CRON_YEAR_MIN, CRON_YEAR_MAX, NULL, cron->year) < 0) {
+            return NPNT_INV_FPARAMS;
+        }
+    } else {
+        memset(cron->year, 0xFF, sizeof(cron->year));
+    }
+    return 0;
+}
+
+//Lowest set bit >= v, -1 if none
+static int32_t bit_next(uint64_t mask, int32_t v)
+{
+    if (v < 0) {
+        v = 0;
+    }
+    if (v > 63) {
+        return -1;
+    }
+    mask &= ~0ull << v;
+    return mask ? __builtin_ctzll(mask) : -1;
+}
+
+//Highest set bit <= v, -1 if none
+static int32_t bit_prev(uint64_t mask, int32_t v)
+{
+    if (v < 0) {
+        return -1;
+    }
+    if (v < 63) {
+        mask &= (2ull << v) - 1;
+    }
+    return mask ? 63 - __builtin_clzll(mask) : -1;
+}
+
+static int32_t cron_year_next(const npnt_cron_s *cron, int32_t year)
+{
+    int32_t i, b;
+    for (i = (year < CRON_YEAR_MIN ? 0 : (year - CRON_YEAR_MIN) >> 6); i < 3; i++) {
+        b = bit_next(cron->year[i], year - CRON_YEAR_MIN - i * 64);
+        if (b >= 0) {
+            return CRON_YEAR_MIN + i * 64 + b;
+        }
+    }
+    return -1;
+}
+
+static int32_t cron_year_prev(const npnt_cron_s *cron, int32_t year)
+{
+    int32_t i, b;
+    if (year < CRON_YEAR_MIN) {
+        return -1;
+    }
+    for (i = (year > CRON_YEAR_MAX ? 2 : (year - CRON_YEAR_MIN) >> 6); i >= 0; i--) {
+        b = bit_prev(cron->year[i], year - CRON_YEAR_MIN - i * 64);
+        if (b >= 0) {
+            return CRON_YEAR_MIN + i * 64 + b;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Matching days of a month, bit d for day d. Weekday rules expand from
+ * the first occurrence of each weekday, which repeats every 7 bits.
+ */
+static uint32_t cron_days(const npnt_cron_s *cron, int32_t year, uint8_t month)
+{
+    uint8_t ndays = npnt_days_in_month(year, month);
+    uint32_t valid = ((1u << ndays) - 1) << 1;
+    uint32_t mask = 0, weekly;
+    uint8_t first_dow, wd, first, k;
+
+    if (!cron->day_by_dow) {
+        mask = cron->dom & valid;
+        if (cron->dom_last >= 0 && cron->dom_last < ndays) {
+            mask |= 1u << (ndays - cron->dom_last);
+        }
+        return mask;
+    }
+    //Quartz weekday of the 1st, SUN = 1
+    first_dow = (uint8_t)(((npnt_days_from_civil(year, month, 1) % 7) + 11) % 7 + 1);
+    for (wd = 1; wd <= 7; wd++) {
+        if (!((cron->dow | cron->dow_last) & (1 << wd)) && !cron->dow_nth[wd]) {
+            continue;
+        }
+        first = (uint8_t)(1 + (wd + 7 - first_dow) % 7);
+        weekly = (0x10204081u << first) & valid;
+        if (cron->dow & (1 << wd)) {
+            mask |= weekly;
+        }
+        if (cron->dow_last & (1 << wd)) {
+            mask |= 1u << (31 - __builtin_clz(weekly));
+        }
+        for (k = 1; k <= 5; k++) {
+            if ((cron->dow_nth[wd] & (1 << k)) && first + 7 * (k - 1) <= ndays) {
+                mask |= 1u << (first + 7 * (k - 1));
+            }
+        }
+    }
+    return mask;
+}
+
+typedef struct {
+    int32_t year;
+    int32_t month, day, hour, minute, second;
+} cron_time_s;
+
+static void cron_split(const npnt_cron_s *cron, int64_t t, cron_time_s *ct)
+{
+    int64_t local = t + cron->tz_offset;
+    int64_t days = local / 86400, secs = local % 86400;
+    uint8_t m, d;
+    if (secs < 0) {
+        days--;
+        secs += 86400;
+    }
+    npnt_civil_from_days(days, &ct->year, &m, &d);
+    ct->month = m;
+    ct->day = d;
+    ct->hour = (int32_t)(secs / 3600);
+    ct->minute = (int32_t)(secs / 60 % 60);
+    ct->second = (int32_t)(secs % 60);
+}
+
+static int64_t cron_join(const npnt_cron_s *cron, const cron_time_s *ct)
+{
+    return npnt_days_from_civil(ct->year, (uint8_t)ct->month, (uint8_t)ct->day) * 86400 +
+           ct->hour * 3600 + ct->minute * 60 + ct->second - cron->tz_offset;
+}
+
+bool npnt_cron_match(const npnt_cron_s *cron, int64_t t)
+{
+    cron_time_s ct;
+    cron_split(cron, t, &ct);
+    if (ct.year < CRON_YEAR_MIN || ct.year > CRON_YEAR_MAX) {
+        return false;
+    }
+    return ((cron->second >> ct.second) & 1) && ((cron->minute >> ct.minute) & 1) &&
+           ((cron->hour >> ct.hour) & 1) && ((cron->month >> ct.month) & 1) &&
+           ((cron->year[(ct.year - CRON_YEAR_MIN) >> 6] >> ((ct.year - CRON_YEAR_MIN) & 63)) & 1) &&
+           ((cron_days(cron, ct.year, (uint8_t)ct.month) >> ct.day) & 1);
+}
+
+/*
+ * Earliest match >= t. Every field jumps to its next set bit, a field
+ * without one carries into the field above and resets those below.
+ */
+int64_t npnt_cron_next(const npnt_cron_s *cron, int64_t t)
+{
+    cron_time_s ct;
+    int32_t v;
+
+    if (!cron) {
+        return -1;
+    }
+    cron_split(cron, t, &ct);
+    for (;;) {
+        v = cron_year_next(cron, ct.year);
+        if (v < 0) {
+            return -1;
+        }
+        if (v != ct.year) {
+            ct.year = v;
+            ct.month = 1;
+            ct.day = 1;
+            ct.hour = ct.minute = ct.second = 0;
+        }
+        v = bit_next(cron->month, ct.month);
+        if (v < 0) {
+            ct.year++;
+            ct.month = 1;
+            ct.day = 1;
+            ct.hour = ct.minute = ct.second = 0;
+            continue;
+        }
+        if (v != ct.month) {
+            ct.month = v;
+            ct.day = 1;
+            ct.hour = ct.minute = ct.second = 0;
+        }
+        v = bit_next(cron_days(cron, ct.year, (uint8_t)ct.month), ct.day);
+        if (v < 0) {
+            ct.month++;
+            ct.day = 1;
+            ct.hour = ct.minute = ct.second = 0;
+            continue;
+        }
+        if (v != ct.day) {
+            ct.day = v;
+            ct.hour = ct.minute = ct.second = 0;
+        }
+        v = bit_next(cron->hour, ct.hour);
+        if (v < 0) {
+            ct.day++;
+            ct.hour = ct.minute = ct.second = 0;
+            continue;
+        }
+        if (v != ct.hour) {
+            ct.hour = v;
+            ct.minute = ct.second = 0;
+        }
+        v = bit_next(cron->minute, ct.minute);
+        if (v < 0) {
+            ct.hour++;
+            ct.minute = ct.second = 0;
+            continue;
+        }
+        if (v != ct.minute) {
+            ct.minute = v;
+            ct.second = 0;
+        }
+        v = bit_next(cron->second, ct.second);
+        if (v < 0) {
+            ct.minute++;
+            ct.second = 0;
+            continue;
+        }
+        ct.second = v;
+        return cron_join(cron, &ct);
+    }
+}
+
+//Latest match <= t, mirror of npnt_cron_next
+int64_t npnt_cron_prev(const npnt_cron_s *cron, int64_t t)
+{
+    cron_time_s ct;
+    int32_t v;
+
+    if (!cron) {
+        return -1;
+    }
+    cron_split(cron, t, &ct);
+    for (;;) {
+        v = cron_year_prev(cron, ct.year);
+        if (v < 0) {
+            return -1;
+        }
+        if (v != ct.year) {
+            ct.year = v;
+            ct.month = 12;
+            ct.day = 31;
+            ct.hour = 23;
+            ct.minute = ct.second = 59;
+        }
+        v = bit_prev(cron->month, ct.month);
+        if (v < 1) {
+            ct.year--;
+            ct.month = 12;
+            ct.day = 31;
+            ct.hour = 23;
+            ct.minute = ct.second = 59;
+            continue;
+        }
+        if (v != ct.month) {
+            ct.month = v;
+            ct.day = 31;
+            ct.hour = 23;
+            ct.minute = ct.second = 59;
+        }
+        v = bit_prev(cron_days(cron, ct.year, (uint8_t)ct.month), ct.day);
+        if (v < 1) {
+            ct.month--;
+            ct.day = 31;
+            ct.hour = 23;
+            ct.minute = ct.second = 59;
+            continue;
+        }
+        if (v != ct.day) {
+            ct.day = v;
+            ct.hour = 23;
+            ct.minute = ct.second = 59;
+        }
+        v = bit_prev(cron->hour, ct.hour);
+        if (v < 0) {
+            ct.day--;
+            ct.hour = 23;
+            ct.minute = ct.second = 59;
+            continue;
+        }
+        if (v != ct.hour) {
+            ct.hour = v;
+            ct.minute = ct.second = 59;
+        }
+        v = bit_prev(cron->minute, ct.minute);
+        if (v < 0) {
+            ct.hour--;
+            ct.minute = ct.second = 59;
+            continue;
+        }
+        if (v != ct.minute) {
+            ct.minute = v;
+            ct.second = 59;
+        }
+        v = bit_prev(cron->second, ct.second);
+        if (v < 0) {
+            ct.minute--;
+            ct.second = 59;
+            continue;
+        }
+        ct.second = v;
+        return cron_join(cron, &ct);
+    }
+}
+
+/*
+ * The verdict only changes at window starts and ends, so it is cached
+ * together with the interval it holds for and most calls end after two
+ * compares.
+ */
+int8_t npnt_recurrence_permit(npnt_s *handle, const npnt_permit_s *permit, int64_t now, int64_t* next_start)
+{
+    const npnt_cron_s *cron;
+    int64_t start, next;
+
+    if (!permit || !permit->window_len) {
+        return NPNT_INV_STATE;
+    }
+    cron = &permit->info->cron;
+    if (now < handle->window.from || now >= handle->window.until || handle->window.serial != permit->serial) {
+        handle->window.serial = permit->serial;
+        start = npnt_cron_prev(cron, now);
+        if (start >= 0 && now < start + permit->window_len) {
+            handle->window.inside = true;
+            handle->window.from = start;
+            handle->window.until = start + permit->window_len;
+        } else {
+            next = npnt_cron_next(cron, now);
+            handle->window.inside = false;
+            handle->window.from = start >= 0 ? start + permit->window_len : INT64_MIN;
+            handle->window.until = next >= 0 ? next : INT64_MAX;
+        }
+    }
+    if (next_start) {
+        if (handle->window.inside) {
+            *next_start = npnt_cron_next(cron, now + 1);
+        } else {
+            *next_start = handle->window.until == INT64_MAX ? -1 : handle->window.until;
+        }
+    }
+    return handle->window.inside ? 1 : 0;
+}
+
+int8_t npnt_recurrence_window(npnt_s *handle, int64_t now, int64_t* next_start)
+{
+    const npnt_permit_s *permit;
+    uint8_t slot;
+    int8_t ret;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    permit = npnt_permit_read_begin(handle, &slot);
+    ret = npnt_recurrence_permit(handle, permit, now, next_start);
+    npnt_permit_read_end(handle, slot);
+    return ret;
+}
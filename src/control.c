@@ -4,17 +4,17 @@
  *  file, You can obtain one at http://mozilla.org/MPL/2.0/. 
  */
 
-#include <control_iface.h>
+#include <npnt_internal.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
 
 int8_t npnt_init_handle(npnt_s *handle)
 {
     if (!handle) {
         return NPNT_UNALLOC_HANDLE;
     }
-    handle->parsed_permart = NULL;
-    handle->raw_permart = NULL;
-    handle->raw_permart_len = 0;
-    handle->security_handle = NULL;
+    memset(handle, 0, sizeof(npnt_s));
     return 0;
 }
 
@@ -25,35 +25,28 @@ int8_t npnt_reset_handle(npnt_s *handle)
         return NPNT_UNALLOC_HANDLE;
     }
 
+    //unpublish first, read sections still holding the permit end before it is freed
+    npnt_permit_switch(handle, NULL);
+    npnt_permit_synchronize(handle);
+
+#if defined(__unix__) || defined(__APPLE__)
+    if (handle->raw_permart_map_len) {
+        munmap(handle->raw_permart, handle->raw_permart_map_len);
+    } else
+#endif
     if (handle->raw_permart) {
-        free(handle->raw_permart);
+        npnt_free(handle->raw_permart);
     }
     
     if (handle->parsed_permart) {
-        free(handle->parsed_permart);
+        mxmlDelete(handle->parsed_permart);
     }
     
-    if (handle->fence.vertlat) {
-        free(handle->fence.vertlat);
-    }
-
-    if (handle->fence.vertlon) {
-        free(handle->fence.vertlon);
-    }
-
-    if (handle->params.uinNo) {
-        free(handle->params.uinNo);
-    }
-
-    if (handle->params.adcNumber) {
-        free(handle->params.adcNumber);
-    }
+    npnt_permit_free(&handle->permit);
+    npnt_permit_store_free(&handle->store);
 
-    if (handle->params.ficNumber) {
-        free(handle->params.ficNumber);
-    }
-
-    memset(handle, 0, sizeof(npnt_s));
+    //rcu leads the handle, its counters stay so sections opened meanwhile still end on them
+    memset((uint8_t*)handle + sizeof(handle->rcu), 0, sizeof(npnt_s) - sizeof(handle->rcu));
 
     return 0;
 }
@@ -0,0 +1,192 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#include <math.h>
+
+//WGS84 ellipsoid
+#define WGS84_A         6378137.0
+#define WGS84_E2        6.69437999014e-3
+#define DEG_TO_RAD      (M_PI / 180.0)
+
+/*
+ * Area weighted centroid of the polygon in degrees. Coordinates are taken
+ * relative to the first vertex to keep the shoelace sums well conditioned.
+ * Falls back to the vertex mean for degenerate (zero area) polygons.
+ */
+static void fence_centroid(const float* vertlat, const float* vertlon, uint32_t nverts, double* lat, double* lon)
+{
+    double lat0 = vertlat[0], lon0 = vertlon[0];
+    double area = 0, cx = 0, cy = 0;
+    double xi, yi, xj, yj, cross;
+    uint32_t i, j;
+
+    for (i = 0, j = nverts - 1; i < nverts; j = i++) {
+        xi = vertlon[i] - lon0;
+        yi = vertlat[i] - lat0;
+        xj = vertlon[j] - lon0;
+        yj = vertlat[j] - lat0;
+        cross = xj * yi - xi * yj;
+        area += cross;
+        cx += (xj + xi) * cross;
+        cy += (yj + yi) * cross;
+    }
+
+    if (fabs(area) > 1e-12) {
+        *lon = lon0 + cx / (3.0 * area);
+        *lat = lat0 + cy / (3.0 * area);
+        return;
+    }
+
+    cx = 0;
+    cy = 0;
+    for (i = 0; i < nverts; i++) {
+        cx += vertlon[i] - lon0;
+        cy += vertlat[i] - lat0;
+    }
+    *lon = lon0 + cx / nverts;
+    *lat = lat0 + cy / nverts;
+}
+
+/*
+ * Equirectangular approximation of the local tangent plane, using the
+ * meridional and prime vertical radii of curvature at the origin latitude.
+ * Error stays well under a meter across fences a few km wide.
+ */
+static void frame_init(npnt_frame_s *frame, double lat, double lon)
+{
+    double s = sin(lat * DEG_TO_RAD);
+    double w = 1.0 - WGS84_E2 * s * s;
+    double sqrt_w = sqrt(w);
+
+    frame->origin_lat = lat;
+    frame->origin_lon = lon;
+    frame->m_per_deg_lat = DEG_TO_RAD * WGS84_A * (1.0 - WGS84_E2) / (w * sqrt_w);
+    frame->m_per_deg_lon = DEG_TO_RAD * WGS84_A * cos(lat * DEG_TO_RAD) / sqrt_w;
+}
+
+void npnt_frame_to_local(const npnt_frame_s *frame, float lat, float lon, float *x, float *y)
+{
+    *x = (float)((lon - frame->origin_lon) * frame->m_per_deg_lon);
+    *y = (float)((lat - frame->origin_lat) * frame->m_per_deg_lat);
+}
+
+void npnt_frame_to_geo(const npnt_frame_s *frame, float x, float y, float *lat, float *lon)
+{
+    *lat = (float)(frame->origin_lat + y / frame->m_per_deg_lat);
+    *lon = (float)(frame->origin_lon + x / frame->m_per_deg_lon);
+}
+
+int8_t npnt_fence_project(npnt_s *handle)
+{
+    double lat, lon;
+    float *vertx, *verty;
+    uint32_t nverts, i;
+    int8_t ret;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    if (!handle->permit.info || !handle->permit.info->vertlat || handle->permit.info->nverts == 0) {
+        return NPNT_BAD_FENCE;
+    }
+
+    fence_centroid(handle->permit.info->vertlat, handle->permit.info->vertlon, handle->permit.info->nverts, &lat, &lon);
+    frame_init(&handle->permit.frame, lat, lon);
+
+    vertx = (float*)npnt_malloc(handle->permit.info->nverts*sizeof(float));
+    verty = (float*)npnt_malloc(handle->permit.info->nverts*sizeof(float));
+    if (!vertx || !verty) {
+        npnt_free(vertx);
+        npnt_free(verty);
+        return NPNT_BAD_FENCE;
+    }
+
+    for (i = 0; i < handle->permit.info->nverts; i++) {
+        npnt_frame_to_local(&handle->permit.frame, handle->permit.info->vertlat[i], handle->permit.info->vertlon[i],
+                            &vertx[i], &verty[i]);
+    }
+
+    //Drop duplicate and collinear vertices, orient and validate
+    nverts = handle->permit.info->nverts;
+    ret = npnt_fence_normalize(vertx, verty, handle->permit.info->vertlat, handle->permit.info->vertlon, &nverts);
+    handle->permit.info->nverts = nverts;
+    if (ret < 0) {
+        npnt_free(vertx);
+        npnt_free(verty);
+        return ret;
+    }
+
+    //Artefact fence becomes zone 0, indexed for distance and ray queries
+    ret = npnt_fence_set_add(&handle->permit.set, NPNT_ZONE_INCLUDE, 0, vertx, verty, nverts);
+    if (ret < 0) {
+        npnt_free(vertx);
+        npnt_free(verty);
+        return ret;
+    }
+    return npnt_fence_set_build(&handle->permit.set);
+}
+
+bool npnt_fence_contains(npnt_s *handle, float lat, float lon)
+{
+    return npnt_fence_query(handle, lat, lon, NULL) == NPNT_FENCE_INSIDE;
+}
+
+static int8_t fence_margin(const npnt_permit_s *permit, float lat, float lon, float altitude_agl,
+                           float vel_n, float vel_e, float vel_d, npnt_fence_margin_s *margin)
+{
+    float x, y, t, climb;
+    uint32_t zone = 0;
+    bool inside;
+
+    if (!margin || !permit) {
+        return NPNT_BAD_FENCE;
+    }
+    npnt_frame_to_local(&permit->frame, lat, lon, &x, &y);
+
+    inside = npnt_fence_set_query(&permit->set, x, y, NULL) == NPNT_FENCE_INSIDE;
+    margin->fence_dist = npnt_fence_set_nearest(&permit->set, x, y, &zone, &margin->nearest_edge);
+    margin->nearest_zone = permit->set.zones[zone].id;
+    if (!inside) {
+        margin->fence_dist = -margin->fence_dist;
+    }
+    margin->ceiling_dist = permit->maxAltitude - altitude_agl;
+
+    if (!inside || margin->ceiling_dist < 0) {
+        margin->time_to_breach = 0;
+        return 0;
+    }
+
+    //ray is parameterised in seconds, so the first boundary hit is the time to breach
+    margin->time_to_breach = INFINITY;
+    if (vel_n != 0 || vel_e != 0) {
+        margin->time_to_breach = npnt_fence_set_raycast(&permit->set, x, y, vel_e, vel_n);
+    }
+    climb = -vel_d;
+    if (climb > 0) {
+        t = margin->ceiling_dist / climb;
+        if (t < margin->time_to_breach) {
+            margin->time_to_breach = t;
+        }
+    }
+    return 0;
+}
+
+int8_t npnt_fence_margin(npnt_s *handle, float lat, float lon, float altitude_agl,
+                         float vel_n, float vel_e, float vel_d, npnt_fence_margin_s *margin)
+{
+    const npnt_permit_s *permit;
+    uint8_t slot;
+    int8_t ret;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    permit = npnt_permit_read_begin(handle, &slot);
+    ret = fence_margin(permit, lat, lon, altitude_agl, vel_n, vel_e, vel_d, margin);
+    npnt_permit_read_end(handle, slot);
+    return ret;
+}
@@ -0,0 +1,480 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#include <math.h>
+
+//Cells per vertex, keeps a handful of edges per cell on typical fences
+#define GRID_CELLS_PER_VERT     2
+#define GRID_MAX_DIM            1024
+//Reference point offsets tried before giving up on a clear one
+#define GRID_REF_TRIES          8
+
+#define GRID_NEXT(i, n)         (((i) + 1 == (n)) ? 0 : (i) + 1)
+
+static int32_t grid_col(const npnt_grid_s *grid, float x)
+{
+    int32_t c = (int32_t)floorf((x - grid->minx) / grid->cell);
+    if (c < 0) {
+        return 0;
+    }
+    if (c >= grid->ncols) {
+        return grid->ncols - 1;
+    }
+    return c;
+}
+
+static int32_t grid_row(const npnt_grid_s *grid, float y)
+{
+    int32_t r = (int32_t)floorf((y - grid->miny) / grid->cell);
+    if (r < 0) {
+        return 0;
+    }
+    if (r >= grid->nrows) {
+        return grid->nrows - 1;
+    }
+    return r;
+}
+
+static float orient(float ax, float ay, float bx, float by, float cx, float cy)
+{
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+/*
+ * Crossing test between segments c-p and a-b with half open end point
+ * rules, so that parity stays consistent when c-p passes through a vertex.
+ */
+static bool segments_cross(float cx, float cy, float px, float py, float ax, float ay, float bx, float by)
+{
+    if ((orient(cx, cy, px, py, ax, ay) > 0) == (orient(cx, cy, px, py, bx, by) > 0)) {
+        return false;
+    }
+    return (orient(ax, ay, bx, by, cx, cy) > 0) != (orient(ax, ay, bx, by, px, py) > 0);
+}
+
+float npnt_seg_dist_sq(float px, float py, float ax, float ay, float bx, float by)
+{
+    float ex = bx - ax, ey = by - ay;
+    float wx = px - ax, wy = py - ay;
+    float len_sq = ex * ex + ey * ey;
+    float t = 0;
+    if (len_sq > 0) {
+        t = (wx * ex + wy * ey) / len_sq;
+        if (t < 0) {
+            t = 0;
+        } else if (t > 1) {
+            t = 1;
+        }
+    }
+    wx -= t * ex;
+    wy -= t * ey;
+    return wx * wx + wy * wy;
+}
+
+/*
+ * Adds edge a-b to every cell it passes through, one row band at a time.
+ * With out == NULL only the per cell counts are accumulated.
+ */
+static void grid_add_edge(npnt_grid_s *grid, uint32_t* counts, uint32_t* out, uint32_t edge,
+                          float ax, float ay, float bx, float by)
+{
+    float eps = grid->cell * 1e-3f;
+    float lo_y = fminf(ay, by), hi_y = fmaxf(ay, by);
+    float ylo, yhi, x0, x1;
+    int32_t r, c, r0, r1, c0, c1;
+    uint32_t idx;
+
+    r0 = grid_row(grid, lo_y - eps);
+    r1 = grid_row(grid, hi_y + eps);
+    for (r = r0; r <= r1; r++) {
+        ylo = fmaxf(grid->miny + r * grid->cell, lo_y);
+        yhi = fminf(grid->miny + (r + 1) * grid->cell, hi_y);
+        if (ay == by) {
+            x0 = ax;
+            x1 = bx;
+        } else {
+            x0 = ax + (ylo - ay) * (bx - ax) / (by - ay);
+            x1 = ax + (yhi - ay) * (bx - ax) / (by - ay);
+        }
+        c0 = grid_col(grid, fminf(x0, x1) - eps);
+        c1 = grid_col(grid, fmaxf(x0, x1) + eps);
+        for (c = c0; c <= c1; c++) {
+            idx = (uint32_t)r * grid->ncols + c;
+            if (out) {
+                out[counts[idx]++] = edge;
+            } else {
+                counts[idx]++;
+            }
+        }
+    }
+}
+
+static int float_cmp(const void* a, const void* b)
+{
+    float fa = *(const float*)a, fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+/*
+ * Crossings are only counted right from a reference point off every edge,
+ * on an edge the half open rules of the classification and of the query
+ * disagree. Symmetric or lattice aligned fences easily run an edge through
+ * a cell center, then all reference points move to the next offset. The x
+ * and y offsets step by different irrational fractions, so they neither
+ * settle on simple fractions of the cell nor line up along diagonals.
+ */
+//In double, float cancellation is larger than the margin at fence coordinates
+static bool grid_near_edge(float px, float py, float ax, float ay, float bx, float by, float margin)
+{
+    double ex = (double)bx - ax, ey = (double)by - ay;
+    double wx = (double)px - ax, wy = (double)py - ay;
+    double len_sq = ex * ex + ey * ey, t, d;
+
+    if (len_sq == 0) {
+        return wx * wx + wy * wy <= (double)margin * margin;
+    }
+    t = (wx * ex + wy * ey) / len_sq;
+    if (t < 0) {
+        t = 0;
+    } else if (t > 1) {
+        t = 1;
+    }
+    d = (wx - t * ex) * (wx - t * ex) + (wy - t * ey) * (wy - t * ey);
+    return d <= (double)margin * margin;
+}
+
+static void grid_pick_ref(npnt_grid_s *grid, const float* vertx, const float* verty, uint32_t nverts)
+{
+    float margin = grid->cell * 1e-5f, rx, ry;
+    uint32_t t, r, c, k, e, n, cell;
+    bool clear = false;
+
+    for (t = 0; t < GRID_REF_TRIES && !clear; t++) {
+        grid->refx = t ? 0.1f + 0.8f * fmodf(t * 0.618034f, 1.0f) : 0.5f;
+        grid->refy = t ? 0.1f + 0.8f * fmodf(t * 0.414214f, 1.0f) : 0.5f;
+        clear = true;
+        for (r = 0; r < grid->nrows && clear; r++) {
+            ry = grid->miny + (r + grid->refy) * grid->cell;
+            for (c = 0; c < grid->ncols && clear; c++) {
+                rx = grid->minx + (c + grid->refx) * grid->cell;
+                cell = r * grid->ncols + c;
+                for (k = grid->cell_start[cell]; k < grid->cell_start[cell + 1]; k++) {
+                    e = grid->cell_edges[k];
+                    n = GRID_NEXT(e, nverts);
+                    if (grid_near_edge(rx, ry, vertx[e], verty[e], vertx[n], verty[n], margin)) {
+                        clear = false;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Classifies reference points one row at a time: the edges straddling the
+ * row's reference line are all listed in that row's cells, so sorting
+ * their crossings gives the inside runs along the row.
+ */
+static int8_t grid_classify_refs(npnt_grid_s *grid, const float* vertx, const float* verty, uint32_t nverts)
+{
+    uint32_t *stamp;
+    float *xs, cy, cx;
+    uint32_t nxs, k, e, n, r, c, cell;
+
+    stamp = (uint32_t*)npnt_malloc(nverts*sizeof(uint32_t));
+    xs = (float*)npnt_malloc(nverts*sizeof(float));
+    if (!stamp || !xs) {
+        npnt_free(stamp);
+        npnt_free(xs);
+        return -1;
+    }
+    memset(stamp, 0xFF, nverts*sizeof(uint32_t));
+
+    for (r = 0; r < grid->nrows; r++) {
+        cy = grid->miny + (r + grid->refy) * grid->cell;
+        nxs = 0;
+        for (c = 0; c < grid->ncols; c++) {
+            cell = r * grid->ncols + c;
+            for (k = grid->cell_start[cell]; k < grid->cell_start[cell + 1]; k++) {
+                e = grid->cell_edges[k];
+                if (stamp[e] == r) {
+                    continue;
+                }
+                stamp[e] = r;
+                n = GRID_NEXT(e, nverts);
+                if ((verty[e] > cy) != (verty[n] > cy)) {
+                    xs[nxs++] = vertx[e] + (cy - verty[e]) * (vertx[n] - vertx[e]) / (verty[n] - verty[e]);
+                }
+            }
+        }
+        qsort(xs, nxs, sizeof(float), float_cmp);
+        k = 0;
+        for (c = 0; c < grid->ncols; c++) {
+            cx = grid->minx + (c + grid->refx) * grid->cell;
+            while (k < nxs && xs[k] <= cx) {
+                k++;
+            }
+            if ((nxs - k) & 1) {
+                cell = r * grid->ncols + c;
+                grid->ref_in[cell >> 3] |= (uint8_t)(1 << (cell & 7));
+            }
+        }
+    }
+    npnt_free(stamp);
+    npnt_free(xs);
+    return 0;
+}
+
+int8_t npnt_grid_build(npnt_grid_s *grid, const float* vertx, const float* verty, uint32_t nverts)
+{
+    float minx, miny, maxx, maxy, w, h;
+    uint32_t i, ncells, *counts;
+
+    if (!grid || !vertx || !verty || nverts < 3) {
+        return -1;
+    }
+    memset(grid, 0, sizeof(npnt_grid_s));
+
+    minx = maxx = vertx[0];
+    miny = maxy = verty[0];
+    for (i = 1; i < nverts; i++) {
+        minx = fminf(minx, vertx[i]);
+        maxx = fmaxf(maxx, vertx[i]);
+        miny = fminf(miny, verty[i]);
+        maxy = fmaxf(maxy, verty[i]);
+    }
+    w = fmaxf(maxx - minx, 1.0f);
+    h = fmaxf(maxy - miny, 1.0f);
+
+    grid->cell = sqrtf(w * h / (float)(nverts * GRID_CELLS_PER_VERT));
+    grid->cell = fmaxf(grid->cell, fmaxf(w, h) / GRID_MAX_DIM);
+    grid->ncols = (uint16_t)fminf(ceilf(w / grid->cell), GRID_MAX_DIM);
+    grid->nrows = (uint16_t)fminf(ceilf(h / grid->cell), GRID_MAX_DIM);
+    if (grid->ncols == 0) {
+        grid->ncols = 1;
+    }
+    if (grid->nrows == 0) {
+        grid->nrows = 1;
+    }
+    //center the grid on the polygon bounds
+    grid->minx = minx - (grid->ncols * grid->cell - (maxx - minx)) / 2;
+    grid->miny = miny - (grid->nrows * grid->cell - (maxy - miny)) / 2;
+
+    ncells = (uint32_t)grid->ncols * grid->nrows;
+    grid->cell_start = (uint32_t*)npnt_calloc(ncells + 1, sizeof(uint32_t));
+    grid->ref_in = (uint8_t*)npnt_calloc((ncells + 7) / 8, 1);
+    counts = (uint32_t*)npnt_calloc(ncells, sizeof(uint32_t));
+    if (!grid->cell_start || !grid->ref_in || !counts) {
+        goto fail;
+    }
+
+    for (i = 0; i < nverts; i++) {
+        grid_add_edge(grid, counts, NULL, i, vertx[i], verty[i],
+                      vertx[GRID_NEXT(i, nverts)], verty[GRID_NEXT(i, nverts)]);
+    }
+    for (i = 0; i < ncells; i++) {
+        grid->cell_start[i + 1] = grid->cell_start[i] + counts[i];
+        counts[i] = grid->cell_start[i];
+    }
+    grid->cell_edges = (uint32_t*)npnt_malloc((grid->cell_start[ncells] + 1)*sizeof(uint32_t));
+    if (!grid->cell_edges) {
+        goto fail;
+    }
+    for (i = 0; i < nverts; i++) {
+        grid_add_edge(grid, counts, grid->cell_edges, i, vertx[i], verty[i],
+                      vertx[GRID_NEXT(i, nverts)], verty[GRID_NEXT(i, nverts)]);
+    }
+
+    grid_pick_ref(grid, vertx, verty, nverts);
+    if (grid_classify_refs(grid, vertx, verty, nverts) < 0) {
+        goto fail;
+    }
+    npnt_free(counts);
+    return 0;
+fail:
+    npnt_free(counts);
+    npnt_grid_free(grid);
+    return -1;
+}
+
+void npnt_grid_free(npnt_grid_s *grid)
+{
+    if (!grid) {
+        return;
+    }
+    npnt_free(grid->cell_start);
+    npnt_free(grid->cell_edges);
+    npnt_free(grid->ref_in);
+    memset(grid, 0, sizeof(npnt_grid_s));
+}
+
+bool npnt_grid_contains(const npnt_grid_s *grid, const float* vertx, const float* verty, uint32_t nverts,
+                        float x, float y)
+{
+    uint32_t cell, k, e, n;
+    int32_t c, r;
+    float cx, cy;
+    bool inside;
+
+    if (x < grid->minx || y < grid->miny ||
+        x > grid->minx + grid->ncols * grid->cell ||
+        y > grid->miny + grid->nrows * grid->cell) {
+        return false;
+    }
+    c = grid_col(grid, x);
+    r = grid_row(grid, y);
+    cell = (uint32_t)r * grid->ncols + c;
+    cx = grid->minx + (c + grid->refx) * grid->cell;
+    cy = grid->miny + (r + grid->refy) * grid->cell;
+    inside = (grid->ref_in[cell >> 3] >> (cell & 7)) & 1;
+
+    //flip for every edge between reference point and query point
+    for (k = grid->cell_start[cell]; k < grid->cell_start[cell + 1]; k++) {
+        e = grid->cell_edges[k];
+        n = GRID_NEXT(e, nverts);
+        if (segments_cross(cx, cy, x, y, vertx[e], verty[e], vertx[n], verty[n])) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+/*
+ * Searches rings of cells around the query cell. Any cell in ring k + 1 is
+ * at least k cells away from the query point, so the search stops as soon
+ * as the best distance found is within that bound.
+ */
+float npnt_grid_nearest_edge(const npnt_grid_s *grid, const float* vertx, const float* verty, uint32_t nverts,
+                             float x, float y, uint32_t* edge)
+{
+    int32_t c0, r0, c, r, ring, max_ring;
+    uint32_t cell, k, e, n;
+    float best = INFINITY, d, reach;
+
+    c0 = grid_col(grid, x);
+    r0 = grid_row(grid, y);
+    max_ring = grid->ncols > grid->nrows ? grid->ncols : grid->nrows;
+    for (ring = 0; ring <= max_ring; ring++) {
+        reach = (ring - 1) * grid->cell;
+        if (ring > 0 && best <= reach * reach) {
+            break;
+        }
+        for (r = r0 - ring; r <= r0 + ring; r++) {
+            if (r < 0 || r >= grid->nrows) {
+                continue;
+            }
+            for (c = c0 - ring; c <= c0 + ring; c++) {
+                if (c < 0 || c >= grid->ncols) {
+                    continue;
+                }
+                //only the ring border, inner cells were visited already
+                if (r != r0 - ring && r != r0 + ring && c != c0 - ring && c != c0 + ring) {
+                    continue;
+                }
+                cell = (uint32_t)r * grid->ncols + c;
+                for (k = grid->cell_start[cell]; k < grid->cell_start[cell + 1]; k++) {
+                    e = grid->cell_edges[k];
+                    n = GRID_NEXT(e, nverts);
+                    d = npnt_seg_dist_sq(x, y, vertx[e], verty[e], vertx[n], verty[n]);
+                    if (d < best) {
+                        best = d;
+                        if (edge) {
+                            *edge = e;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return sqrtf(best);
+}
+
+/*
+ * Walks the cells along the ray p + t*d (Amanatides-Woo traversal) and
+ * returns the smallest t at which it meets an edge, INFINITY if none.
+ */
+float npnt_grid_raycast(const npnt_grid_s *grid, const float* vertx, const float* verty, uint32_t nverts,
+                        float x, float y, float dx, float dy)
+{
+    float t_enter = 0, t_exit = INFINITY, t0, t1, tmp;
+    float gmax_x = grid->minx + grid->ncols * grid->cell;
+    float gmax_y = grid->miny + grid->nrows * grid->cell;
+    float t_max_x, t_max_y, t_delta_x, t_delta_y, t_cell;
+    float best = INFINITY, denom, ex, ey, wx, wy, t, u;
+    int32_t c, r, step_c, step_r;
+    uint32_t cell, k, e, n;
+
+    //clip ray against grid bounds
+    if (dx != 0) {
+        t0 = (grid->minx - x) / dx;
+        t1 = (gmax_x - x) / dx;
+        if (t0 > t1) {
+            tmp = t0; t0 = t1; t1 = tmp;
+        }
+        t_enter = fmaxf(t_enter, t0);
+        t_exit = fminf(t_exit, t1);
+    } else if (x < grid->minx || x > gmax_x) {
+        return INFINITY;
+    }
+    if (dy != 0) {
+        t0 = (grid->miny - y) / dy;
+        t1 = (gmax_y - y) / dy;
+        if (t0 > t1) {
+            tmp = t0; t0 = t1; t1 = tmp;
+        }
+        t_enter = fmaxf(t_enter, t0);
+        t_exit = fminf(t_exit, t1);
+    } else if (y < grid->miny || y > gmax_y) {
+        return INFINITY;
+    }
+    if (t_enter > t_exit) {
+        return INFINITY;
+    }
+
+    c = grid_col(grid, x + t_enter * dx);
+    r = grid_row(grid, y + t_enter * dy);
+    step_c = dx > 0 ? 1 : -1;
+    step_r = dy > 0 ? 1 : -1;
+    t_delta_x = dx != 0 ? grid->cell / fabsf(dx) : INFINITY;
+    t_delta_y = dy != 0 ? grid->cell / fabsf(dy) : INFINITY;
+    t_max_x = dx != 0 ? (grid->minx + (c + (dx > 0)) * grid->cell - x) / dx : INFINITY;
+    t_max_y = dy != 0 ? (grid->miny + (r + (dy > 0)) * grid->cell - y) / dy : INFINITY;
+
+    while (c >= 0 && c < grid->ncols && r >= 0 && r < grid->nrows) {
+        cell = (uint32_t)r * grid->ncols + c;
+        for (k = grid->cell_start[cell]; k < grid->cell_start[cell + 1]; k++) {
+            e = grid->cell_edges[k];
+            n = GRID_NEXT(e, nverts);
+            ex = vertx[n] - vertx[e];
+            ey = verty[n] - verty[e];
+            denom = dx * ey - dy * ex;
+            if (denom == 0) {
+                continue;
+            }
+            wx = vertx[e] - x;
+            wy = verty[e] - y;
+            t = (wx * ey - wy * ex) / denom;
+            u = (wx * dy - wy * dx) / denom;
+            if (t >= 0 && u >= 0 && u <= 1 && t < best) {
+                best = t;
+            }
+        }
+        t_cell = fminf(t_max_x, t_max_y);
+        if (best <= t_cell) {
+            break;
+        }
+        if (t_max_x < t_max_y) {
+            t_max_x += t_delta_x;
+            c += step_c;
+        } else {
+            t_max_y += t_delta_y;
+            r += step_r;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,437 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#include <math.h>
+
+/*
+ * Load time fence normalization. Vertices closer than NPNT_FENCE_EPS are
+ * merged, vertices within NPNT_FENCE_EPS of the line through their
+ * neighbours are dropped, the ring is turned counter clockwise and then
+ * checked for self intersections with a Shamos-Hoey sweep, O(n log n).
+ */
+
+typedef struct {
+    const float* vertx;
+    const float* verty;
+    uint32_t nverts;
+    bool touch;             //two non adjacent edges compared equal
+    uint32_t* lch;          //treap over edges ordered along the sweep line
+    uint32_t* rch;
+    uint32_t* pri;
+    uint32_t root;
+} sweep_s;
+
+#define SWEEP_NIL   UINT32_MAX
+
+static void norm_move(float* vertx, float* verty, float* lat, float* lon, uint32_t to, uint32_t from)
+{
+    vertx[to] = vertx[from];
+    verty[to] = verty[from];
+    if (lat && lon) {
+        lat[to] = lat[from];
+        lon[to] = lon[from];
+    }
+}
+
+static double cross3(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+//Vertex b adds nothing to the ring a-b-c
+static bool norm_redundant(const float* vertx, const float* verty, uint32_t a, uint32_t b, uint32_t c)
+{
+    double dx = vertx[c] - vertx[a], dy = verty[c] - verty[a];
+    double len = sqrt(dx * dx + dy * dy);
+    double area = fabs(cross3(vertx[a], verty[a], vertx[b], verty[b], vertx[c], verty[c]));
+    if (len < NPNT_FENCE_EPS) {
+        //a and c coincide, b is the tip of a zero width spike
+        return true;
+    }
+    return area <= NPNT_FENCE_EPS * len;
+}
+
+static uint32_t norm_dedup(float* vertx, float* verty, float* lat, float* lon, uint32_t nverts)
+{
+    uint32_t i, n = 0;
+    double dx, dy;
+    for (i = 0; i < nverts; i++) {
+        if (n > 0) {
+            dx = vertx[i] - vertx[n - 1];
+            dy = verty[i] - verty[n - 1];
+            if (dx * dx + dy * dy < NPNT_FENCE_EPS * NPNT_FENCE_EPS) {
+                continue;
+            }
+        }
+        norm_move(vertx, verty, lat, lon, n++, i);
+    }
+    //closing vertex repeating the first one
+    while (n > 1) {
+        dx = vertx[n - 1] - vertx[0];
+        dy = verty[n - 1] - verty[0];
+        if (dx * dx + dy * dy >= NPNT_FENCE_EPS * NPNT_FENCE_EPS) {
+            break;
+        }
+        n--;
+    }
+    return n;
+}
+
+//Single stack pass, then the seam between last and first vertex is fixed up
+static uint32_t norm_collinear(float* vertx, float* verty, float* lat, float* lon, uint32_t nverts)
+{
+    uint32_t i, n = 0, start = 0;
+    bool changed = true;
+
+    for (i = 0; i < nverts; i++) {
+        while (n >= 2 && norm_redundant(vertx, verty, n - 2, n - 1, i)) {
+            n--;
+        }
+        norm_move(vertx, verty, lat, lon, n++, i);
+    }
+    while (changed && n - start >= 3) {
+        changed = false;
+        if (norm_redundant(vertx, verty, n - 2, n - 1, start)) {
+            n--;
+            changed = true;
+        }
+        if (n - start >= 3 && norm_redundant(vertx, verty, n - 1, start, start + 1)) {
+            start++;
+            changed = true;
+        }
+    }
+    for (i = 0; i < n - start; i++) {
+        norm_move(vertx, verty, lat, lon, i, start + i);
+    }
+    return n - start;
+}
+
+static void norm_reverse(float* arr, uint32_t n)
+{
+    uint32_t i;
+    float tmp;
+    for (i = 0; i < n / 2; i++) {
+        tmp = arr[i];
+        arr[i] = arr[n - 1 - i];
+        arr[n - 1 - i] = tmp;
+    }
+}
+
+static uint32_t edge_next(const sweep_s *sw, uint32_t e)
+{
+    return e + 1 == sw->nverts ? 0 : e + 1;
+}
+
+//Edge endpoints ordered left to right (then bottom to top)
+static void edge_ends(const sweep_s *sw, uint32_t e, double* x0, double* y0, double* x1, double* y1)
+{
+    uint32_t a = e, b = edge_next(sw, e), t;
+    if (sw->vertx[a] > sw->vertx[b] || (sw->vertx[a] == sw->vertx[b] && sw->verty[a] > sw->verty[b])) {
+        t = a; a = b; b = t;
+    }
+    *x0 = sw->vertx[a];
+    *y0 = sw->verty[a];
+    *x1 = sw->vertx[b];
+    *y1 = sw->verty[b];
+}
+
+static double edge_y_at(double x0, double y0, double x1, double y1, double x)
+{
+    return y0 + (x - x0) * (y1 - y0) / (x1 - x0);
+}
+
+/*
+ * Order of a vertical edge a against edge b. b either misses a, or shares
+ * one of its ends, in which case a lies above b at its bottom end and
+ * below b at its top end, as for an edge leaning slightly to the right.
+ */
+static int sweep_cmp_vertical(sweep_s *sw, uint32_t a, uint32_t b, double ay0, double ay1, double yb)
+{
+    if (yb < ay0) {
+        return 1;
+    }
+    if (yb > ay1) {
+        return -1;
+    }
+    if ((yb != ay0 && yb != ay1) || (edge_next(sw, a) != b && edge_next(sw, b) != a)) {
+        sw->touch = true;
+    }
+    return yb < (ay0 + ay1) / 2 ? 1 : -1;
+}
+
+/*
+ * Order of two edges along the sweep line. Edges that do not intersect
+ * keep the same order over their whole common x range, so comparing at the
+ * middle of that range gives an order independent of the sweep position.
+ * Edges sharing a point other than the common vertex of adjacent edges
+ * set touch, the order returned for them is only kept consistent.
+ */
+static int sweep_cmp(sweep_s *sw, uint32_t a, uint32_t b)
+{
+    double ax0, ay0, ax1, ay1, bx0, by0, bx1, by1;
+    double x, ya, yb;
+    if (a == b) {
+        return 0;
+    }
+    edge_ends(sw, a, &ax0, &ay0, &ax1, &ay1);
+    edge_ends(sw, b, &bx0, &by0, &bx1, &by1);
+    if (ax0 == ax1 && bx0 == bx1) {
+        if (ay1 <= by0 || by1 <= ay0) {
+            return ay0 < by0 ? -1 : 1;
+        }
+        sw->touch = true;
+    } else if (ax0 == ax1) {
+        return sweep_cmp_vertical(sw, a, b, ay0, ay1, edge_y_at(bx0, by0, bx1, by1, ax0));
+    } else if (bx0 == bx1) {
+        return -sweep_cmp_vertical(sw, b, a, by0, by1, edge_y_at(ax0, ay0, ax1, ay1, bx0));
+    } else {
+        x = (fmax(ax0, bx0) + fmin(ax1, bx1)) / 2;
+        ya = edge_y_at(ax0, ay0, ax1, ay1, x);
+        yb = edge_y_at(bx0, by0, bx1, by1, x);
+        if (ya != yb) {
+            return ya < yb ? -1 : 1;
+        }
+        if (edge_next(sw, a) != b && edge_next(sw, b) != a) {
+            sw->touch = true;
+        }
+    }
+    return a < b ? -1 : 1;
+}
+
+static uint32_t treap_insert(sweep_s *sw, uint32_t node, uint32_t e)
+{
+    uint32_t child;
+    if (node == SWEEP_NIL) {
+        sw->lch[e] = sw->rch[e] = SWEEP_NIL;
+        return e;
+    }
+    if (sweep_cmp(sw, e, node) < 0) {
+        sw->lch[node] = treap_insert(sw, sw->lch[node], e);
+        if (sw->pri[sw->lch[node]] > sw->pri[node]) {
+            child = sw->lch[node];
+            sw->lch[node] = sw->rch[child];
+            sw->rch[child] = node;
+            return child;
+        }
+    } else {
+        sw->rch[node] = treap_insert(sw, sw->rch[node], e);
+        if (sw->pri[sw->rch[node]] > sw->pri[node]) {
+            child = sw->rch[node];
+            sw->rch[node] = sw->lch[child];
+            sw->lch[child] = node;
+            return child;
+        }
+    }
+    return node;
+}
+
+static uint32_t treap_remove(sweep_s *sw, uint32_t node, uint32_t e)
+{
+    uint32_t child;
+    int cmp;
+    if (node == SWEEP_NIL) {
+        return SWEEP_NIL;
+    }
+    cmp = sweep_cmp(sw, e, node);
+    if (cmp < 0) {
+        sw->lch[node] = treap_remove(sw, sw->lch[node], e);
+        return node;
+    }
+    if (cmp > 0) {
+        sw->rch[node] = treap_remove(sw, sw->rch[node], e);
+        return node;
+    }
+    //rotate the node down until it becomes a leaf
+    if (sw->lch[node] == SWEEP_NIL) {
+        return sw->rch[node];
+    }
+    if (sw->rch[node] == SWEEP_NIL) {
+        return sw->lch[node];
+    }
+    if (sw->pri[sw->lch[node]] > sw->pri[sw->rch[node]]) {
+        child = sw->lch[node];
+        sw->lch[node] = sw->rch[child];
+        sw->rch[child] = treap_remove(sw, node, e);
+    } else {
+        child = sw->rch[node];
+        sw->rch[node] = sw->lch[child];
+        sw->lch[child] = treap_remove(sw, node, e);
+    }
+    return child;
+}
+
+//Closest edge below (dir < 0) or above (dir > 0) e along the sweep line
+static uint32_t treap_neighbour(sweep_s *sw, uint32_t e, int dir)
+{
+    uint32_t node = sw->root, best = SWEEP_NIL;
+    int cmp;
+    while (node != SWEEP_NIL) {
+        cmp = sweep_cmp(sw, node, e);
+        if (dir < 0 ? cmp < 0 : cmp > 0) {
+            best = node;
+            node = dir < 0 ? sw->rch[node] : sw->lch[node];
+        } else {
+            node = dir < 0 ? sw->lch[node] : sw->rch[node];
+        }
+    }
+    return best;
+}
+
+static bool on_segment(double ax, double ay, double bx, double by, double px, double py)
+{
+    return fmin(ax, bx) <= px && px <= fmax(ax, bx) && fmin(ay, by) <= py && py <= fmax(ay, by);
+}
+
+//Closed segment intersection, edges sharing a vertex are never reported
+static bool edges_intersect(const sweep_s *sw, uint32_t a, uint32_t b)
+{
+    double ax0, ay0, ax1, ay1, bx0, by0, bx1, by1, d1, d2, d3, d4;
+    if (a == SWEEP_NIL || b == SWEEP_NIL) {
+        return false;
+    }
+    if (edge_next(sw, a) == b || edge_next(sw, b) == a) {
+        return false;
+    }
+    edge_ends(sw, a, &ax0, &ay0, &ax1, &ay1);
+    edge_ends(sw, b, &bx0, &by0, &bx1, &by1);
+    d1 = cross3(bx0, by0, bx1, by1, ax0, ay0);
+    d2 = cross3(bx0, by0, bx1, by1, ax1, ay1);
+    d3 = cross3(ax0, ay0, ax1, ay1, bx0, by0);
+    d4 = cross3(ax0, ay0, ax1, ay1, bx1, by1);
+    if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0))) {
+        return true;
+    }
+    return (d1 == 0 && on_segment(bx0, by0, bx1, by1, ax0, ay0)) ||
+           (d2 == 0 && on_segment(bx0, by0, bx1, by1, ax1, ay1)) ||
+           (d3 == 0 && on_segment(ax0, ay0, ax1, ay1, bx0, by0)) ||
+           (d4 == 0 && on_segment(ax0, ay0, ax1, ay1, bx1, by1));
+}
+
+/*
+ * Sweep events sorted by point, right ends first so that an edge ending at
+ * a vertex never gets ordered against the edge starting there. Vertices
+ * shared by more than two edges are caught separately.
+ */
+typedef struct {
+    double x, y;
+    uint32_t ev;            //edge * 2, plus 1 for the right end
+} sweep_event_s;
+
+static int event_cmp(const void* pa, const void* pb)
+{
+    const sweep_event_s *a = (const sweep_event_s*)pa, *b = (const sweep_event_s*)pb;
+    if (a->x != b->x) {
+        return a->x < b->x ? -1 : 1;
+    }
+    if (a->y != b->y) {
+        return a->y < b->y ? -1 : 1;
+    }
+    return (int)(b->ev & 1) - (int)(a->ev & 1);
+}
+
+static int8_t norm_check_simple(const float* vertx, const float* verty, uint32_t nverts)
+{
+    sweep_s sw;
+    sweep_event_s *events;
+    uint32_t i, e, below, above, seed = 0x9E3779B9u, run = 0;
+    double x0, y0, x1, y1;
+    int8_t ret = 0;
+
+    sw.vertx = vertx;
+    sw.verty = verty;
+    sw.nverts = nverts;
+    sw.root = SWEEP_NIL;
+    sw.touch = false;
+    events = (sweep_event_s*)npnt_malloc(2 * nverts * sizeof(sweep_event_s));
+    sw.lch = (uint32_t*)npnt_malloc(nverts * sizeof(uint32_t));
+    sw.rch = (uint32_t*)npnt_malloc(nverts * sizeof(uint32_t));
+    sw.pri = (uint32_t*)npnt_malloc(nverts * sizeof(uint32_t));
+    if (!events || !sw.lch || !sw.rch || !sw.pri) {
+        ret = NPNT_BAD_FENCE;
+        goto out;
+    }
+    for (i = 0; i < nverts; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        sw.pri[i] = seed;
+        edge_ends(&sw, i, &x0, &y0, &x1, &y1);
+        events[2 * i].x = x0;
+        events[2 * i].y = y0;
+        events[2 * i].ev = 2 * i;
+        events[2 * i + 1].x = x1;
+        events[2 * i + 1].y = y1;
+        events[2 * i + 1].ev = 2 * i + 1;
+    }
+    qsort(events, 2 * nverts, sizeof(sweep_event_s), event_cmp);
+
+    for (i = 0; i < 2 * nverts; i++) {
+        e = events[i].ev >> 1;
+        //every vertex is the end of exactly two edges, more means the ring touches itself
+        if (i > 0 && events[i].x == events[i - 1].x && events[i].y == events[i - 1].y) {
+            run++;
+        } else {
+            run = 1;
+        }
+        if (run > 2) {
+            ret = NPNT_BAD_FENCE;
+            goto out;
+        }
+        if ((events[i].ev & 1) == 0) {
+            sw.root = treap_insert(&sw, sw.root, e);
+            below = treap_neighbour(&sw, e, -1);
+            above = treap_neighbour(&sw, e, 1);
+            if (sw.touch || edges_intersect(&sw, e, below) || edges_intersect(&sw, e, above)) {
+                ret = NPNT_BAD_FENCE;
+                goto out;
+            }
+        } else {
+            below = treap_neighbour(&sw, e, -1);
+            above = treap_neighbour(&sw, e, 1);
+            sw.root = treap_remove(&sw, sw.root, e);
+            if (sw.touch || edges_intersect(&sw, below, above)) {
+                ret = NPNT_BAD_FENCE;
+                goto out;
+            }
+        }
+    }
+out:
+    npnt_free(events);
+    npnt_free(sw.lch);
+    npnt_free(sw.rch);
+    npnt_free(sw.pri);
+    return ret;
+}
+
+int8_t npnt_fence_normalize(float* vertx, float* verty, float* lat, float* lon, uint32_t* nverts)
+{
+    uint32_t i, n;
+    double area = 0;
+
+    if (!vertx || !verty || !nverts) {
+        return NPNT_BAD_FENCE;
+    }
+    n = norm_dedup(vertx, verty, lat, lon, *nverts);
+    if (n >= 3) {
+        n = norm_collinear(vertx, verty, lat, lon, n);
+    }
+    *nverts = n;
+    if (n < 3) {
+        return NPNT_BAD_FENCE;
+    }
+
+    for (i = 0; i < n; i++) {
+        area += cross3(0, 0, vertx[i], verty[i], vertx[(i + 1) % n], verty[(i + 1) % n]);
+    }
+    if (area < 0) {
+        norm_reverse(vertx, n);
+        norm_reverse(verty, n);
+        if (lat && lon) {
+            norm_reverse(lat, n);
+            norm_reverse(lon, n);
+        }
+    }
+    return norm_check_simple(vertx, verty, n);
+}
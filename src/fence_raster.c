@@ -0,0 +1,167 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#include <math.h>
+
+/*
+ * Raster mask over a zone. Cells touched by an edge are marked
+ * NPNT_RASTER_EDGE, every other cell lies fully inside or fully outside the
+ * polygon, so samples deep inside or far outside are answered with a single
+ * lookup and only boundary cells go through the exact grid test.
+ */
+
+#define RASTER_NEXT(i, n)       (((i) + 1 == (n)) ? 0 : (i) + 1)
+
+static uint8_t raster_get(const npnt_raster_s *raster, uint32_t cell)
+{
+    return (raster->bits[cell >> 2] >> ((cell & 3) * 2)) & 3;
+}
+
+static void raster_put(npnt_raster_s *raster, uint32_t cell, uint8_t state)
+{
+    raster->bits[cell >> 2] &= (uint8_t)~(3 << ((cell & 3) * 2));
+    raster->bits[cell >> 2] |= (uint8_t)(state << ((cell & 3) * 2));
+}
+
+static int32_t raster_col(const npnt_raster_s *raster, float x)
+{
+    int32_t c = (int32_t)floorf((x - raster->minx) / raster->cell);
+    if (c < 0) {
+        return 0;
+    }
+    if (c >= raster->ncols) {
+        return raster->ncols - 1;
+    }
+    return c;
+}
+
+static int32_t raster_row(const npnt_raster_s *raster, float y)
+{
+    int32_t r = (int32_t)floorf((y - raster->miny) / raster->cell);
+    if (r < 0) {
+        return 0;
+    }
+    if (r >= raster->nrows) {
+        return raster->nrows - 1;
+    }
+    return r;
+}
+
+//Marks every cell edge a-b passes through, one row band at a time
+static void raster_mark_edge(npnt_raster_s *raster, float ax, float ay, float bx, float by)
+{
+    float eps = raster->cell * 1e-3f;
+    float lo_y = fminf(ay, by), hi_y = fmaxf(ay, by);
+    float ylo, yhi, x0, x1;
+    int32_t r, c, r0, r1, c0, c1;
+
+    r0 = raster_row(raster, lo_y - eps);
+    r1 = raster_row(raster, hi_y + eps);
+    for (r = r0; r <= r1; r++) {
+        ylo = fmaxf(raster->miny + r * raster->cell, lo_y);
+        yhi = fminf(raster->miny + (r + 1) * raster->cell, hi_y);
+        if (ay == by) {
+            x0 = ax;
+            x1 = bx;
+        } else {
+            x0 = ax + (ylo - ay) * (bx - ax) / (by - ay);
+            x1 = ax + (yhi - ay) * (bx - ax) / (by - ay);
+        }
+        c0 = raster_col(raster, fminf(x0, x1) - eps);
+        c1 = raster_col(raster, fmaxf(x0, x1) + eps);
+        for (c = c0; c <= c1; c++) {
+            raster_put(raster, (uint32_t)r * raster->ncols + c, NPNT_RASTER_EDGE);
+        }
+    }
+}
+
+int8_t npnt_raster_build(npnt_raster_s *raster, const npnt_zone_s *zone, float cell, uint32_t max_bytes)
+{
+    float w, h, cx, cy;
+    uint32_t i, ncells, r, c, idx;
+    uint8_t state;
+
+    if (!raster || !zone) {
+        return -1;
+    }
+    memset(raster, 0, sizeof(npnt_raster_s));
+    if (max_bytes == 0) {
+        return 0;
+    }
+    w = fmaxf(zone->maxx - zone->minx, 1.0f);
+    h = fmaxf(zone->maxy - zone->miny, 1.0f);
+    if (cell <= 0) {
+        cell = sqrtf(w * h / ((float)max_bytes * 4));
+    }
+    //grow the cell until the mask fits the cap
+    for (;;) {
+        cell = fmaxf(cell, fmaxf(w, h) / UINT16_MAX);
+        raster->ncols = (uint16_t)fmaxf(ceilf(w / cell), 1);
+        raster->nrows = (uint16_t)fmaxf(ceilf(h / cell), 1);
+        ncells = (uint32_t)raster->ncols * raster->nrows;
+        if ((ncells + 3) / 4 <= max_bytes) {
+            break;
+        }
+        cell *= 1.05f;
+    }
+    raster->cell = cell;
+    raster->minx = zone->minx;
+    raster->miny = zone->miny;
+    raster->bits = (uint8_t*)npnt_calloc((ncells + 3) / 4, 1);
+    if (!raster->bits) {
+        memset(raster, 0, sizeof(npnt_raster_s));
+        return -1;
+    }
+
+    for (i = 0; i < zone->nverts; i++) {
+        raster_mark_edge(raster, zone->vertx[i], zone->verty[i],
+                         zone->vertx[RASTER_NEXT(i, zone->nverts)], zone->verty[RASTER_NEXT(i, zone->nverts)]);
+    }
+
+    //no edge separates neighbouring cells of a run without boundary cells,
+    //so one exact test per run classifies the whole run
+    for (r = 0; r < raster->nrows; r++) {
+        cy = raster->miny + (r + 0.5f) * raster->cell;
+        state = NPNT_RASTER_EDGE;
+        for (c = 0; c < raster->ncols; c++) {
+            idx = r * raster->ncols + c;
+            if (raster_get(raster, idx) == NPNT_RASTER_EDGE) {
+                state = NPNT_RASTER_EDGE;
+                continue;
+            }
+            if (state == NPNT_RASTER_EDGE) {
+                cx = raster->minx + (c + 0.5f) * raster->cell;
+                state = npnt_grid_contains(&zone->grid, zone->vertx, zone->verty, zone->nverts, cx, cy) ?
+                        NPNT_RASTER_IN : NPNT_RASTER_OUT;
+            }
+            raster_put(raster, idx, state);
+        }
+    }
+    return 0;
+}
+
+void npnt_raster_free(npnt_raster_s *raster)
+{
+    if (!raster) {
+        return;
+    }
+    npnt_free(raster->bits);
+    memset(raster, 0, sizeof(npnt_raster_s));
+}
+
+uint8_t npnt_raster_lookup(const npnt_raster_s *raster, float x, float y)
+{
+    if (!raster->bits) {
+        return NPNT_RASTER_EDGE;
+    }
+    if (x < raster->minx || y < raster->miny ||
+        x > raster->minx + raster->ncols * raster->cell ||
+        y > raster->miny + raster->nrows * raster->cell) {
+        return NPNT_RASTER_OUT;
+    }
+    return raster_get(raster, (uint32_t)raster_row(raster, y) * raster->ncols + raster_col(raster, x));
+}
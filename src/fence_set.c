@@ -0,0 +1,718 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#include <fence_iface.h>
+#include <math.h>
+
+#define BVH_LEAF_ZONES      2
+#define BVH_STACK_DEPTH     64
+
+static float orient(float ax, float ay, float bx, float by, float cx, float cy)
+{
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+//Normalized rings are counter clockwise, convex if every corner turns left
+static bool zone_is_convex(const float* vertx, const float* verty, uint32_t nverts)
+{
+    uint32_t i, j, k;
+    for (i = 0; i < nverts; i++) {
+        j = (i + 1) % nverts;
+        k = (i + 2) % nverts;
+        if (orient(vertx[i], verty[i], vertx[j], verty[j], vertx[k], verty[k]) <= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Convex containment in O(log n): binary search for the wedge of the fan
+ * from vertex 0 holding the point, then one half plane test against the
+ * edge closing that wedge.
+ */
+static bool zone_convex_contains(const npnt_zone_s *zone, float x, float y)
+{
+    const float *vx = zone->vertx, *vy = zone->verty;
+    uint32_t lo = 1, hi = zone->nverts - 1, mid;
+
+    if (orient(vx[0], vy[0], vx[1], vy[1], x, y) < 0 ||
+        orient(vx[0], vy[0], vx[hi], vy[hi], x, y) > 0) {
+        return false;
+    }
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (orient(vx[0], vy[0], vx[mid], vy[mid], x, y) >= 0) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return orient(vx[lo], vy[lo], vx[hi], vy[hi], x, y) >= 0;
+}
+
+static bool zone_contains(const npnt_zone_s *zone, float x, float y)
+{
+    uint8_t state;
+    if (x < zone->minx || x > zone->maxx || y < zone->miny || y > zone->maxy) {
+        return false;
+    }
+    state = npnt_raster_lookup(&zone->raster, x, y);
+    if (state != NPNT_RASTER_EDGE) {
+        return state == NPNT_RASTER_IN;
+    }
+    if (zone->convex) {
+        return zone_convex_contains(zone, x, y);
+    }
+    return npnt_grid_contains(&zone->grid, zone->vertx, zone->verty, zone->nverts, x, y);
+}
+
+static float box_dist_sq(const npnt_bvh_node_s *node, float x, float y)
+{
+    float dx = fmaxf(fmaxf(node->minx - x, x - node->maxx), 0);
+    float dy = fmaxf(fmaxf(node->miny - y, y - node->maxy), 0);
+    return dx * dx + dy * dy;
+}
+
+//Entry parameter of ray p + t*d into the node box, INFINITY if missed
+static float box_ray_enter(const npnt_bvh_node_s *node, float x, float y, float dx, float dy)
+{
+    float t_enter = 0, t_exit = INFINITY, t0, t1, tmp;
+    if (dx != 0) {
+        t0 = (node->minx - x) / dx;
+        t1 = (node->maxx - x) / dx;
+        if (t0 > t1) {
+            tmp = t0; t0 = t1; t1 = tmp;
+        }
+        t_enter = fmaxf(t_enter, t0);
+        t_exit = fminf(t_exit, t1);
+    } else if (x < node->minx || x > node->maxx) {
+        return INFINITY;
+    }
+    if (dy != 0) {
+        t0 = (node->miny - y) / dy;
+        t1 = (node->maxy - y) / dy;
+        if (t0 > t1) {
+            tmp = t0; t0 = t1; t1 = tmp;
+        }
+        t_enter = fmaxf(t_enter, t0);
+        t_exit = fminf(t_exit, t1);
+    } else if (y < node->miny || y > node->maxy) {
+        return INFINITY;
+    }
+    return t_enter <= t_exit ? t_enter : INFINITY;
+}
+
+int8_t npnt_fence_set_add(npnt_fence_set_s *set, uint8_t kind, uint32_t id, float* vertx, float* verty, uint32_t nverts)
+{
+    npnt_zone_s *zone, *zones;
+    float *verts;
+    uint32_t i;
+
+    if (!set || !vertx || !verty || nverts < 3) {
+        return NPNT_BAD_FENCE;
+    }
+    if (set->nzones == set->max_zones) {
+        zones = (npnt_zone_s*)npnt_realloc(set->zones, (set->max_zones * 2 + 1)*sizeof(npnt_zone_s));
+        if (!zones) {
+            return NPNT_BAD_FENCE;
+        }
+        set->zones = zones;
+        set->max_zones = set->max_zones * 2 + 1;
+    }
+    zone = &set->zones[set->nzones];
+    memset(zone, 0, sizeof(npnt_zone_s));
+    zone->minx = zone->maxx = vertx[0];
+    zone->miny = zone->maxy = verty[0];
+    for (i = 1; i < nverts; i++) {
+        zone->minx = fminf(zone->minx, vertx[i]);
+        zone->maxx = fmaxf(zone->maxx, vertx[i]);
+        zone->miny = fminf(zone->miny, verty[i]);
+        zone->maxy = fmaxf(zone->maxy, verty[i]);
+    }
+    //one block for both coordinates, small fences fit a single cache line
+    verts = (float*)npnt_malloc(2*nverts*sizeof(float));
+    if (!verts) {
+        return NPNT_BAD_FENCE;
+    }
+    memcpy(verts, vertx, nverts*sizeof(float));
+    memcpy(verts + nverts, verty, nverts*sizeof(float));
+    if (npnt_grid_build(&zone->grid, verts, verts + nverts, nverts) < 0) {
+        npnt_free(verts);
+        return NPNT_BAD_FENCE;
+    }
+    npnt_free(vertx);
+    npnt_free(verty);
+    zone->vertx = verts;
+    zone->verty = verts + nverts;
+    zone->nverts = nverts;
+    zone->id = id;
+    zone->kind = kind;
+    //past NPNT_FENCE_FAN_MAX vertices a grid cell holds fewer edges than the search visits
+    zone->convex = nverts <= NPNT_FENCE_FAN_MAX && zone_is_convex(zone->vertx, zone->verty, nverts);
+    //the mask is only a cache, without it queries take the exact path
+    if (set->raster_custom) {
+        npnt_raster_build(&zone->raster, zone, set->raster_cell, set->raster_max_bytes);
+    } else {
+        npnt_raster_build(&zone->raster, zone, NPNT_RASTER_CELL, NPNT_RASTER_MAX_BYTES);
+    }
+    set->nzones++;
+    return 0;
+}
+
+static float zone_center(const npnt_zone_s *zone, uint8_t axis)
+{
+    return axis ? zone->miny + zone->maxy : zone->minx + zone->maxx;
+}
+
+//Quickselect on zone centers, leaves the k-th smallest at order[k]
+static void bvh_select(const npnt_zone_s *zones, uint32_t* order, uint32_t n, uint32_t k, uint8_t axis)
+{
+    uint32_t lo = 0, hi = n - 1, i, store, tmp;
+    float pivot;
+    while (lo < hi) {
+        tmp = order[(lo + hi) / 2];
+        order[(lo + hi) / 2] = order[hi];
+        order[hi] = tmp;
+        pivot = zone_center(&zones[order[hi]], axis);
+        store = lo;
+        for (i = lo; i < hi; i++) {
+            if (zone_center(&zones[order[i]], axis) < pivot) {
+                tmp = order[i];
+                order[i] = order[store];
+                order[store] = tmp;
+                store++;
+            }
+        }
+        tmp = order[hi];
+        order[hi] = order[store];
+        order[store] = tmp;
+        if (store == k) {
+            return;
+        } else if (store < k) {
+            lo = store + 1;
+        } else {
+            hi = store - 1;
+        }
+    }
+}
+
+static uint32_t bvh_build_node(npnt_fence_set_s *set, uint32_t first, uint32_t count)
+{
+    uint32_t node_idx = set->nnodes++, i, half;
+    npnt_bvh_node_s *node = &set->nodes[node_idx];
+    const npnt_zone_s *zone;
+    float cminx = INFINITY, cminy = INFINITY, cmaxx = -INFINITY, cmaxy = -INFINITY;
+
+    node->minx = node->miny = INFINITY;
+    node->maxx = node->maxy = -INFINITY;
+    for (i = first; i < first + count; i++) {
+        zone = &set->zones[set->order[i]];
+        node->minx = fminf(node->minx, zone->minx);
+        node->miny = fminf(node->miny, zone->miny);
+        node->maxx = fmaxf(node->maxx, zone->maxx);
+        node->maxy = fmaxf(node->maxy, zone->maxy);
+        cminx = fminf(cminx, zone_center(zone, 0));
+        cmaxx = fmaxf(cmaxx, zone_center(zone, 0));
+        cminy = fminf(cminy, zone_center(zone, 1));
+        cmaxy = fmaxf(cmaxy, zone_center(zone, 1));
+    }
+
+    if (count <= BVH_LEAF_ZONES) {
+        node->index = first;
+        node->count = count;
+        return node_idx;
+    }
+
+    //median split along the wider spread of zone centers
+    half = count / 2;
+    bvh_select(set->zones, &set->order[first], count, half, (cmaxy - cminy) > (cmaxx - cminx));
+    node->count = 0;
+    bvh_build_node(set, first, half);
+    i = bvh_build_node(set, first + half, count - half);
+    set->nodes[node_idx].index = i;
+    return node_idx;
+}
+
+int8_t npnt_fence_set_build(npnt_fence_set_s *set)
+{
+    uint32_t i;
+    if (!set || set->nzones == 0) {
+        return NPNT_BAD_FENCE;
+    }
+    npnt_free(set->nodes);
+    npnt_free(set->order);
+    set->nnodes = 0;
+    set->nodes = (npnt_bvh_node_s*)npnt_malloc(2 * set->nzones * sizeof(npnt_bvh_node_s));
+    set->order = (uint32_t*)npnt_malloc(set->nzones * sizeof(uint32_t));
+    if (!set->nodes || !set->order) {
+        //queries test nodes alone, never leave a half built hierarchy behind
+        npnt_free(set->nodes);
+        npnt_free(set->order);
+        set->nodes = NULL;
+        set->order = NULL;
+        return NPNT_BAD_FENCE;
+    }
+    set->minx = set->miny = INFINITY;
+    set->maxx = set->maxy = -INFINITY;
+    for (i = 0; i < set->nzones; i++) {
+        set->order[i] = i;
+        if (set->zones[i].kind == NPNT_ZONE_INCLUDE) {
+            set->minx = fminf(set->minx, set->zones[i].minx);
+            set->miny = fminf(set->miny, set->zones[i].miny);
+            set->maxx = fmaxf(set->maxx, set->zones[i].maxx);
+            set->maxy = fmaxf(set->maxy, set->zones[i].maxy);
+        }
+    }
+    bvh_build_node(set, 0, set->nzones);
+    return 0;
+}
+
+void npnt_fence_set_free(npnt_fence_set_s *set)
+{
+    uint32_t i;
+    if (!set) {
+        return;
+    }
+    for (i = 0; i < set->nzones; i++) {
+        npnt_free(set->zones[i].vertx);
+        npnt_grid_free(&set->zones[i].grid);
+        npnt_raster_free(&set->zones[i].raster);
+    }
+    npnt_free(set->zones);
+    npnt_free(set->nodes);
+    npnt_free(set->order);
+    memset(set, 0, sizeof(npnt_fence_set_s));
+}
+
+/*
+ * Descends only into nodes whose bounds hold the point. An exclusion zone
+ * ends the search, inclusion zones only mark the position as permitted.
+ */
+int8_t npnt_fence_set_query(const npnt_fence_set_s *set, float x, float y, uint32_t* zone_idx)
+{
+    uint32_t stack[BVH_STACK_DEPTH], top = 0, i, z;
+    const npnt_bvh_node_s *node;
+    int8_t verdict = NPNT_FENCE_OUTSIDE;
+
+    //outside every inclusion zone nothing else needs to be looked at
+    if (!set->nodes || x < set->minx || x > set->maxx || y < set->miny || y > set->maxy) {
+        return NPNT_FENCE_OUTSIDE;
+    }
+    //the artefact fence alone, no hierarchy to walk
+    if (set->nzones == 1) {
+        if (!zone_contains(&set->zones[0], x, y)) {
+            return NPNT_FENCE_OUTSIDE;
+        }
+        if (zone_idx) {
+            *zone_idx = 0;
+        }
+        return NPNT_FENCE_INSIDE;
+    }
+    stack[top++] = 0;
+    while (top) {
+        node = &set->nodes[stack[--top]];
+        if (x < node->minx || x > node->maxx || y < node->miny || y > node->maxy) {
+            continue;
+        }
+        if (node->count == 0) {
+            stack[top++] = node->index;
+            stack[top++] = (uint32_t)(node - set->nodes) + 1;
+            continue;
+        }
+        for (i = node->index; i < node->index + node->count; i++) {
+            z = set->order[i];
+            if (set->zones[z].kind == NPNT_ZONE_INCLUDE && verdict == NPNT_FENCE_INSIDE) {
+                continue;
+            }
+            if (!zone_contains(&set->zones[z], x, y)) {
+                continue;
+            }
+            if (zone_idx) {
+                *zone_idx = z;
+            }
+            if (set->zones[z].kind == NPNT_ZONE_EXCLUDE) {
+                return NPNT_FENCE_EXCLUDED;
+            }
+            verdict = NPNT_FENCE_INSIDE;
+        }
+    }
+    return verdict;
+}
+
+/*
+ * Nearest zone boundary, visiting nodes closest first and pruning those
+ * whose bounds are farther than the best edge found so far.
+ */
+float npnt_fence_set_nearest(const npnt_fence_set_s *set, float x, float y, uint32_t* zone_idx, uint32_t* edge)
+{
+    uint32_t stack[BVH_STACK_DEPTH], top = 0, i, z, e;
+    const npnt_bvh_node_s *node, *left, *right;
+    const npnt_zone_s *zone;
+    float best = INFINITY, d;
+
+    if (!set->nodes) {
+        return INFINITY;
+    }
+    stack[top++] = 0;
+    while (top) {
+        node = &set->nodes[stack[--top]];
+        if (box_dist_sq(node, x, y) >= best * best) {
+            continue;
+        }
+        if (node->count == 0) {
+            left = node + 1;
+            right = &set->nodes[node->index];
+            if (box_dist_sq(left, x, y) < box_dist_sq(right, x, y)) {
+                stack[top++] = node->index;
+                stack[top++] = (uint32_t)(left - set->nodes);
+            } else {
+                stack[top++] = (uint32_t)(left - set->nodes);
+                stack[top++] = node->index;
+            }
+            continue;
+        }
+        for (i = node->index; i < node->index + node->count; i++) {
+            z = set->order[i];
+            zone = &set->zones[z];
+            d = npnt_grid_nearest_edge(&zone->grid, zone->vertx, zone->verty, zone->nverts, x, y, &e);
+            if (d < best) {
+                best = d;
+                if (zone_idx) {
+                    *zone_idx = z;
+                }
+                if (edge) {
+                    *edge = e;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+//First boundary of any zone met by ray p + t*d, INFINITY if none
+float npnt_fence_set_raycast(const npnt_fence_set_s *set, float x, float y, float dx, float dy)
+{
+    uint32_t stack[BVH_STACK_DEPTH], top = 0, i;
+    const npnt_bvh_node_s *node;
+    const npnt_zone_s *zone;
+    float best = INFINITY, t;
+
+    if (!set->nodes) {
+        return INFINITY;
+    }
+    stack[top++] = 0;
+    while (top) {
+        node = &set->nodes[stack[--top]];
+        if (box_ray_enter(node, x, y, dx, dy) >= best) {
+            continue;
+        }
+        if (node->count == 0) {
+            stack[top++] = node->index;
+            stack[top++] = (uint32_t)(node - set->nodes) + 1;
+            continue;
+        }
+        for (i = node->index; i < node->index + node->count; i++) {
+            zone = &set->zones[set->order[i]];
+            t = npnt_grid_raycast(&zone->grid, zone->vertx, zone->verty, zone->nverts, x, y, dx, dy);
+            if (t < best) {
+                best = t;
+            }
+        }
+    }
+    return best;
+}
+
+//Copies every zone of src into dst, which keeps its own raster settings
+static int8_t fence_set_copy(npnt_fence_set_s *dst, const npnt_fence_set_s *src)
+{
+    const npnt_zone_s *zone;
+    float *vertx, *verty;
+    uint32_t i;
+
+    for (i = 0; i < src->nzones; i++) {
+        zone = &src->zones[i];
+        vertx = (float*)npnt_malloc(zone->nverts*sizeof(float));
+        verty = (float*)npnt_malloc(zone->nverts*sizeof(float));
+        if (!vertx || !verty) {
+            npnt_free(vertx);
+            npnt_free(verty);
+            return NPNT_BAD_FENCE;
+        }
+        memcpy(vertx, zone->vertx, zone->nverts*sizeof(float));
+        memcpy(verty, zone->verty, zone->nverts*sizeof(float));
+        if (npnt_fence_set_add(dst, zone->kind, zone->id, vertx, verty, zone->nverts) < 0) {
+            npnt_free(vertx);
+            npnt_free(verty);
+            return NPNT_BAD_FENCE;
+        }
+    }
+    return 0;
+}
+
+//Projects a polygon into the artefact fence frame and appends it to set
+static int8_t fence_project_zone(const npnt_frame_s *frame, npnt_fence_set_s *set, uint8_t kind, uint32_t id, const float* lat, const float* lon, uint32_t nverts)
+{
+    float *vertx, *verty;
+    uint32_t i;
+    int8_t ret;
+
+    if (!lat || !lon || nverts < 3 || nverts > NPNT_MAX_FENCE_VERTS || kind > NPNT_ZONE_EXCLUDE) {
+        return NPNT_BAD_FENCE;
+    }
+    vertx = (float*)npnt_malloc(nverts*sizeof(float));
+    verty = (float*)npnt_malloc(nverts*sizeof(float));
+    if (!vertx || !verty) {
+        npnt_free(vertx);
+        npnt_free(verty);
+        return NPNT_BAD_FENCE;
+    }
+    for (i = 0; i < nverts; i++) {
+        npnt_frame_to_local(frame, lat[i], lon[i], &vertx[i], &verty[i]);
+    }
+    ret = npnt_fence_normalize(vertx, verty, NULL, NULL, &nverts);
+    if (ret == 0) {
+        ret = npnt_fence_set_add(set, kind, id, vertx, verty, nverts);
+    }
+    if (ret < 0) {
+        npnt_free(vertx);
+        npnt_free(verty);
+    }
+    return ret;
+}
+
+/*
+ * Zone edits never touch the published zone set. They start from a copy
+ * of the artefact zones, with the raster settings given by the caller.
+ */
+static int8_t fence_edit_begin(npnt_s *handle, npnt_fence_set_s *set, bool raster_custom, float cell, uint32_t max_bytes)
+{
+    memset(set, 0, sizeof(npnt_fence_set_s));
+    set->raster_custom = raster_custom;
+    set->raster_cell = cell;
+    set->raster_max_bytes = max_bytes;
+    if (fence_set_copy(set, &handle->permit.set) < 0) {
+        npnt_fence_set_free(set);
+        return NPNT_BAD_FENCE;
+    }
+    return 0;
+}
+
+/*
+ * Swaps the edited copy in for the artefact zone set. While the artefact
+ * is published, readers are moved to a copy of the record until no read
+ * section can still see the old zones, then back to the handle's own.
+ */
+static int8_t fence_edit_commit(npnt_s *handle, npnt_fence_set_s *set)
+{
+    npnt_permit_s *copy = NULL;
+
+    if (npnt_fence_set_build(set) < 0) {
+        npnt_fence_set_free(set);
+        return NPNT_BAD_FENCE;
+    }
+    if (handle->rcu.active == &handle->permit) {
+        copy = (npnt_permit_s*)npnt_aligned_alloc(NPNT_CACHE_LINE, sizeof(npnt_permit_s));
+        if (!copy) {
+            npnt_fence_set_free(set);
+            return NPNT_BAD_FENCE;
+        }
+        memcpy(copy, &handle->permit, sizeof(npnt_permit_s));
+        copy->set = *set;
+        copy->serial = ++handle->rcu.serial;
+        npnt_permit_switch(handle, copy);
+        npnt_permit_synchronize(handle);
+    }
+    npnt_fence_set_free(&handle->permit.set);
+    handle->permit.set = *set;
+    //trackers and caches built on the old zone set start over
+    handle->permit.serial = copy ? copy->serial : ++handle->rcu.serial;
+    if (copy) {
+        npnt_permit_switch(handle, &handle->permit);
+        npnt_permit_synchronize(handle);
+        npnt_free(copy);
+    }
+    return 0;
+}
+
+int8_t npnt_fence_add_zone(npnt_s *handle, uint8_t kind, uint32_t id, const float* lat, const float* lon, uint32_t nverts)
+{
+    const npnt_fence_set_s *cur;
+    npnt_fence_set_s set;
+    int8_t ret;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    cur = &handle->permit.set;
+    if (cur->nzones == 0) {
+        //zones are projected into the artefact fence frame
+        return NPNT_INV_STATE;
+    }
+    ret = fence_edit_begin(handle, &set, cur->raster_custom, cur->raster_cell, cur->raster_max_bytes);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = fence_project_zone(&handle->permit.frame, &set, kind, id, lat, lon, nverts);
+    if (ret < 0) {
+        npnt_fence_set_free(&set);
+        return ret;
+    }
+    return fence_edit_commit(handle, &set);
+}
+
+int8_t npnt_fence_raster_config(npnt_s *handle, float cell, uint32_t max_bytes)
+{
+    npnt_fence_set_s set;
+    uint32_t i;
+    int8_t ret = 0;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    if (handle->permit.set.nzones == 0) {
+        //no artefact zones yet, nothing published reads the settings
+        handle->permit.set.raster_custom = true;
+        handle->permit.set.raster_cell = cell;
+        handle->permit.set.raster_max_bytes = max_bytes;
+        return 0;
+    }
+    //copied without masks, they are built below with the failures reported
+    if (fence_edit_begin(handle, &set, true, cell, 0) < 0) {
+        return NPNT_BAD_FENCE;
+    }
+    set.raster_max_bytes = max_bytes;
+    for (i = 0; i < set.nzones; i++) {
+        if (npnt_raster_build(&set.zones[i].raster, &set.zones[i], cell, max_bytes) < 0) {
+            ret = NPNT_BAD_FENCE;
+        }
+    }
+    if (fence_edit_commit(handle, &set) < 0) {
+        return NPNT_BAD_FENCE;
+    }
+    return ret;
+}
+
+/*
+ * Zone file format, one token group per line:
+ *   include <id>    starts an inclusion polygon
+ *   exclude <id>    starts an exclusion polygon
+ *   <lat> <lon>     vertex in degrees
+ * Blank lines and lines starting with '#' are skipped.
+ */
+int8_t npnt_fence_load_zones(npnt_s *handle, const char* path)
+{
+    const npnt_fence_set_s *cur;
+    npnt_fence_set_s set;
+    FILE *fp;
+    char line[128], kind_str[8];
+    float *lat = NULL, *lon = NULL, *tmp;
+    uint32_t nverts = 0, max_verts = 0, id = 0;
+    int8_t kind = -1, ret = 0;
+    float vlat, vlon;
+    unsigned long zone_id;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    cur = &handle->permit.set;
+    if (cur->nzones == 0) {
+        return NPNT_INV_STATE;
+    }
+    fp = fopen(path, "r");
+    if (!fp) {
+        return NPNT_PARSE_FAILED;
+    }
+    //the whole file goes into one copy, published once it loaded
+    if (fence_edit_begin(handle, &set, cur->raster_custom, cur->raster_cell, cur->raster_max_bytes) < 0) {
+        fclose(fp);
+        return NPNT_BAD_FENCE;
+    }
+
+    while (ret == 0) {
+        bool eof = fgets(line, sizeof(line), fp) == NULL;
+        if (!eof && (line[0] == '#' || line[0] == '\n' || line[0] == '\r')) {
+            continue;
+        }
+        if (!eof && sscanf(line, "%f %f", &vlat, &vlon) == 2) {
+            if (kind < 0) {
+                ret = NPNT_PARSE_FAILED;
+                break;
+            }
+            if (nverts == max_verts) {
+                max_verts = max_verts * 2 + 16;
+                tmp = (float*)npnt_realloc(lat, max_verts*sizeof(float));
+                if (!tmp) {
+                    ret = NPNT_BAD_FENCE;
+                    break;
+                }
+                lat = tmp;
+                tmp = (float*)npnt_realloc(lon, max_verts*sizeof(float));
+                if (!tmp) {
+                    ret = NPNT_BAD_FENCE;
+                    break;
+                }
+                lon = tmp;
+            }
+            lat[nverts] = vlat;
+            lon[nverts] = vlon;
+            nverts++;
+            continue;
+        }
+
+        //zone header or end of file closes the previous zone
+        if (kind >= 0) {
+            ret = fence_project_zone(&handle->permit.frame, &set, (uint8_t)kind, id, lat, lon, nverts);
+            kind = -1;
+            nverts = 0;
+        }
+        if (eof || ret < 0) {
+            break;
+        }
+        if (sscanf(line, "%7s %lu", kind_str, &zone_id) != 2) {
+            ret = NPNT_PARSE_FAILED;
+        } else if (strcmp(kind_str, "include") == 0) {
+            kind = NPNT_ZONE_INCLUDE;
+        } else if (strcmp(kind_str, "exclude") == 0) {
+            kind = NPNT_ZONE_EXCLUDE;
+        } else {
+            ret = NPNT_PARSE_FAILED;
+        }
+        id = (uint32_t)zone_id;
+    }
+    fclose(fp);
+    npnt_free(lat);
+    npnt_free(lon);
+    if (ret < 0) {
+        npnt_fence_set_free(&set);
+        return ret;
+    }
+    return fence_edit_commit(handle, &set);
+}
+
+int8_t npnt_fence_query(npnt_s *handle, float lat, float lon, uint32_t* zone_id)
+{
+    const npnt_permit_s *permit;
+    float x, y;
+    uint32_t z = 0;
+    uint8_t slot;
+    int8_t verdict = NPNT_BAD_FENCE;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    permit = npnt_permit_read_begin(handle, &slot);
+    if (permit) {
+        npnt_frame_to_local(&permit->frame, lat, lon, &x, &y);
+        verdict = npnt_fence_set_query(&permit->set, x, y, &z);
+        if (zone_id && verdict != NPNT_FENCE_OUTSIDE) {
+            *zone_id = permit->set.zones[z].id;
+        }
+    }
+    npnt_permit_read_end(handle, slot);
+    return verdict;
+}
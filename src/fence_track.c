@@ -0,0 +1,101 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#include <math.h>
+
+/*
+ * Every sample is resolved by the cheapest of three paths:
+ *  - coherent: still within the clearance of the last full query, no
+ *    boundary can have been crossed, the verdict is reused as is.
+ *  - local: a short step, the verdict comes from an uncached zone set
+ *    query, only the nearest boundary search is skipped.
+ *  - full: after a jump, or every NPNT_TRACK_REFRESH local samples, the
+ *    verdict and clearance are recomputed and the anchor moves.
+ */
+
+void npnt_track_reset(npnt_s *handle)
+{
+    if (!handle) {
+        return;
+    }
+    memset(&handle->tracker, 0, sizeof(npnt_tracker_s));
+}
+
+static void track_full(npnt_s *handle, const npnt_permit_s *permit, float x, float y)
+{
+    npnt_tracker_s *tracker = &handle->tracker;
+
+    tracker->anchor_verdict = npnt_fence_set_query(&permit->set, x, y, &tracker->anchor_zone);
+    tracker->verdict = tracker->anchor_verdict;
+    tracker->zone = tracker->anchor_zone;
+    tracker->clearance = npnt_fence_set_nearest(&permit->set, x, y, NULL, NULL);
+    tracker->x = x;
+    tracker->y = y;
+    tracker->local_streak = 0;
+    tracker->valid = true;
+    tracker->serial = permit->serial;
+    tracker->stats.full++;
+}
+
+int8_t npnt_track_permit(npnt_s *handle, const npnt_permit_s *permit, float lat, float lon, uint32_t* zone_id)
+{
+    npnt_tracker_s *tracker;
+    float x, y, dx, dy;
+
+    if (!permit) {
+        return NPNT_BAD_FENCE;
+    }
+    tracker = &handle->tracker;
+    npnt_frame_to_local(&permit->frame, lat, lon, &x, &y);
+    tracker->stats.samples++;
+
+    //anchor belongs to another permit or an older zone set
+    if (!tracker->valid || tracker->serial != permit->serial) {
+        track_full(handle, permit, x, y);
+    } else {
+        dx = x - tracker->x;
+        dy = y - tracker->y;
+        if (dx * dx + dy * dy < tracker->clearance * tracker->clearance) {
+            tracker->verdict = tracker->anchor_verdict;
+            tracker->zone = tracker->anchor_zone;
+            tracker->stats.coherent++;
+        } else {
+            dx = x - tracker->last_x;
+            dy = y - tracker->last_y;
+            if (dx * dx + dy * dy > NPNT_TRACK_JUMP * NPNT_TRACK_JUMP ||
+                tracker->local_streak >= NPNT_TRACK_REFRESH) {
+                track_full(handle, permit, x, y);
+            } else {
+                tracker->verdict = npnt_fence_set_query(&permit->set, x, y, &tracker->zone);
+                tracker->local_streak++;
+                tracker->stats.local++;
+            }
+        }
+    }
+    tracker->last_x = x;
+    tracker->last_y = y;
+
+    if (zone_id && tracker->verdict != NPNT_FENCE_OUTSIDE) {
+        *zone_id = permit->set.zones[tracker->zone].id;
+    }
+    return tracker->verdict;
+}
+
+int8_t npnt_track_position(npnt_s *handle, float lat, float lon, uint32_t* zone_id)
+{
+    const npnt_permit_s *permit;
+    uint8_t slot;
+    int8_t verdict;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    permit = npnt_permit_read_begin(handle, &slot);
+    verdict = npnt_track_permit(handle, permit, lat, lon, zone_id);
+    npnt_permit_read_end(handle, slot);
+    return verdict;
+}
@@ -0,0 +1,500 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#include <npnt.h>
+
+//Flight logs are mapped files, POSIX hosts only
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Append-only flight log. The file is sized for its capacity when created
+ * and mapped whole, appending writes the record, then the chain, then the
+ * count. A crash between record and chain leaves the record uncounted and
+ * out of the chain, one between chain and count is repaired on reopen.
+ *
+ * Merkle batches are built as records come in: frontier[l] holds the
+ * root of the complete subtree of 2^l records at level l, bit l of the
+ * open batch's record count tells whether it is in use. A leaf is merged
+ * upward like a binary counter increment, and folding the frontier from
+ * the lowest level gives the same root as pairing nodes level by level
+ * with the odd last node moving up unpaired, which is what proofs use.
+ */
+
+static void flog_chain(const uint8_t* prev, const npnt_flight_record_s* record, uint8_t* next)
+{
+    char digest[32];    //room for helpers built with SHA-256
+
+    reset_sha1();
+    update_sha1((const char*)prev, NPNT_FLOG_HASH_LEN);
+    update_sha1((const char*)record, sizeof(npnt_flight_record_s));
+    final_sha1(digest);
+    memcpy(next, digest, NPNT_FLOG_HASH_LEN);
+}
+
+static void flog_leaf(const npnt_flight_record_s* record, uint8_t* leaf)
+{
+    static const char prefix = 0;
+    char digest[32];
+
+    reset_sha1();
+    update_sha1(&prefix, 1);
+    update_sha1((const char*)record, sizeof(npnt_flight_record_s));
+    final_sha1(digest);
+    memcpy(leaf, digest, NPNT_FLOG_HASH_LEN);
+}
+
+static void flog_node(const uint8_t* left, const uint8_t* right, uint8_t* node)
+{
+    static const char prefix = 1;
+    char digest[32];
+
+    reset_sha1();
+    update_sha1(&prefix, 1);
+    update_sha1((const char*)left, NPNT_FLOG_HASH_LEN);
+    update_sha1((const char*)right, NPNT_FLOG_HASH_LEN);
+    final_sha1(digest);
+    memcpy(node, digest, NPNT_FLOG_HASH_LEN);
+}
+
+static void flog_merkle_add(npnt_flight_log_s* log, uint32_t seq)
+{
+    uint32_t batch = log->hdr->batch;
+    uint32_t index = seq & (batch - 1);
+    uint8_t node[NPNT_FLOG_HASH_LEN];
+    uint8_t level;
+
+    flog_leaf(&log->records[seq], node);
+    for (level = 0; index & 1; level++, index >>= 1) {
+        flog_node(log->frontier[level], node, node);
+    }
+    if ((seq & (batch - 1)) == batch - 1) {
+        memcpy(log->roots[seq / batch], node, NPNT_FLOG_HASH_LEN);
+    } else {
+        memcpy(log->frontier[level], node, NPNT_FLOG_HASH_LEN);
+    }
+}
+
+static void flog_hex(const uint8_t* data, char* hex)
+{
+    static const char digits[] = "0123456789abcdef";
+    uint32_t i;
+
+    for (i = 0; i < NPNT_FLOG_HASH_LEN; i++) {
+        hex[2 * i] = digits[data[i] >> 4];
+        hex[2 * i + 1] = digits[data[i] & 0xf];
+    }
+    hex[2 * NPNT_FLOG_HASH_LEN] = '\0';
+}
+
+static const char* flog_entry_type(const npnt_flight_record_s* record)
+{
+    switch (record->type) {
+    case NPNT_FLOG_ARM:
+        return "TAKEOFF/ARM";
+    case NPNT_FLOG_DISARM:
+        return "LAND/DISARM";
+    default:
+        return record->breach == NPNT_BR_TIME ? "TIME_BREACH" : "GEOFENCE_BREACH";
+    }
+}
+
+int8_t npnt_flight_log_open(npnt_flight_log_s* log, const char* path, uint32_t capacity, uint32_t batch,
+                            const uint8_t* seed)
+{
+    npnt_flight_log_hdr_s* hdr;
+    uint8_t chain[NPNT_FLOG_HASH_LEN];
+    struct stat st;
+    void* map;
+    uint64_t len;
+    uint32_t i;
+    int8_t ret;
+
+    if (!log || !path) {
+        return NPNT_INV_STATE;
+    }
+    if (batch & (batch - 1) || batch > (1u << NPNT_FLOG_MAX_DEPTH)) {
+        return NPNT_INV_STATE;
+    }
+    log->hdr = NULL;
+    log->records = NULL;
+    log->roots = NULL;
+    log->map_len = 0;
+    log->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (log->fd < 0) {
+        return NPNT_INV_STATE;
+    }
+    if (fstat(log->fd, &st) < 0) {
+        ret = NPNT_INV_STATE;
+        goto fail;
+    }
+    if (st.st_size == 0) {
+        len = sizeof(npnt_flight_log_hdr_s) + (uint64_t)capacity * sizeof(npnt_flight_record_s);
+        if (batch) {
+            len += (uint64_t)((capacity + (uint64_t)batch - 1) / batch) * NPNT_FLOG_HASH_LEN;
+        }
+        if (capacity == 0 || len > SIZE_MAX) {
+            ret = NPNT_INV_STATE;
+            goto fail;
+        }
+        log->map_len = (size_t)len;
+        if (ftruncate(log->fd, (off_t)log->map_len) < 0) {
+            ret = NPNT_INV_STATE;
+            goto fail;
+        }
+    } else if ((uint64_t)st.st_size < sizeof(npnt_flight_log_hdr_s) || (uint64_t)st.st_size > SIZE_MAX) {
+        ret = NPNT_PARSE_FAILED;
+        goto fail;
+    } else {
+        log->map_len = (size_t)st.st_size;
+    }
+
+    map = mmap(NULL, log->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd, 0);
+    if (map == MAP_FAILED) {
+        ret = NPNT_INV_STATE;
+        goto fail;
+    }
+    hdr = (npnt_flight_log_hdr_s*)map;
+    log->hdr = hdr;
+    log->records = (npnt_flight_record_s*)(hdr + 1);
+
+    if (st.st_size == 0) {
+        memcpy(hdr->magic, NPNT_FLOG_MAGIC, sizeof(hdr->magic));
+        hdr->version = NPNT_FLOG_VERSION;
+        hdr->record_size = sizeof(npnt_flight_record_s);
+        hdr->capacity = capacity;
+        hdr->count = 0;
+        hdr->batch = batch;
+        hdr->reserved = 0;
+        if (seed) {
+            memcpy(hdr->seed, seed, NPNT_FLOG_HASH_LEN);
+        } else {
+            memset(hdr->seed, 0, NPNT_FLOG_HASH_LEN);
+        }
+        memcpy(hdr->chain, hdr->seed, NPNT_FLOG_HASH_LEN);
+        log->roots = (uint8_t (*)[NPNT_FLOG_HASH_LEN])(log->records + capacity);
+        return 0;
+    }
+
+    if (memcmp(hdr->magic, NPNT_FLOG_MAGIC, sizeof(hdr->magic)) != 0 ||
+        hdr->version != NPNT_FLOG_VERSION || hdr->record_size != sizeof(npnt_flight_record_s) ||
+        hdr->count > hdr->capacity || hdr->batch & (hdr->batch - 1) ||
+        hdr->batch > (1u << NPNT_FLOG_MAX_DEPTH)) {
+        ret = NPNT_PARSE_FAILED;
+        goto fail;
+    }
+    len = sizeof(npnt_flight_log_hdr_s) + (uint64_t)hdr->capacity * sizeof(npnt_flight_record_s);
+    if (hdr->batch) {
+        len += (uint64_t)((hdr->capacity + (uint64_t)hdr->batch - 1) / hdr->batch) * NPNT_FLOG_HASH_LEN;
+    }
+    if (len > log->map_len) {
+        ret = NPNT_PARSE_FAILED;
+        goto fail;
+    }
+    log->roots = (uint8_t (*)[NPNT_FLOG_HASH_LEN])(log->records + hdr->capacity);
+    memcpy(chain, hdr->seed, NPNT_FLOG_HASH_LEN);
+    for (i = 0; i < hdr->count; i++) {
+        flog_chain(chain, &log->records[i], chain);
+    }
+    if (memcmp(chain, hdr->chain, NPNT_FLOG_HASH_LEN) != 0) {
+        //chain written but count not, take the record over
+        if (hdr->count < hdr->capacity) {
+            flog_chain(chain, &log->records[hdr->count], chain);
+        }
+        if (hdr->count == hdr->capacity || memcmp(chain, hdr->chain, NPNT_FLOG_HASH_LEN) != 0) {
+            ret = NPNT_INV_DGST;
+            goto fail;
+        }
+        hdr->count++;
+    }
+    if (hdr->batch) {
+        for (i = 0; i < hdr->count; i++) {
+            flog_merkle_add(log, i);
+        }
+    }
+    return 0;
+
+fail:
+    if (log->hdr) {
+        munmap(log->hdr, log->map_len);
+    }
+    close(log->fd);
+    log->fd = -1;
+    log->hdr = NULL;
+    log->records = NULL;
+    log->roots = NULL;
+    return ret;
+}
+
+int8_t npnt_flight_log_append(npnt_flight_log_s* log, uint8_t type, const npnt_breach_snapshot_s* snapshot)
+{
+    npnt_flight_log_hdr_s* hdr;
+    npnt_flight_record_s* record;
+    uint32_t count;
+
+    if (!log || !log->hdr || !snapshot) {
+        return NPNT_INV_STATE;
+    }
+    hdr = log->hdr;
+    count = hdr->count;
+    if (count >= hdr->capacity) {
+        return NPNT_INV_STATE;
+    }
+    record = &log->records[count];
+    memset(record, 0, sizeof(npnt_flight_record_s));
+    record->utc_time = snapshot->utc_time;
+    record->lat = snapshot->lat;
+    record->lon = snapshot->lon;
+    record->altitude = snapshot->altitude;
+    record->breach = type == NPNT_FLOG_BREACH ? snapshot->breach : 0;
+    record->seq = count;
+    record->type = type;
+    flog_chain(hdr->chain, record, hdr->chain);
+    if (hdr->batch) {
+        flog_merkle_add(log, count);
+    }
+    __atomic_store_n(&hdr->count, count + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int8_t npnt_flight_log_sync(npnt_flight_log_s* log)
+{
+    if (!log || !log->hdr) {
+        return NPNT_INV_STATE;
+    }
+    if (msync(log->hdr, log->map_len, MS_SYNC) < 0) {
+        return NPNT_INV_STATE;
+    }
+    return 0;
+}
+
+int8_t npnt_flight_log_sign(npnt_s* handle, npnt_flight_log_s* log, uint8_t* signature, uint16_t* signature_len)
+{
+    uint8_t chain[NPNT_FLOG_HASH_LEN];
+
+    if (!log || !log->hdr) {
+        return NPNT_INV_STATE;
+    }
+    memcpy(chain, log->hdr->chain, NPNT_FLOG_HASH_LEN);
+    if (npnt_sign_raw_data(handle, chain, NPNT_FLOG_HASH_LEN, signature, signature_len) != 0) {
+        return NPNT_INV_SIGN;
+    }
+    return 0;
+}
+
+int8_t npnt_flight_log_batch_root(const npnt_flight_log_s* log, uint32_t batch_no, uint8_t* root)
+{
+    uint8_t node[NPNT_FLOG_HASH_LEN];
+    uint32_t batch, count;
+    uint8_t level;
+    bool first = true;
+
+    if (!log || !log->hdr || !log->hdr->batch || !root) {
+        return NPNT_INV_STATE;
+    }
+    batch = log->hdr->batch;
+    count = log->hdr->count;
+    if (batch_no < count / batch) {
+        memcpy(root, log->roots[batch_no], NPNT_FLOG_HASH_LEN);
+        return 0;
+    }
+    count &= batch - 1;
+    if (batch_no != log->hdr->count / batch || count == 0) {
+        return NPNT_INV_STATE;
+    }
+    for (level = 0; count; level++, count >>= 1) {
+        if (!(count & 1)) {
+            continue;
+        }
+        if (first) {
+            memcpy(node, log->frontier[level], NPNT_FLOG_HASH_LEN);
+            first = false;
+        } else {
+            flog_node(log->frontier[level], node, node);
+        }
+    }
+    memcpy(root, node, NPNT_FLOG_HASH_LEN);
+    return 0;
+}
+
+int8_t npnt_flight_log_sign_batch(npnt_s* handle, const npnt_flight_log_s* log, uint32_t batch_no,
+                                  uint8_t* signature, uint16_t* signature_len)
+{
+    uint8_t root[NPNT_FLOG_HASH_LEN];
+
+    if (npnt_flight_log_batch_root(log, batch_no, root) < 0) {
+        return NPNT_INV_STATE;
+    }
+    if (npnt_sign_raw_data(handle, root, NPNT_FLOG_HASH_LEN, signature, signature_len) != 0) {
+        return NPNT_INV_SIGN;
+    }
+    return 0;
+}
+
+int8_t npnt_flight_log_proof(const npnt_flight_log_s* log, uint32_t seq, npnt_flight_proof_s* proof)
+{
+    uint8_t (*nodes)[NPNT_FLOG_HASH_LEN];
+    uint32_t batch, first, count, index, i;
+
+    if (!log || !log->hdr || !log->hdr->batch || !proof || seq >= log->hdr->count) {
+        return NPNT_INV_STATE;
+    }
+    batch = log->hdr->batch;
+    first = seq & ~(batch - 1);
+    count = log->hdr->count - first;
+    if (count > batch) {
+        count = batch;
+    }
+    nodes = npnt_malloc((size_t)count * NPNT_FLOG_HASH_LEN);
+    if (!nodes) {
+        return NPNT_INV_STATE;
+    }
+    for (i = 0; i < count; i++) {
+        flog_leaf(&log->records[first + i], nodes[i]);
+    }
+    proof->seq = seq;
+    proof->batch = batch;
+    proof->count = count;
+    proof->depth = 0;
+    //one level per pass, pairs in place, an odd last node moves up as is
+    for (index = seq - first; count > 1; index >>= 1, count = (count + 1) / 2) {
+        if ((index ^ 1) < count) {
+            memcpy(proof->siblings[proof->depth++], nodes[index ^ 1], NPNT_FLOG_HASH_LEN);
+        }
+        for (i = 0; i + 1 < count; i += 2) {
+            flog_node(nodes[i], nodes[i + 1], nodes[i / 2]);
+        }
+        if (count & 1) {
+            memcpy(nodes[count / 2], nodes[count - 1], NPNT_FLOG_HASH_LEN);
+        }
+    }
+    npnt_free(nodes);
+    return 0;
+}
+
+int8_t npnt_flight_log_verify_proof(const npnt_flight_record_s* record, const npnt_flight_proof_s* proof,
+                                    const uint8_t* root)
+{
+    uint8_t node[NPNT_FLOG_HASH_LEN];
+    uint32_t index, count;
+    uint8_t used = 0;
+
+    if (!record || !proof || !root || record->seq != proof->seq || !proof->batch ||
+        proof->batch & (proof->batch - 1) || proof->count > proof->batch ||
+        proof->depth > NPNT_FLOG_MAX_DEPTH) {
+        return NPNT_INV_DGST;
+    }
+    index = proof->seq & (proof->batch - 1);
+    if (index >= proof->count) {
+        return NPNT_INV_DGST;
+    }
+    flog_leaf(record, node);
+    for (count = proof->count; count > 1; index >>= 1, count = (count + 1) / 2) {
+        if ((index ^ 1) >= count) {
+            continue;
+        }
+        if (used == proof->depth) {
+            return NPNT_INV_DGST;
+        }
+        if (index & 1) {
+            flog_node(proof->siblings[used], node, node);
+        } else {
+            flog_node(node, proof->siblings[used], node);
+        }
+        used++;
+    }
+    if (used != proof->depth || memcmp(node, root, NPNT_FLOG_HASH_LEN) != 0) {
+        return NPNT_INV_DGST;
+    }
+    return 0;
+}
+
+int8_t npnt_flight_log_export(const npnt_flight_log_s* log, FILE* fp, const char* permission_id,
+                              const uint8_t* signature, uint16_t signature_len)
+{
+    const npnt_flight_record_s* record;
+    char seed_hex[2 * NPNT_FLOG_HASH_LEN + 1];
+    char chain_hex[2 * NPNT_FLOG_HASH_LEN + 1];
+    char root_hex[2 * NPNT_FLOG_HASH_LEN + 1];
+    uint8_t root[NPNT_FLOG_HASH_LEN];
+    uint8_t* signature_b64 = NULL;
+    uint32_t signature_b64_len, count, i;
+    int8_t ret = 0;
+
+    if (!log || !log->hdr || !fp) {
+        return NPNT_INV_STATE;
+    }
+    if (signature && signature_len) {
+        signature_b64 = base64_encode(signature, signature_len, &signature_b64_len);
+        if (!signature_b64) {
+            return NPNT_INV_STATE;
+        }
+        //base64_encode breaks lines every 72 characters, JSON strings can't hold them
+        for (i = 0, count = 0; i < signature_b64_len; i++) {
+            if (signature_b64[i] != '\n') {
+                signature_b64[count++] = signature_b64[i];
+            }
+        }
+        signature_b64[count] = '\0';
+    }
+    count = __atomic_load_n(&log->hdr->count, __ATOMIC_ACQUIRE);
+    flog_hex(log->hdr->seed, seed_hex);
+    flog_hex(log->hdr->chain, chain_hex);
+
+    fprintf(fp, "{\"FlightLog\":{\"PermissionArtefact\":\"%s\",\"previous_log_hash\":\"%s\","
+            "\"LogHash\":\"%s\",\"LogEntries\":[", permission_id ? permission_id : "", seed_hex, chain_hex);
+    for (i = 0; i < count; i++) {
+        record = &log->records[i];
+        fprintf(fp, "%s\n{\"Entry_type\":\"%s\",\"TimeStamp\":%" PRIu64 ",\"Longitude\":%.7f,"
+                "\"Latitude\":%.7f,\"Altitude\":%.2f}", i ? "," : "", flog_entry_type(record),
+                record->utc_time, record->lon, record->lat, record->altitude);
+    }
+    fprintf(fp, "\n]");
+    if (log->hdr->batch) {
+        fprintf(fp, ",\"BatchSize\":%u,\"BatchRoots\":[", log->hdr->batch);
+        for (i = 0; npnt_flight_log_batch_root(log, i, root) == 0; i++) {
+            flog_hex(root, root_hex);
+            fprintf(fp, "%s\"%s\"", i ? "," : "", root_hex);
+        }
+        fprintf(fp, "]");
+    }
+    fprintf(fp, "},\"Signature\":\"%s\"}\n", signature_b64 ? (char*)signature_b64 : "");
+    if (ferror(fp) || fflush(fp) != 0) {
+        ret = NPNT_INV_STATE;
+    }
+    if (signature_b64) {
+        npnt_free(signature_b64);
+    }
+    return ret;
+}
+
+int8_t npnt_flight_log_close(npnt_flight_log_s* log)
+{
+    int8_t ret = 0;
+
+    if (!log || !log->hdr) {
+        return NPNT_INV_STATE;
+    }
+    if (msync(log->hdr, log->map_len, MS_SYNC) < 0) {
+        ret = NPNT_INV_STATE;
+    }
+    munmap(log->hdr, log->map_len);
+    if (close(log->fd) < 0) {
+        ret = NPNT_INV_STATE;
+    }
+    log->fd = -1;
+    log->hdr = NULL;
+    log->records = NULL;
+    return ret;
+}
+
+#endif
@@ -3,3 +3,113 @@
  *  License, v. 2.0. If a copy of the MPL was not distributed with this
  *  file, You can obtain one at http://mozilla.org/MPL/2.0/. 
  */
+
+#include <npnt_internal.h>
+
+/*
+ * Breach log. The evaluator is the only writer of head and the flusher the
+ * only writer of tail, a record slot belongs to the evaluator until head
+ * is published past it and to the flusher until tail is. npnt_log_flush
+ * hands npnt_log_write the records in place and only frees them after it
+ * returns, so nothing is copied twice.
+ */
+
+#if (NPNT_LOG_SIZE & (NPNT_LOG_SIZE - 1)) != 0 || NPNT_LOG_SIZE == 0
+#error "NPNT_LOG_SIZE must be a power of two"
+#endif
+
+#define LOG_MASK                    (NPNT_LOG_SIZE - 1)
+
+void npnt_log_breach(npnt_log_s *log, const npnt_breach_snapshot_s *snapshot)
+{
+    uint32_t head;
+
+    if (!(snapshot->breach & NPNT_LOG_TRACK) && snapshot->breach == log->last) {
+        return;
+    }
+    head = __atomic_load_n(&log->head, __ATOMIC_RELAXED);
+    if (head - log->tail_cache == NPNT_LOG_SIZE) {
+        log->tail_cache = __atomic_load_n(&log->tail, __ATOMIC_ACQUIRE);
+        if (head - log->tail_cache == NPNT_LOG_SIZE) {
+            //last stays behind, so a change is logged once there is room again
+            __atomic_store_n(&log->dropped, log->dropped + 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    log->records[head & LOG_MASK] = *snapshot;
+    log->last = snapshot->breach;
+    __atomic_store_n(&log->head, head + 1, __ATOMIC_RELEASE);
+}
+
+int8_t npnt_log_init(npnt_s *handle, npnt_log_s *log)
+{
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    if (log) {
+        memset(log, 0, sizeof(npnt_log_s));
+    }
+    handle->log = log;
+    return 0;
+}
+
+int32_t npnt_log_flush(npnt_s *handle)
+{
+    npnt_log_s *log;
+    uint32_t head, tail, count;
+    int32_t stored = 0;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    log = handle->log;
+    if (!log) {
+        return 0;
+    }
+    tail = __atomic_load_n(&log->tail, __ATOMIC_RELAXED);
+    head = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE);
+    while (tail != head) {
+        //up to the end of the ring, the rest in a second pass
+        count = head - tail;
+        if (count > NPNT_LOG_SIZE - (tail & LOG_MASK)) {
+            count = NPNT_LOG_SIZE - (tail & LOG_MASK);
+        }
+        if (npnt_log_write(&log->records[tail & LOG_MASK], count) < 0) {
+            return NPNT_INV_STATE;
+        }
+        tail += count;
+        __atomic_store_n(&log->tail, tail, __ATOMIC_RELEASE);
+        stored += (int32_t)count;
+    }
+    return stored;
+}
+
+uint32_t npnt_log_read(npnt_s *handle, npnt_breach_snapshot_s *records, uint32_t max)
+{
+    npnt_log_s *log;
+    uint32_t head, tail, count, i;
+
+    if (!handle || !handle->log || !records) {
+        return 0;
+    }
+    log = handle->log;
+    tail = __atomic_load_n(&log->tail, __ATOMIC_RELAXED);
+    head = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE);
+    count = head - tail;
+    if (count > max) {
+        count = max;
+    }
+    for (i = 0; i < count; i++) {
+        records[i] = log->records[(tail + i) & LOG_MASK];
+    }
+    __atomic_store_n(&log->tail, tail + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+uint32_t npnt_log_dropped(npnt_s *handle)
+{
+    if (!handle || !handle->log) {
+        return 0;
+    }
+    return __atomic_load_n(&handle->log->dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,372 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+/*
+ * Library allocator. Every block starts with a small header recording the
+ * size asked for and the loading stage that asked, so usage can be booked
+ * per stage without help from the backend, and the distance back to the
+ * start of the block for aligned requests. Blocks come from the C heap,
+ * the static pool, or the hooks installed with npnt_mem_set_hooks.
+ *
+ * The static profile carves blocks out of one pool. Block sizes are
+ * powers of two and freed blocks go onto the free list of their class,
+ * where the next request of that class picks them up again. Blocks are
+ * never split or merged, which wastes up to half of each block but keeps
+ * every call to a handful of steps, and a load and reset cycle leaves the
+ * pool in a state the next cycle can reuse block for block. Requests of a
+ * class with an empty free list and no room left in the pool fall back to
+ * the smallest free block of a larger class.
+ */
+
+typedef struct {
+    uint32_t size;          //bytes asked for
+    uint16_t offset;        //header position minus block start
+    uint8_t cls;            //size class, MEM_HOOKED for blocks from the hooks
+    uint8_t stage;          //NPNT_MEM_* the block is booked to
+} mem_header_s;
+
+#define MEM_HDR             sizeof(mem_header_s)
+#define MEM_ALIGN           8
+#define MEM_HOOKED          0xFF
+
+static npnt_mem_stats_s mem_stats;
+static npnt_mem_hooks_s mem_hooks;
+static uint32_t mem_blocks;
+static uint8_t mem_stage;
+
+static void mem_count(mem_header_s* hdr, uint32_t size)
+{
+    npnt_mem_stage_s* st = &mem_stats.stage[hdr->stage];
+
+    mem_stats.in_use += size - hdr->size;
+    if (mem_stats.in_use > mem_stats.peak) {
+        mem_stats.peak = mem_stats.in_use;
+    }
+    st->live += size - hdr->size;
+    if (st->live > st->peak) {
+        st->peak = st->live;
+    }
+    if (size > hdr->size) {
+        st->bytes += size - hdr->size;
+    }
+    hdr->size = size;
+}
+
+#ifdef NPNT_STATIC_MEMORY
+
+#define MEM_MIN_SHIFT       4
+#define MEM_CLASSES         28
+
+static uint8_t mem_pool[NPNT_POOL_SIZE] NPNT_CACHE_ALIGNED;
+static uint32_t mem_top;
+static void* mem_free_list[MEM_CLASSES];
+
+typedef char npnt_pool_fits[NPNT_POOL_SIZE <= UINT32_MAX ? 1 : -1];
+
+//Smallest class whose blocks hold size bytes, MEM_CLASSES if none
+static uint8_t mem_class(size_t size)
+{
+    uint32_t shift;
+    if (size > ((size_t)1 << (MEM_MIN_SHIFT + MEM_CLASSES - 1))) {
+        return MEM_CLASSES;
+    }
+    if (size <= ((size_t)1 << MEM_MIN_SHIFT)) {
+        return 0;
+    }
+    shift = 32 - __builtin_clz((uint32_t)(size - 1));
+    return (uint8_t)(shift - MEM_MIN_SHIFT);
+}
+
+static uint8_t* mem_pool_alloc(size_t size, uint8_t* cls)
+{
+    uint8_t c = mem_class(size), k;
+    uint32_t block = (uint32_t)1 << (MEM_MIN_SHIFT + (c < MEM_CLASSES ? c : 0));
+    uint8_t* p;
+
+    if (c == MEM_CLASSES) {
+        return NULL;
+    }
+    if (mem_free_list[c]) {
+        p = (uint8_t*)mem_free_list[c];
+        memcpy(&mem_free_list[c], p, sizeof(void*));
+        *cls = c;
+        return p;
+    }
+    if (mem_top <= NPNT_POOL_SIZE - block) {
+        p = &mem_pool[mem_top];
+        mem_top += block;
+        *cls = c;
+        return p;
+    }
+    for (k = c + 1; k < MEM_CLASSES; k++) {
+        if (mem_free_list[k]) {
+            p = (uint8_t*)mem_free_list[k];
+            memcpy(&mem_free_list[k], p, sizeof(void*));
+            *cls = k;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static void mem_pool_free(uint8_t* block, uint8_t cls)
+{
+    memcpy(block, &mem_free_list[cls], sizeof(void*));
+    mem_free_list[cls] = block;
+}
+
+#else
+
+static uint8_t* mem_pool_alloc(size_t size, uint8_t* cls)
+{
+    *cls = 0;
+    return (uint8_t*)malloc(size);
+}
+
+static void mem_pool_free(uint8_t* block, uint8_t cls)
+{
+    (void)cls;
+    free(block);
+}
+
+#endif
+
+static uint8_t* mem_block_alloc(size_t size, uint8_t* cls)
+{
+    if (mem_hooks.alloc) {
+        *cls = MEM_HOOKED;
+        return (uint8_t*)mem_hooks.alloc(size, mem_hooks.ctx);
+    }
+    return mem_pool_alloc(size, cls);
+}
+
+static void mem_block_free(uint8_t* block, uint8_t cls)
+{
+    if (cls == MEM_HOOKED) {
+        mem_hooks.release(block, mem_hooks.ctx);
+        return;
+    }
+    mem_pool_free(block, cls);
+}
+
+static void* mem_alloc(size_t align, size_t size)
+{
+    mem_header_s* hdr;
+    uint8_t *block, *p;
+    uint8_t cls;
+
+    if (size > UINT32_MAX - MEM_HDR - align) {
+        mem_stats.failures++;
+        return NULL;
+    }
+    block = mem_block_alloc(size + MEM_HDR + (align > MEM_ALIGN ? align : 0), &cls);
+    if (!block) {
+        mem_stats.failures++;
+        return NULL;
+    }
+    p = block + MEM_HDR;
+    if (align > MEM_ALIGN) {
+        p = (uint8_t*)(((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1));
+    }
+    hdr = (mem_header_s*)(p - MEM_HDR);
+    hdr->size = 0;
+    hdr->offset = (uint16_t)((uint8_t*)hdr - block);
+    hdr->cls = cls;
+    hdr->stage = mem_stage;
+
+    mem_blocks++;
+    mem_stats.allocs++;
+    mem_stats.stage[mem_stage].allocs++;
+    mem_count(hdr, (uint32_t)size);
+    return p;
+}
+
+void* npnt_malloc(size_t size)
+{
+    return mem_alloc(MEM_ALIGN, size);
+}
+
+void* npnt_calloc(size_t nmemb, size_t size)
+{
+    void* p;
+    if (size && nmemb > SIZE_MAX / size) {
+        mem_stats.failures++;
+        return NULL;
+    }
+    p = mem_alloc(MEM_ALIGN, nmemb * size);
+    if (p) {
+        memset(p, 0, nmemb * size);
+    }
+    return p;
+}
+
+void* npnt_aligned_alloc(size_t align, size_t size)
+{
+    if (align == 0 || (align & (align - 1)) || align > UINT16_MAX / 2) {
+        return NULL;
+    }
+    return mem_alloc(align, size);
+}
+
+char* npnt_strdup(const char* str)
+{
+    size_t len = strlen(str) + 1;
+    char* p = (char*)mem_alloc(MEM_ALIGN, len);
+    if (p) {
+        memcpy(p, str, len);
+    }
+    return p;
+}
+
+void npnt_free(void* ptr)
+{
+    mem_header_s* hdr;
+    if (!ptr) {
+        return;
+    }
+    hdr = (mem_header_s*)((uint8_t*)ptr - MEM_HDR);
+    mem_stats.in_use -= hdr->size;
+    mem_stats.stage[hdr->stage].live -= hdr->size;
+    mem_blocks--;
+    mem_block_free((uint8_t*)hdr - hdr->offset, hdr->cls);
+}
+
+void* npnt_realloc(void* ptr, size_t size)
+{
+    mem_header_s* hdr;
+    void* p;
+
+    if (!ptr) {
+        return npnt_malloc(size);
+    }
+    hdr = (mem_header_s*)((uint8_t*)ptr - MEM_HDR);
+#ifdef NPNT_STATIC_MEMORY
+    //the block already has room
+    if (hdr->cls != MEM_HOOKED &&
+        size <= ((size_t)1 << (MEM_MIN_SHIFT + hdr->cls)) - hdr->offset - MEM_HDR) {
+        mem_count(hdr, (uint32_t)size);
+        return ptr;
+    }
+#else
+    if (hdr->cls != MEM_HOOKED && hdr->offset == 0 && size <= UINT32_MAX - MEM_HDR) {
+        p = realloc(hdr, size + MEM_HDR);
+        if (!p) {
+            mem_stats.failures++;
+            return NULL;
+        }
+        hdr = (mem_header_s*)p;
+        mem_count(hdr, (uint32_t)size);
+        return (uint8_t*)p + MEM_HDR;
+    }
+#endif
+    p = npnt_malloc(size);
+    if (!p) {
+        return NULL;
+    }
+    memcpy(p, ptr, hdr->size < size ? hdr->size : size);
+    npnt_free(ptr);
+    return p;
+}
+
+void npnt_mem_stats(npnt_mem_stats_s* stats)
+{
+    if (!stats) {
+        return;
+    }
+    *stats = mem_stats;
+    stats->pool_size = 0;
+    stats->pool_used = 0;
+#ifdef NPNT_STATIC_MEMORY
+    if (!mem_hooks.alloc) {
+        stats->pool_size = NPNT_POOL_SIZE;
+        stats->pool_used = mem_top;
+    }
+#endif
+}
+
+void npnt_mem_stats_reset(void)
+{
+    uint8_t i;
+
+    //live bytes stay, they are still allocated
+    mem_stats.peak = mem_stats.in_use;
+    mem_stats.allocs = 0;
+    mem_stats.failures = 0;
+    for (i = 0; i < NPNT_MEM_STAGES; i++) {
+        mem_stats.stage[i].allocs = 0;
+        mem_stats.stage[i].bytes = 0;
+        mem_stats.stage[i].peak = mem_stats.stage[i].live;
+    }
+}
+
+int8_t npnt_mem_set_hooks(const npnt_mem_hooks_s* hooks)
+{
+    if (mem_blocks != 0) {
+        return NPNT_INV_STATE;
+    }
+    if (hooks && (!hooks->alloc || !hooks->release)) {
+        return NPNT_INV_STATE;
+    }
+    if (hooks) {
+        mem_hooks = *hooks;
+    } else {
+        memset(&mem_hooks, 0, sizeof(npnt_mem_hooks_s));
+    }
+    return 0;
+}
+
+uint8_t npnt_mem_stage(uint8_t stage)
+{
+    uint8_t prev = mem_stage;
+    if (stage < NPNT_MEM_STAGES) {
+        mem_stage = stage;
+    }
+    return prev;
+}
+
+static const char* const mem_stage_names[NPNT_MEM_STAGES] = {
+    "other", "decode", "parse", "verify", "fence", "params"
+};
+
+int32_t npnt_mem_stats_json(char* buf, uint32_t len)
+{
+    npnt_mem_stats_s st;
+    uint32_t pos;
+    int n;
+    uint8_t i;
+
+    npnt_mem_stats(&st);
+    if (!buf) {
+        len = 0;
+    }
+    n = snprintf(buf, len, "{\"in_use\":%" PRIu32 ",\"peak\":%" PRIu32 ",\"allocs\":%" PRIu32
+                 ",\"failures\":%" PRIu32 ",\"pool_size\":%" PRIu32 ",\"pool_used\":%" PRIu32 ",\"stages\":{",
+                 st.in_use, st.peak, st.allocs, st.failures, st.pool_size, st.pool_used);
+    if (n < 0) {
+        return -1;
+    }
+    pos = (uint32_t)n;
+    for (i = 0; i < NPNT_MEM_STAGES; i++) {
+        n = snprintf(pos < len ? buf + pos : NULL, pos < len ? len - pos : 0,
+                     "%s\"%s\":{\"allocs\":%" PRIu32 ",\"bytes\":%" PRIu32 ",\"live\":%" PRIu32
+                     ",\"peak\":%" PRIu32 "}",
+                     i ? "," : "", mem_stage_names[i], st.stage[i].allocs, st.stage[i].bytes,
+                     st.stage[i].live, st.stage[i].peak);
+        if (n < 0) {
+            return -1;
+        }
+        pos += (uint32_t)n;
+    }
+    n = snprintf(pos < len ? buf + pos : NULL, pos < len ? len - pos : 0, "}}");
+    if (n < 0) {
+        return -1;
+    }
+    return (int32_t)(pos + (uint32_t)n);
+}
@@ -10,12 +10,14 @@
 #include <openssl/err.h>
 #include <openssl/ec.h>
 #include <openssl/pem.h>
+#include <openssl/engine.h>
 #endif
 
 #ifdef RFM_USE_WOLFSSL
 #include <wolfssl/options.h>
 #include <wolfssl/wolfcrypt/rsa.h>
 #include <wolfssl/wolfcrypt/asn.h>
+#include <wolfssl/wolfcrypt/memory.h>
 static DerBuffer converted;
 static RsaKey         rsaKey;
 static RsaKey*        pRsaKey = NULL;
@@ -24,6 +26,10 @@ int8_t npnt_check_authenticity(npnt_s *handle, uint8_t* raw_data, uint16_t raw_d
     int ret = 0;
 
     if (pRsaKey == NULL) {
+#ifdef NPNT_STATIC_MEMORY
+        /* Key decoding and verification allocate from the libnpnt pool as well. */
+        wolfSSL_SetAllocators(npnt_malloc, npnt_free, npnt_realloc);
+#endif
         /* Initialize the RSA key and decode the DER encoded public key. */
         FILE *fp = fopen("dgca_pubkey.pem", "r");
         if (fp == NULL) {
@@ -35,7 +41,7 @@ int8_t npnt_check_authenticity(npnt_s *handle, uint8_t* raw_data, uint16_t raw_d
         if (sz == 0) {
             return -1;
         }
-        uint8_t *filebuf = (uint8_t*)malloc(sz);
+        uint8_t *filebuf = (uint8_t*)npnt_malloc(sz);
         if (filebuf == NULL) {
             return -1;
         }
@@ -54,7 +60,7 @@ int8_t npnt_check_authenticity(npnt_s *handle, uint8_t* raw_data, uint16_t raw_d
         if (ret == 0) {
             pRsaKey = &rsaKey;
         }
-        free(filebuf);
+        npnt_free(filebuf);
         close(fp);
     }
 
@@ -87,7 +93,7 @@ void reset_sha1()
     wc_InitSha256(&sha);
 }
 
-void update_sha1(const char* data, uint16_t data_len)
+void update_sha1(const char* data, uint32_t data_len)
 {
     wc_Sha256Update(&sha, data, data_len);
 }
@@ -104,7 +110,7 @@ void reset_sha1()
     SHA1_Init(&sha);
 }
 
-void update_sha1(const char* data, uint16_t data_len)
+void update_sha1(const char* data, uint32_t data_len)
 {
     SHA1_Update(&sha, data, data_len);
 }
@@ -117,7 +123,7 @@ static EVP_PKEY *dgca_pkey = NULL;
 static EVP_PKEY_CTX *dgca_pkey_ctx;
 int8_t npnt_check_authenticity(npnt_s *handle, uint8_t* hashed_data, uint16_t hashed_data_len, const uint8_t* signature, uint16_t signature_len)
 {
-    if (!handle || !raw_data || !signature) {
+    if (!handle || !hashed_data || !signature) {
         return -1;
     }
     if (dgca_pkey == NULL) {
@@ -126,6 +132,10 @@ int8_t npnt_check_authenticity(npnt_s *handle, uint8_t* hashed_data, uint16_t ha
             return -1;
         }
         dgca_pkey = PEM_read_PUBKEY(fp, NULL, NULL, NULL);
+        fclose(fp);
+        if (dgca_pkey == NULL) {
+            return -1;
+        }
     }
     dgca_pkey_ctx = EVP_PKEY_CTX_new(dgca_pkey, ENGINE_get_default_RSA());
     if (!dgca_pkey_ctx) {
@@ -146,7 +156,7 @@ int8_t npnt_check_authenticity(npnt_s *handle, uint8_t* hashed_data, uint16_t ha
     }
 
     /* Perform operation */
-    ret = EVP_PKEY_verify(dgca_pkey_ctx, signature, signature_len, raw_data, raw_data_len);
+    ret = EVP_PKEY_verify(dgca_pkey_ctx, signature, signature_len, hashed_data, hashed_data_len);
 
 fail:
     EVP_PKEY_CTX_free(dgca_pkey_ctx);
@@ -0,0 +1,369 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sched.h>
+#endif
+
+/*
+ * Permit store. Every artefact goes through the same parse, verify and
+ * projection steps as npnt_set_permart on a scratch handle, only the
+ * resulting permit record is kept. Entries are sorted by window start and
+ * carry the latest window end seen so far, so the permits covering a time
+ * are found with one binary search and a short backward scan that stops
+ * as soon as no earlier window can still be open.
+ *
+ * The active permit is published with an atomic pointer store. Readers
+ * count themselves into one of two counters, picked by the parity of the
+ * epoch, for as long as they use the pointer. Before freeing a record the
+ * loader flips the epoch and waits for the old counter to drain, twice,
+ * because a reader may have sampled the epoch just before the first flip
+ * and entered its counter after the loader checked it. Readers never wait
+ * and take no locks, the loader is the only side that spins.
+ */
+
+//Everything a coherent breach evaluation reads has to stay within the first line
+typedef char npnt_permit_hot_fits[offsetof(npnt_permit_s, set) <= NPNT_CACHE_LINE ? 1 : -1];
+
+void npnt_permit_free(npnt_permit_s *permit)
+{
+    if (!permit) {
+        return;
+    }
+    npnt_fence_set_free(&permit->set);
+    if (permit->info) {
+        npnt_free(permit->info->vertlat);
+        npnt_free(permit->info->uinNo);
+        npnt_free(permit->info->adcNumber);
+        npnt_free(permit->info->ficNumber);
+        npnt_free(permit->info);
+    }
+    memset(permit, 0, sizeof(npnt_permit_s));
+}
+
+void npnt_permit_store_free(npnt_permit_store_s *store)
+{
+    uint16_t i;
+
+    if (!store) {
+        return;
+    }
+    for (i = 0; i < store->count; i++) {
+        npnt_permit_free(store->entries[i].permit);
+        npnt_free(store->entries[i].permit);
+    }
+    npnt_free(store->entries);
+    memset(store, 0, sizeof(npnt_permit_store_s));
+}
+
+void npnt_permit_switch(npnt_s *handle, const npnt_permit_s *permit)
+{
+    //trackers and caches notice the new serial on their next use
+    __atomic_store_n(&handle->rcu.active, permit, __ATOMIC_SEQ_CST);
+}
+
+const npnt_permit_s* npnt_permit_read_begin(npnt_s *handle, uint8_t* slot)
+{
+    *slot = (uint8_t)(__atomic_load_n(&handle->rcu.epoch, __ATOMIC_SEQ_CST) & 1);
+    __atomic_fetch_add(&handle->rcu.readers[*slot], 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&handle->rcu.active, __ATOMIC_SEQ_CST);
+}
+
+void npnt_permit_read_end(npnt_s *handle, uint8_t slot)
+{
+    __atomic_fetch_sub(&handle->rcu.readers[slot], 1, __ATOMIC_RELEASE);
+}
+
+//Returns once no read section begun before the call is still open
+void npnt_permit_synchronize(npnt_s *handle)
+{
+    uint32_t i, idx;
+
+    for (i = 0; i < 2; i++) {
+        idx = __atomic_fetch_add(&handle->rcu.epoch, 1, __ATOMIC_SEQ_CST) & 1;
+        while (__atomic_load_n(&handle->rcu.readers[idx], __ATOMIC_SEQ_CST) != 0) {
+            NPNT_PERMIT_WAIT();
+        }
+    }
+}
+
+static void store_update_reach(npnt_permit_store_s *store, uint16_t from)
+{
+    uint16_t i;
+    for (i = from; i < store->count; i++) {
+        store->entries[i].reach = store->entries[i].end;
+        if (i > 0 && store->entries[i - 1].reach > store->entries[i].reach) {
+            store->entries[i].reach = store->entries[i - 1].reach;
+        }
+    }
+}
+
+//First entry starting after t
+static uint16_t store_upper(const npnt_permit_store_s *store, int64_t t)
+{
+    uint16_t lo = 0, hi = store->count, mid;
+    while (lo < hi) {
+        mid = (uint16_t)((lo + hi) / 2);
+        if (store->entries[mid].start > t) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+static int32_t store_find(const npnt_permit_store_s *store, const npnt_permit_s *permit)
+{
+    int32_t i = (int32_t)store_upper(store, permit->flightStart) - 1;
+    for (; i >= 0 && store->entries[i].start == permit->flightStart; i--) {
+        if (store->entries[i].permit == permit) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool same_str(const char* a, const char* b)
+{
+    return a && b && strcmp(a, b) == 0;
+}
+
+//Same test as breach evaluation, recurring windows are checked without the handle cache
+static bool permit_covers(const npnt_permit_s *permit, int64_t now)
+{
+    int64_t start;
+
+    if (now < permit->flightStart || now > permit->flightEnd) {
+        return false;
+    }
+    if (!permit->window_len) {
+        return true;
+    }
+    start = npnt_cron_prev(&permit->info->cron, now);
+    return start >= 0 && now < start + permit->window_len;
+}
+
+int8_t npnt_permit_add(npnt_s *handle, uint8_t *permart, uint32_t permart_length, uint8_t base64_encoded)
+{
+    npnt_s *scratch;
+    npnt_permit_store_s *store;
+    npnt_permit_entry_s *entries;
+    npnt_permit_s *permit = NULL;
+    uint16_t pos, i;
+    uint32_t grow;
+    int8_t ret;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    store = &handle->store;
+    //a whole handle is too large for small stacks, it comes from the pool like the permit
+    scratch = (npnt_s*)npnt_aligned_alloc(NPNT_CACHE_LINE, sizeof(npnt_s));
+    if (!scratch) {
+        return NPNT_PARSE_FAILED;
+    }
+    npnt_init_handle(scratch);
+    ret = npnt_set_permart(scratch, permart, permart_length, base64_encoded);
+    if (ret < 0) {
+        goto fail;
+    }
+
+    pos = store_upper(store, scratch->permit.flightStart);
+    for (i = pos; i > 0 && store->entries[i - 1].start == scratch->permit.flightStart; i--) {
+        permit = store->entries[i - 1].permit;
+        if (permit->flightEnd == scratch->permit.flightEnd &&
+            same_str(permit->info->adcNumber, scratch->permit.info->adcNumber) &&
+            same_str(permit->info->ficNumber, scratch->permit.info->ficNumber)) {
+            ret = NPNT_ALREADY_SET;
+            goto fail;
+        }
+    }
+
+    if (store->count >= NPNT_MAX_PERMITS) {
+        ret = NPNT_PARSE_FAILED;
+        goto fail;
+    }
+    if (store->count == store->max) {
+        grow = store->max * 2 + 4 > NPNT_MAX_PERMITS ? NPNT_MAX_PERMITS : store->max * 2 + 4;
+        entries = (npnt_permit_entry_s*)npnt_realloc(store->entries, grow*sizeof(npnt_permit_entry_s));
+        if (!entries) {
+            ret = NPNT_PARSE_FAILED;
+            goto fail;
+        }
+        store->entries = entries;
+        store->max = (uint16_t)grow;
+    }
+    permit = (npnt_permit_s*)npnt_aligned_alloc(NPNT_CACHE_LINE, sizeof(npnt_permit_s));
+    if (!permit) {
+        ret = NPNT_PARSE_FAILED;
+        goto fail;
+    }
+
+    //move the record out of the scratch handle, the XML goes with it
+    *permit = scratch->permit;
+    permit->serial = ++handle->rcu.serial;
+    memset(&scratch->permit, 0, sizeof(npnt_permit_s));
+    npnt_reset_handle(scratch);
+    npnt_free(scratch);
+
+    memmove(&store->entries[pos + 1], &store->entries[pos], (store->count - pos)*sizeof(npnt_permit_entry_s));
+    store->entries[pos].start = permit->flightStart;
+    store->entries[pos].end = permit->flightEnd;
+    store->entries[pos].permit = permit;
+    store->count++;
+    store_update_reach(store, pos);
+    return 0;
+
+fail:
+    npnt_reset_handle(scratch);
+    npnt_free(scratch);
+    return ret;
+}
+
+uint16_t npnt_permit_count(npnt_s *handle)
+{
+    if (!handle) {
+        return 0;
+    }
+    return handle->store.count;
+}
+
+const npnt_permit_s* npnt_permit_get(npnt_s *handle, uint16_t index)
+{
+    if (!handle || index >= handle->store.count) {
+        return NULL;
+    }
+    return handle->store.entries[index].permit;
+}
+
+int8_t npnt_permit_activate(npnt_s *handle, const npnt_permit_s *permit)
+{
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    if (!permit || !permit->verified ||
+        (permit != &handle->permit && store_find(&handle->store, permit) < 0)) {
+        return NPNT_INV_STATE;
+    }
+    npnt_permit_switch(handle, permit);
+    return 0;
+}
+
+int8_t npnt_permit_remove(npnt_s *handle, const npnt_permit_s *permit)
+{
+    npnt_permit_store_s *store;
+    int32_t i;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    store = &handle->store;
+    if (!permit || permit == handle->rcu.active) {
+        return NPNT_INV_STATE;
+    }
+    i = store_find(store, permit);
+    if (i < 0) {
+        return NPNT_INV_STATE;
+    }
+    //readers can only reach the record through a section begun while it was active
+    npnt_permit_synchronize(handle);
+    npnt_permit_free(store->entries[i].permit);
+    npnt_free(store->entries[i].permit);
+    memmove(&store->entries[i], &store->entries[i + 1], (store->count - i - 1)*sizeof(npnt_permit_entry_s));
+    store->count--;
+    store_update_reach(store, (uint16_t)i);
+    return 0;
+}
+
+uint16_t npnt_permit_prune(npnt_s *handle, int64_t now)
+{
+    npnt_permit_store_s *store;
+    uint16_t i, kept = 0;
+
+    if (!handle) {
+        return 0;
+    }
+    store = &handle->store;
+    for (i = 0; i < store->count; i++) {
+        if (store->entries[i].end < now && store->entries[i].permit != handle->rcu.active) {
+            break;
+        }
+    }
+    if (i == store->count) {
+        return 0;
+    }
+    npnt_permit_synchronize(handle);
+    for (i = 0; i < store->count; i++) {
+        if (store->entries[i].end < now && store->entries[i].permit != handle->rcu.active) {
+            npnt_permit_free(store->entries[i].permit);
+            npnt_free(store->entries[i].permit);
+            continue;
+        }
+        store->entries[kept++] = store->entries[i];
+    }
+    i = store->count - kept;
+    store->count = kept;
+    store_update_reach(store, 0);
+    return i;
+}
+
+int8_t npnt_permit_next(npnt_s *handle, int64_t now)
+{
+    npnt_permit_store_s *store;
+    int32_t i = 0;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    store = &handle->store;
+    if (handle->rcu.active && handle->rcu.active != &handle->permit) {
+        i = store_find(store, handle->rcu.active) + 1;
+    }
+    for (; i < store->count; i++) {
+        if (store->entries[i].end >= now) {
+            npnt_permit_switch(handle, store->entries[i].permit);
+            return 0;
+        }
+    }
+    return NPNT_INV_STATE;
+}
+
+int8_t npnt_permit_select(npnt_s *handle, int64_t now, float lat, float lon)
+{
+    npnt_permit_store_s *store;
+    const npnt_permit_s *permit, *first = NULL, *inside = NULL;
+    float x, y;
+    int32_t i;
+
+    if (!handle) {
+        return NPNT_UNALLOC_HANDLE;
+    }
+    store = &handle->store;
+    //walk back from the last window started by now, lowest index wins
+    for (i = (int32_t)store_upper(store, now) - 1; i >= 0 && store->entries[i].reach >= now; i--) {
+        permit = store->entries[i].permit;
+        if (store->entries[i].end < now || !permit_covers(permit, now)) {
+            continue;
+        }
+        first = permit;
+        npnt_frame_to_local(&permit->frame, lat, lon, &x, &y);
+        if (npnt_fence_set_query(&permit->set, x, y, NULL) == NPNT_FENCE_INSIDE) {
+            inside = permit;
+        }
+    }
+    if (!first) {
+        return NPNT_INV_STATE;
+    }
+    if (inside) {
+        npnt_permit_switch(handle, inside);
+        return NPNT_FENCE_INSIDE;
+    }
+    npnt_permit_switch(handle, first);
+    npnt_frame_to_local(&first->frame, lat, lon, &x, &y);
+    return npnt_fence_set_query(&first->set, x, y, NULL);
+}
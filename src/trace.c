@@ -0,0 +1,114 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <npnt_internal.h>
+#include <inttypes.h>
+
+/*
+ * Loading stage tracepoints. NPNT_TRACE_BEGIN/END in npnt_internal.h call
+ * npnt_trace_emit in builds with NPNT_TRACE and expand to nothing
+ * otherwise, so untraced builds carry neither the calls nor the clock
+ * reads. The Chrome sink writes duration events ("ph" "B" and "E") in
+ * the JSON object format, with timestamps in microseconds.
+ */
+
+static const char* const trace_stage_names[NPNT_TRACE_STAGES] = {
+    "npnt_set_permart", "decode", "xml parse", "signedinfo digest",
+    "rsa verify", "permission digest", "fence", "params"
+};
+
+#ifdef NPNT_TRACE
+
+#ifndef NPNT_TRACE_CLOCK_NS
+static uint64_t trace_clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+#define NPNT_TRACE_CLOCK_NS()       trace_clock_ns()
+#endif
+
+static npnt_trace_cb trace_cb;
+static void* trace_ctx;
+
+void npnt_trace_emit(uint8_t stage, bool begin)
+{
+    npnt_trace_event_s ev;
+
+    if (!trace_cb) {
+        return;
+    }
+    ev.ts_ns = NPNT_TRACE_CLOCK_NS();
+    ev.stage = stage;
+    ev.begin = begin;
+    trace_cb(&ev, trace_ctx);
+}
+
+#endif
+
+int8_t npnt_trace_set_callback(npnt_trace_cb cb, void* ctx)
+{
+#ifdef NPNT_TRACE
+    trace_cb = NULL;
+    trace_ctx = ctx;
+    trace_cb = cb;
+    return 0;
+#else
+    (void)cb;
+    (void)ctx;
+    return NPNT_INV_STATE;
+#endif
+}
+
+const char* npnt_trace_stage_name(uint8_t stage)
+{
+    if (stage >= NPNT_TRACE_STAGES) {
+        return "unknown";
+    }
+    return trace_stage_names[stage];
+}
+
+int8_t npnt_trace_chrome_open(npnt_trace_chrome_s* sink, FILE* fp)
+{
+    if (!sink || !fp) {
+        return NPNT_INV_STATE;
+    }
+    sink->fp = fp;
+    sink->events = 0;
+    if (fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") < 0) {
+        return NPNT_INV_STATE;
+    }
+    return 0;
+}
+
+void npnt_trace_chrome_event(const npnt_trace_event_s* ev, void* ctx)
+{
+    npnt_trace_chrome_s* sink = (npnt_trace_chrome_s*)ctx;
+
+    if (!sink || !sink->fp || !ev) {
+        return;
+    }
+    fprintf(sink->fp, "%s\n{\"name\":\"%s\",\"cat\":\"npnt\",\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03u,"
+            "\"pid\":1,\"tid\":1}", sink->events ? "," : "", npnt_trace_stage_name(ev->stage),
+            ev->begin ? 'B' : 'E', ev->ts_ns / 1000, (unsigned)(ev->ts_ns % 1000));
+    sink->events++;
+}
+
+int8_t npnt_trace_chrome_close(npnt_trace_chrome_s* sink)
+{
+    FILE* fp;
+
+    if (!sink || !sink->fp) {
+        return NPNT_INV_STATE;
+    }
+    fp = sink->fp;
+    sink->fp = NULL;
+    if (fprintf(fp, "\n]}\n") < 0 || fflush(fp) != 0) {
+        return NPNT_INV_STATE;
+    }
+    return 0;
+}
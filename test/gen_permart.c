@@ -0,0 +1,600 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+ /**
+ * @file    test/gen_permart.c
+ * @brief   Generates signed permission artefacts of any size
+ * @details Writes a UAPermission artefact with an enveloped XML-DSig
+ *          signature made by a local RSA key, so loading can be measured
+ *          on fences of a few to a hundred thousand vertices without the
+ *          DGCA key. Digests are taken with the library's own
+ *          canonicalizer, and the result is loaded back through
+ *          npnt_set_permart before the tool reports success.
+ *
+ *          The fence is a ring of teeth around a fixed centre, alternate
+ *          vertices sit TOOTH_DEPTH closer in, spaced wide enough that
+ *          none of them is merged or dropped by fence normalization.
+ *
+ *          The signing key is read from the -k file, or generated and
+ *          saved there when the file does not exist, so artefacts made in
+ *          separate runs verify against the same dgca_pubkey.pem, which
+ *          is written to the working directory where the library reads it.
+ *
+ *          Empty elements are always written with attributes, the
+ *          library canonicalizer only expands those.
+ *
+ *          With -f json the same permission goes into the JSON envelope
+ *          read by npnt_set_permart_json instead, signed over the digest
+ *          of its base64 text.
+ * @{
+ */
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include <npnt_internal.h>
+#include <npnt.h>
+#include <math.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CENTRE_LAT          18.8083
+#define CENTRE_LON          78.4438
+#define VERTEX_SPACING      20.0        //m between neighbouring vertices
+#define TOOTH_DEPTH         10.0        //m
+#define MIN_RADIUS          500.0       //m
+#define METRES_PER_DEGREE   111320.0
+#define DSIG_NS             "http://www.w3.org/2000/09/xmldsig#"
+#define SIGNEDINFO_HEADER   "<SignedInfo xmlns=\"" DSIG_NS "\">"
+
+typedef struct {
+    char* data;
+    size_t len;
+    size_t max;
+} text_s;
+
+typedef struct {
+    uint32_t nverts;        //Coordinate elements, the first is repeated as the last
+    uint32_t cert_bytes;    //0 embeds a self-signed certificate of the key
+    bool indent;            //newline and indentation between elements
+    bool pairs;             //empty elements as start-end tag pairs
+    bool json;              //JSON envelope instead of XML-DSig
+} gen_opts_s;
+
+static gen_opts_s opts = {4, 0, true, false, false};
+
+static int text_printf(text_s* t, const char* fmt, ...)
+{
+    va_list ap;
+    size_t need;
+    char* grown;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        return -1;
+    }
+    need = t->len + (size_t)n + 1;
+    if (need > t->max) {
+        t->max = need > 2 * t->max ? need : 2 * t->max;
+        grown = (char*)realloc(t->data, t->max);
+        if (!grown) {
+            return -1;
+        }
+        t->data = grown;
+    }
+    va_start(ap, fmt);
+    vsnprintf(t->data + t->len, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    t->len += (size_t)n;
+    return 0;
+}
+
+//Line break and indentation before an element at depth
+static void text_break(text_s* t, uint8_t depth)
+{
+    if (opts.indent) {
+        text_printf(t, "\n%*s", 4 * depth, "");
+    }
+}
+
+//Element without content, attrs starts with a space
+static void text_empty(text_s* t, uint8_t depth, const char* name, const char* attrs)
+{
+    text_break(t, depth);
+    if (opts.pairs) {
+        text_printf(t, "<%s%s></%s>", name, attrs, name);
+    } else {
+        text_printf(t, "<%s%s/>", name, attrs);
+    }
+}
+
+static EVP_PKEY* load_or_make_key(const char* path)
+{
+    EVP_PKEY_CTX* ctx;
+    EVP_PKEY* key = NULL;
+    FILE* fp = fopen(path, "r");
+
+    if (fp) {
+        key = PEM_read_PrivateKey(fp, NULL, NULL, NULL);
+        fclose(fp);
+        return key;
+    }
+    ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+    if (ctx && EVP_PKEY_keygen_init(ctx) > 0 && EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) > 0) {
+        EVP_PKEY_keygen(ctx, &key);
+    }
+    EVP_PKEY_CTX_free(ctx);
+    if (!key) {
+        return NULL;
+    }
+    fp = fopen(path, "w");
+    if (!fp || !PEM_write_PrivateKey(fp, key, NULL, NULL, 0, NULL, NULL)) {
+        if (fp) {
+            fclose(fp);
+        }
+        EVP_PKEY_free(key);
+        return NULL;
+    }
+    fclose(fp);
+    return key;
+}
+
+//Base64 X509Certificate text, lines of 72 as the library encoder writes them
+static uint8_t* make_certificate(EVP_PKEY* key, uint32_t* len)
+{
+    X509* cert;
+    uint8_t *der = NULL, *text = NULL;
+    uint32_t i, seed = 0x9E3779B9u;
+    int der_len;
+
+    if (opts.cert_bytes) {
+        der_len = (int)(opts.cert_bytes / 4 * 3);
+        der = (uint8_t*)malloc(der_len ? der_len : 1);
+        if (!der) {
+            return NULL;
+        }
+        for (i = 0; i < (uint32_t)der_len; i++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            der[i] = (uint8_t)seed;
+        }
+        text = base64_encode(der, der_len, len);
+        free(der);
+        return text;
+    }
+
+    cert = X509_new();
+    if (!cert) {
+        return NULL;
+    }
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_get_notBefore(cert), 0);
+    X509_gmtime_adj(X509_get_notAfter(cert), 365L * 86400);
+    X509_set_pubkey(cert, key);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN", MBSTRING_ASC,
+                               (const unsigned char*)"npnt-test", -1, -1, 0);
+    X509_set_issuer_name(cert, X509_get_subject_name(cert));
+    if (X509_sign(cert, key, EVP_sha256()) > 0) {
+        der_len = i2d_X509(cert, &der);
+        if (der_len > 0) {
+            text = base64_encode(der, der_len, len);
+        }
+        OPENSSL_free(der);
+    }
+    X509_free(cert);
+    return text;
+}
+
+//PKCS#1 v1.5 over a SHA1 digest, the scheme npnt_check_authenticity verifies
+static uint8_t* sign_digest(EVP_PKEY* key, const char* digest, size_t* sig_len)
+{
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(key, NULL);
+    uint8_t* sig = NULL;
+
+    if (ctx && EVP_PKEY_sign_init(ctx) > 0 &&
+        EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) > 0 &&
+        EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha1()) > 0 &&
+        EVP_PKEY_sign(ctx, NULL, sig_len, (const uint8_t*)digest, 20) > 0) {
+        sig = (uint8_t*)malloc(*sig_len);
+        if (sig && EVP_PKEY_sign(ctx, sig, sig_len, (const uint8_t*)digest, 20) <= 0) {
+            free(sig);
+            sig = NULL;
+        }
+    }
+    EVP_PKEY_CTX_free(ctx);
+    return sig;
+}
+
+//Vertex i of the toothed ring, the first is repeated as the last
+static void fence_vertex(uint32_t i, double* lat, double* lon)
+{
+    uint32_t ring = opts.nverts - 1;
+    double radius, r, a;
+
+    radius = ring * VERTEX_SPACING / (2 * M_PI);
+    if (radius < MIN_RADIUS) {
+        radius = MIN_RADIUS;
+    }
+    a = 2 * M_PI * (i % ring) / ring;
+    r = (i % ring) % 2 ? radius - TOOTH_DEPTH : radius;
+    *lat = CENTRE_LAT + r * sin(a) / METRES_PER_DEGREE;
+    *lon = CENTRE_LON + r * cos(a) / (METRES_PER_DEGREE * cos(CENTRE_LAT * M_PI / 180));
+}
+
+static void write_permission(text_s* t)
+{
+    double lat, lon;
+    uint32_t i;
+    char attrs[96];
+
+    text_printf(t, "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?><UAPermission>");
+    text_break(t, 1);
+    text_printf(t, "<Permission>");
+    text_break(t, 1);
+    text_printf(t, "<Owner operatorID=\"82ab06908761488e91bcbf581dbf96b0\">");
+    text_empty(t, 2, "Pilot", " id=\"9646771ef9e148228a6d56f305df6489\" validTo=\"NA\"");
+    text_break(t, 1);
+    text_printf(t, "</Owner>");
+    text_break(t, 1);
+    text_printf(t, "<FlightDetails>");
+    text_empty(t, 2, "UADetails", " uinNo=\"5bfd56f14cedfd0006411b7b\"");
+    text_empty(t, 2, "FlightPurpose", " shortDesc=\"test\"");
+    text_empty(t, 2, "PayloadDetails", " payLoadWeightInKg=\"5\" payloadDetails=\"test\"");
+    text_break(t, 2);
+    text_printf(t, "<FlightParameters adcNumber=\"RCA0001\" ficNumber=\"00000RO\" "
+                "flightEndTime=\"2019-02-22T11:00:27\" flightStartTime=\"2019-02-22T10:45:00\" "
+                "maxAltitude=\"19\" recurrenceTimeExpression=\"\" recurrenceTimeExpressionType=\"CRON_QUARTZ\" "
+                "recurringTimeDurationInMinutes=\"\">");
+    text_break(t, 3);
+    text_printf(t, "<Coordinates>");
+
+    for (i = 0; i < opts.nverts; i++) {
+        fence_vertex(i, &lat, &lon);
+        snprintf(attrs, sizeof(attrs), " latitude=\"%.9f\" longitude=\"%.9f\"", lat, lon);
+        text_empty(t, 4, "Coordinate", attrs);
+    }
+    text_break(t, 3);
+    text_printf(t, "</Coordinates>");
+    text_break(t, 2);
+    text_printf(t, "</FlightParameters>");
+    text_break(t, 1);
+    text_printf(t, "</FlightDetails>");
+    text_break(t, 1);
+    text_printf(t, "</Permission>");
+    text_break(t, 0);
+}
+
+static char* generate(EVP_PKEY* key, size_t* out_len)
+{
+    text_s t = {NULL, 0, 0};
+    const char* tail = opts.indent ? "\n</UAPermission>\n" : "</UAPermission>";
+    char digest[20];
+    char digest64[32];
+    uint8_t *text = NULL, *sig = NULL, *cert;
+    uint32_t text_len, cert_len;
+    size_t sig_len, perm_start, si_start;
+
+    cert = make_certificate(key, &cert_len);
+    if (!cert) {
+        return NULL;
+    }
+
+    //Permission digest, everything outside the Signature element
+    write_permission(&t);
+    perm_start = strstr(t.data, "<UAPermission>") - t.data;
+    reset_sha1();
+    npnt_digest_canonical(t.data + perm_start, (int32_t)(t.len - perm_start));
+    update_sha1(tail, strlen(tail));
+    final_sha1(digest);
+    text = base64_encode((const uint8_t*)digest, 20, &text_len);
+    if (!text) {
+        goto fail;
+    }
+    snprintf(digest64, sizeof(digest64), "%.*s", (int)(text_len - 1), text);
+    npnt_free(text);
+    text = NULL;
+
+    text_printf(&t, "<Signature xmlns=\"%s\">", DSIG_NS);
+    text_break(&t, 1);
+    text_printf(&t, "<SignedInfo>");
+    si_start = t.len;
+    text_empty(&t, 2, "CanonicalizationMethod", " Algorithm=\"http://www.w3.org/TR/2001/REC-xml-c14n-20010315\"");
+    text_empty(&t, 2, "SignatureMethod", " Algorithm=\"" DSIG_NS "rsa-sha1\"");
+    text_break(&t, 2);
+    text_printf(&t, "<Reference URI=\"\">");
+    text_break(&t, 3);
+    text_printf(&t, "<Transforms>");
+    text_empty(&t, 4, "Transform", " Algorithm=\"" DSIG_NS "enveloped-signature\"");
+    text_break(&t, 3);
+    text_printf(&t, "</Transforms>");
+    text_empty(&t, 3, "DigestMethod", " Algorithm=\"" DSIG_NS "sha1\"");
+    text_break(&t, 3);
+    text_printf(&t, "<DigestValue>%s</DigestValue>", digest64);
+    text_break(&t, 2);
+    text_printf(&t, "</Reference>");
+    text_break(&t, 1);
+    text_printf(&t, "</SignedInfo>");
+    text_break(&t, 1);
+
+    //SignedInfo digest, up to SignatureValue as npnt_verify_permart takes it
+    reset_sha1();
+    update_sha1(SIGNEDINFO_HEADER, strlen(SIGNEDINFO_HEADER));
+    npnt_digest_canonical(t.data + si_start, (int32_t)(t.len - si_start));
+    final_sha1(digest);
+    sig = sign_digest(key, digest, &sig_len);
+    if (!sig) {
+        goto fail;
+    }
+    text = base64_encode(sig, sig_len, &text_len);
+    if (!text) {
+        goto fail;
+    }
+    text_printf(&t, "<SignatureValue>%.*s</SignatureValue>", (int)(text_len - 1), text);
+    text_break(&t, 1);
+    text_printf(&t, "<KeyInfo><X509Data><X509SubjectName>CN=npnt-test</X509SubjectName>"
+                "<X509Certificate>%.*s</X509Certificate></X509Data></KeyInfo>", (int)(cert_len - 1), cert);
+    text_break(&t, 0);
+    if (text_printf(&t, "</Signature>%s", tail) < 0) {
+        goto fail;
+    }
+    npnt_free(text);
+    npnt_free(cert);
+    free(sig);
+    *out_len = t.len;
+    return t.data;
+
+fail:
+    npnt_free(text);
+    npnt_free(cert);
+    free(sig);
+    free(t.data);
+    return NULL;
+}
+
+//Permission with the names of the XML artefact, see src/art_json.c
+static void write_permission_json(text_s* t)
+{
+    double lat, lon;
+    uint32_t i;
+
+    text_printf(t, "{\"UAPermission\":{\"Permission\":{");
+    text_break(t, 1);
+    text_printf(t, "\"Owner\":{\"operatorID\":\"82ab06908761488e91bcbf581dbf96b0\","
+                "\"Pilot\":{\"id\":\"9646771ef9e148228a6d56f305df6489\",\"validTo\":\"NA\"}},");
+    text_break(t, 1);
+    text_printf(t, "\"FlightDetails\":{");
+    text_break(t, 2);
+    text_printf(t, "\"UADetails\":{\"uinNo\":\"5bfd56f14cedfd0006411b7b\"},");
+    text_break(t, 2);
+    text_printf(t, "\"FlightPurpose\":{\"shortDesc\":\"test\"},");
+    text_break(t, 2);
+    text_printf(t, "\"PayloadDetails\":{\"payLoadWeightInKg\":5,\"payloadDetails\":\"test\"},");
+    text_break(t, 2);
+    text_printf(t, "\"FlightParameters\":{\"adcNumber\":\"RCA0001\",\"ficNumber\":\"00000RO\","
+                "\"flightEndTime\":\"2019-02-22T11:00:27\",\"flightStartTime\":\"2019-02-22T10:45:00\","
+                "\"maxAltitude\":19,\"recurrenceTimeExpression\":\"\",\"recurrenceTimeExpressionType\":\"CRON_QUARTZ\","
+                "\"recurringTimeDurationInMinutes\":\"\",");
+    text_break(t, 3);
+    text_printf(t, "\"Coordinates\":[");
+    for (i = 0; i < opts.nverts; i++) {
+        fence_vertex(i, &lat, &lon);
+        text_break(t, 4);
+        text_printf(t, "{\"latitude\":%.9f,\"longitude\":%.9f}%s", lat, lon, i + 1 < opts.nverts ? "," : "");
+    }
+    text_break(t, 3);
+    text_printf(t, "]}}}}}");
+    text_break(t, 0);
+}
+
+//base64 on one line, as a JSON string can hold it
+static uint8_t* base64_line(const uint8_t* data, size_t len, uint32_t* out_len)
+{
+    uint8_t* text = base64_encode(data, (uint32_t)len, out_len);
+    uint32_t i, n = 0;
+
+    if (!text) {
+        return NULL;
+    }
+    for (i = 0; i < *out_len; i++) {
+        if (text[i] != '\n') {
+            text[n++] = text[i];
+        }
+    }
+    text[n] = '\0';
+    *out_len = n;
+    return text;
+}
+
+static char* generate_json(EVP_PKEY* key, size_t* out_len)
+{
+    text_s perm = {NULL, 0, 0}, t = {NULL, 0, 0};
+    uint8_t *artefact = NULL, *text = NULL, *sig = NULL;
+    uint32_t artefact_len, text_len;
+    size_t sig_len;
+    char digest[20];
+
+    write_permission_json(&perm);
+    if (!perm.data) {
+        return NULL;
+    }
+    artefact = base64_line((const uint8_t*)perm.data, perm.len, &artefact_len);
+    if (!artefact) {
+        goto fail;
+    }
+    reset_sha1();
+    update_sha1((const char*)artefact, artefact_len);
+    final_sha1(digest);
+    sig = sign_digest(key, digest, &sig_len);
+    if (!sig) {
+        goto fail;
+    }
+    text = base64_line(sig, sig_len, &text_len);
+    if (!text) {
+        goto fail;
+    }
+    text_printf(&t, "{");
+    text_break(&t, 1);
+    text_printf(&t, "\"artefact\" : \"%s\",", artefact);
+    text_break(&t, 1);
+    if (text_printf(&t, "\"signature\" : \"%s\"%s}%s", text, opts.indent ? "\n" : "", opts.indent ? "\n" : "") < 0) {
+        goto fail;
+    }
+    npnt_free(artefact);
+    npnt_free(text);
+    free(sig);
+    free(perm.data);
+    *out_len = t.len;
+    return t.data;
+
+fail:
+    npnt_free(artefact);
+    npnt_free(text);
+    free(sig);
+    free(perm.data);
+    free(t.data);
+    return NULL;
+}
+
+static int write_pubkey(EVP_PKEY* key)
+{
+    FILE* fp = fopen("dgca_pubkey.pem", "w");
+    int ok;
+
+    if (!fp) {
+        return 0;
+    }
+    ok = PEM_write_PUBKEY(fp, key);
+    fclose(fp);
+    return ok;
+}
+
+static void usage(const char* prog)
+{
+    printf("Usage: %s [-n vertices] [-c cert_bytes] [-w compact|indent] [-s] [-f xml|json] [-k key.pem] [-o out.xml]\n"
+           "  -n  Coordinate elements, the first repeated as the last, at least 4 (4)\n"
+           "  -c  bytes of X509Certificate text, 0 for a self-signed certificate (0)\n"
+           "  -w  whitespace between elements (indent)\n"
+           "  -s  write empty elements as start-end tag pairs\n"
+           "  -f  XML-DSig artefact or JSON envelope (xml)\n"
+           "  -k  RSA signing key, created when missing (permart_key.pem)\n"
+           "  -o  output (permissionArtifact_<n>.xml or .json)\n"
+           "The public key is written to dgca_pubkey.pem for the library.\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    const char* key_path = "permart_key.pem";
+    const char* out_path = NULL;
+    char out_name[64];
+    EVP_PKEY* key;
+    npnt_s handle;
+    struct timespec t0, t1;
+    char* xml;
+    size_t xml_len;
+    FILE* fp;
+    int opt, ret;
+
+    while ((opt = getopt(argc, argv, "n:c:w:sf:k:o:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            opts.nverts = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            opts.cert_bytes = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'w':
+            if (strcmp(optarg, "compact") == 0) {
+                opts.indent = false;
+            } else if (strcmp(optarg, "indent") == 0) {
+                opts.indent = true;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 's':
+            opts.pairs = true;
+            break;
+        case 'f':
+            if (strcmp(optarg, "json") == 0) {
+                opts.json = true;
+            } else if (strcmp(optarg, "xml") == 0) {
+                opts.json = false;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'k':
+            key_path = optarg;
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opts.nverts < 4) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!out_path) {
+        snprintf(out_name, sizeof(out_name), "permissionArtifact_%u.%s", opts.nverts, opts.json ? "json" : "xml");
+        out_path = out_name;
+    }
+
+    key = load_or_make_key(key_path);
+    if (!key || !write_pubkey(key)) {
+        printf("Failed to set up signing key %s\n", key_path);
+        return 1;
+    }
+    xml = opts.json ? generate_json(key, &xml_len) : generate(key, &xml_len);
+    EVP_PKEY_free(key);
+    if (!xml || xml_len > UINT32_MAX) {
+        printf("Failed to generate artefact\n");
+        return 1;
+    }
+    fp = fopen(out_path, "wb");
+    if (!fp || fwrite(xml, 1, xml_len, fp) != xml_len) {
+        printf("Failed to write %s\n", out_path);
+        return 1;
+    }
+    fclose(fp);
+
+    //Load it back the way an application would
+    npnt_init_handle(&handle);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (opts.json) {
+        ret = npnt_set_permart_json(&handle, (uint8_t*)xml, (uint32_t)xml_len);
+    } else {
+        ret = npnt_set_permart(&handle, (uint8_t*)xml, (uint32_t)xml_len, 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (ret != 0) {
+        printf("%s: %zu bytes, rejected by %s %d\n", out_path, xml_len,
+               opts.json ? "npnt_set_permart_json" : "npnt_set_permart", ret);
+        npnt_reset_handle(&handle);
+        free(xml);
+        return 1;
+    }
+    printf("%s: %zu bytes, %u vertices (%u after normalization), loaded in %.3f ms\n", out_path, xml_len,
+           opts.nverts, handle.permit.info->nverts,
+           (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+    npnt_reset_handle(&handle);
+    free(xml);
+    return 0;
+}
+
+ /** @} */
@@ -0,0 +1,42 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Methods the library expects from the application. The tests and tools
+ * only load artefacts, these only have to link.
+ */
+
+#include <npnt.h>
+
+uint64_t npnt_utc_time()
+{
+    return 0;
+}
+
+int8_t npnt_abs_position(float *gps_lat, float *gps_lon, float *altitude_agl)
+{
+    (void)gps_lat;
+    (void)gps_lon;
+    (void)altitude_agl;
+    return -1;
+}
+
+int8_t npnt_log_write(const npnt_breach_snapshot_s *records, uint32_t count)
+{
+    (void)records;
+    (void)count;
+    return 0;
+}
+
+int8_t npnt_sign_raw_data(npnt_s *handle, uint8_t* raw_data, uint16_t raw_data_len, uint8_t* signature, uint16_t* signature_len)
+{
+    (void)handle;
+    (void)raw_data;
+    (void)raw_data_len;
+    (void)signature;
+    (void)signature_len;
+    return -1;
+}
@@ -88,7 +88,8 @@ void free_common() {
 int16_t read_and_create_signed_json() {
 	FILE *file;
 	uint8_t *buffer, *base64_out, *der_sign, *der_sign_base64, *signed_json;
-    uint16_t outlen, sig_len, der_sign_base64_len;
+    uint32_t outlen, der_sign_base64_len;
+    uint16_t sig_len;
 	uint32_t fileLen;
     ECDSA_SIG *signature;
     uint8_t hash[32];
@@ -266,10 +267,12 @@ int16_t extract_public_key_from_xml_artefact()
 
 int16_t load_artifact()
 {
-    int16_t file_len, outlen;
+    int32_t file_len;
+    uint32_t outlen;
     uint8_t *buffer = NULL;
     uint8_t *base64_permart = NULL;
     int16_t ret;
+    FILE* base64_file;
     FILE* artefact_xml = fopen("permissionArtifact.xml", "rb");
     //Get file length
 	fseek(artefact_xml, 0, SEEK_END);
@@ -292,6 +295,7 @@ int16_t load_artifact()
     if (!base64_permart) {
         BIO_printf(outbio, "Memory error: Failed to generate base64\n");
         ret = errno;
+        goto fail;
     }
     BIO_printf(outbio, "XML BASE64:\n%s\n", base64_permart);
 
@@ -300,8 +304,36 @@ int16_t load_artifact()
     ret = npnt_set_permart(&npnt_handle, base64_permart, outlen, true);
     if (ret != 0) {
         BIO_printf(outbio, "Failed to set artifact %d\n", ret);
+        goto fail;
+    } else {
+        BIO_printf(outbio, "Artefact Set Successfully!\n");
+    }
+
+    //same artefact mapped from the XML file as is
+    npnt_reset_handle(&npnt_handle);
+    ret = npnt_set_permart_file(&npnt_handle, "permissionArtifact.xml");
+    if (ret != 0) {
+        BIO_printf(outbio, "Failed to set artifact from XML file %d\n", ret);
+        goto fail;
     } else {
-        BIO_printf(outbio, "Artefact Set Successfully!\n", ret);
+        BIO_printf(outbio, "Artefact Set Successfully from XML file!\n");
+    }
+
+    //and from a base64 file, told apart from XML by its first byte
+    base64_file = fopen("permissionArtifact.b64", "wb");
+    if (!base64_file) {
+        ret = errno;
+        goto fail;
+    }
+    fwrite(base64_permart, outlen, 1, base64_file);
+    fclose(base64_file);
+    npnt_reset_handle(&npnt_handle);
+    ret = npnt_set_permart_file(&npnt_handle, "permissionArtifact.b64");
+    remove("permissionArtifact.b64");
+    if (ret != 0) {
+        BIO_printf(outbio, "Failed to set artifact from base64 file %d\n", ret);
+    } else {
+        BIO_printf(outbio, "Artefact Set Successfully from base64 file!\n");
     }
 
 fail:
@@ -309,9 +341,7 @@ fail:
     if (buffer) {
         free(buffer);
     }
-    if (base64_permart) {
-        free(base64_permart);
-    }
+    npnt_free(base64_permart);
     return ret;
 }
 
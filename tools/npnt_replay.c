@@ -0,0 +1,330 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * npnt-replay, runs a recorded track through npnt_breach_evaluate.
+ *
+ * The artefact is loaded like npnt-validate does, then every sample of the
+ * track is made the answer of the position and time callbacks below and
+ * evaluated once, as fast as possible or paced by the sample times with
+ * -s. Tracks are read whole before replaying, either a flight log from
+ * npnt_flight_log_append or CSV lines
+ *   utc_time,lat,lon,altitude_agl
+ * with UTC epoch seconds, fractions only pace the replay. Empty lat or lon
+ * is a sample without fix, lines not starting with a number are skipped.
+ *
+ * Output is one JSON line per change of the breach word, so a known track
+ * diffs against its last run as a regression test, and a summary with
+ * samples per second and percentiles of the evaluation latency:
+ *   {"sample", "utc_time", "lat", "lon", "altitude", "from", "to"}
+ *   {"summary":{"samples", "transitions", "seconds", "per_second",
+ *    "latency_ns":{"p50", "p90", "p99", "p999", "max"}, "breached":{...}}}
+ *
+ * Usage: npnt-replay [-s speed] artefact track.csv|track.flog
+ */
+
+#include <npnt.h>
+#include <errno.h>
+#include <unistd.h>
+
+typedef struct {
+    double utc_time;        //seconds
+    float lat, lon, altitude;
+    bool fix;
+} replay_sample_s;
+
+static const char* const bit_names[] = {"FENCE", "EXCL", "ALT", "TIME", "NOPOS", "NOTIME", "NOPERM"};
+
+#define NBITS               (sizeof(bit_names) / sizeof(bit_names[0]))
+
+//Sample the callbacks answer with
+static const replay_sample_s* current;
+
+uint64_t npnt_utc_time()
+{
+    return current ? (uint64_t)current->utc_time : 0;
+}
+
+int8_t npnt_abs_position(float *gps_lat, float *gps_lon, float *altitude_agl)
+{
+    if (!current || !current->fix) {
+        return -1;
+    }
+    *gps_lat = current->lat;
+    *gps_lon = current->lon;
+    *altitude_agl = current->altitude;
+    return 0;
+}
+
+//Declared for the application, breach evaluation never asks
+int8_t npnt_aircraft_state(npnt_s *handle)
+{
+    (void)handle;
+    return 0;
+}
+
+int8_t npnt_log_write(const npnt_breach_snapshot_s *records, uint32_t count)
+{
+    (void)records;
+    (void)count;
+    return 0;
+}
+
+int8_t npnt_sign_raw_data(npnt_s *handle, uint8_t* raw_data, uint16_t raw_data_len, uint8_t* signature, uint16_t* signature_len)
+{
+    (void)handle;
+    (void)raw_data;
+    (void)raw_data_len;
+    (void)signature;
+    (void)signature_len;
+    return -1;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void bits_string(uint8_t bits, char* out, size_t size)
+{
+    size_t len = 0;
+    uint32_t i;
+
+    out[0] = '\0';
+    for (i = 0; i < NBITS; i++) {
+        if (bits & (1u << i)) {
+            len += snprintf(&out[len], size - len, "%s%s", len ? "|" : "", bit_names[i]);
+        }
+    }
+}
+
+static int8_t load_artefact(npnt_s* handle, const char* path)
+{
+    size_t plen = strlen(path), got;
+    uint8_t* buf;
+    int8_t ret;
+    long len;
+    FILE* fp;
+
+    if (plen <= 5 || strcmp(path + plen - 5, ".json") != 0) {
+        return npnt_set_permart_file(handle, path);
+    }
+    fp = fopen(path, "rb");
+    if (!fp) {
+        return NPNT_INV_ART;
+    }
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buf = len > 0 ? (uint8_t*)malloc((size_t)len) : NULL;
+    got = buf ? fread(buf, 1, (size_t)len, fp) : 0;
+    fclose(fp);
+    ret = got == (size_t)len && buf ? npnt_set_permart_json(handle, buf, (uint32_t)got) : NPNT_INV_ART;
+    free(buf);
+    return ret;
+}
+
+static int push_sample(replay_sample_s** samples, uint32_t* count, uint32_t* max, const replay_sample_s* s)
+{
+    replay_sample_s* grown;
+
+    if (*count == *max) {
+        grown = (replay_sample_s*)realloc(*samples, (*max * 2 + 1024) * sizeof(replay_sample_s));
+        if (!grown) {
+            return -1;
+        }
+        *samples = grown;
+        *max = *max * 2 + 1024;
+    }
+    (*samples)[(*count)++] = *s;
+    return 0;
+}
+
+static int load_flight_log(const char* path, replay_sample_s** samples, uint32_t* count)
+{
+    npnt_flight_log_s log;
+    replay_sample_s s;
+    uint32_t max = 0, i;
+
+    if (npnt_flight_log_open(&log, path, 0, 0, NULL) < 0) {
+        return -1;
+    }
+    for (i = 0; i < log.hdr->count; i++) {
+        s.utc_time = (double)log.records[i].utc_time;
+        s.lat = log.records[i].lat;
+        s.lon = log.records[i].lon;
+        s.altitude = log.records[i].altitude;
+        s.fix = true;
+        if (push_sample(samples, count, &max, &s) < 0) {
+            npnt_flight_log_close(&log);
+            return -1;
+        }
+    }
+    npnt_flight_log_close(&log);
+    return 0;
+}
+
+static int load_csv(FILE* fp, replay_sample_s** samples, uint32_t* count)
+{
+    replay_sample_s s;
+    uint32_t max = 0;
+    char line[256], *p, *end;
+
+    while (fgets(line, sizeof(line), fp)) {
+        p = line;
+        s.utc_time = strtod(p, &end);
+        if (end == p || *end != ',') {
+            continue;
+        }
+        p = end + 1;
+        s.fix = *p != ',';
+        s.lat = strtof(p, &end);
+        p = *end == ',' ? end + 1 : end;
+        s.fix = s.fix && *p != ',' && *p != '\n' && *p != '\0';
+        s.lon = strtof(p, &end);
+        p = *end == ',' ? end + 1 : end;
+        s.altitude = strtof(p, &end);
+        if (push_sample(samples, count, &max, &s) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int load_track(const char* path, replay_sample_s** samples, uint32_t* count)
+{
+    char magic[sizeof(NPNT_FLOG_MAGIC) - 1];
+    FILE* fp = fopen(path, "rb");
+    int ret;
+
+    if (!fp) {
+        return -1;
+    }
+    if (fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && memcmp(magic, NPNT_FLOG_MAGIC, sizeof(magic)) == 0) {
+        fclose(fp);
+        return load_flight_log(path, samples, count);
+    }
+    rewind(fp);
+    ret = load_csv(fp, samples, count);
+    fclose(fp);
+    return ret;
+}
+
+static int cmp_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void usage(const char* prog)
+{
+    printf("Usage: %s [-s speed] artefact track.csv|track.flog\n"
+           "  -s  pace samples by their times, 1 for real time, 0 as fast as possible (0)\n"
+           "Artefacts are verified against dgca_pubkey.pem in the working directory.\n"
+           "Tracks are flight logs or CSV lines utc_time,lat,lon,altitude_agl.\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    npnt_s handle;
+    replay_sample_s* samples = NULL;
+    uint32_t* latency = NULL;
+    uint32_t count = 0, transitions = 0, breached[NBITS] = {0}, i, b;
+    uint64_t t0, t1, start, elapsed;
+    double speed = 0;
+    struct timespec due;
+    char from[64], to[64];
+    uint8_t word = 0, prev = 0;
+    int8_t ret;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:h")) != -1) {
+        switch (opt) {
+        case 's':
+            speed = atof(optarg);
+            if (speed < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    npnt_init_handle(&handle);
+    ret = load_artefact(&handle, argv[optind]);
+    if (ret < 0) {
+        printf("%s rejected %d\n", argv[optind], ret);
+        return 1;
+    }
+    if (load_track(argv[optind + 1], &samples, &count) < 0 || count == 0) {
+        printf("can't read track %s\n", argv[optind + 1]);
+        goto fail;
+    }
+    latency = (uint32_t*)malloc(count * sizeof(uint32_t));
+    if (!latency) {
+        goto fail;
+    }
+
+    start = now_ns();
+    for (i = 0; i < count; i++) {
+        if (speed > 0) {
+            t0 = start + (uint64_t)((samples[i].utc_time - samples[0].utc_time) / speed * 1e9);
+            due.tv_sec = (time_t)(t0 / 1000000000ull);
+            due.tv_nsec = (long)(t0 % 1000000000ull);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) == EINTR);
+        }
+        current = &samples[i];
+        t0 = now_ns();
+        word = (uint8_t)npnt_breach_evaluate(&handle);
+        t1 = now_ns();
+        latency[i] = t1 - t0 > UINT32_MAX ? UINT32_MAX : (uint32_t)(t1 - t0);
+        for (b = 0; b < NBITS; b++) {
+            breached[b] += (word >> b) & 1;
+        }
+        if (i == 0 || word != prev) {
+            bits_string(prev, from, sizeof(from));
+            bits_string(word, to, sizeof(to));
+            printf("{\"sample\":%u,\"utc_time\":%.3f,\"lat\":%.7f,\"lon\":%.7f,\"altitude\":%.1f,"
+                   "\"from\":\"%s\",\"to\":\"%s\"}\n", i, samples[i].utc_time, samples[i].lat, samples[i].lon,
+                   samples[i].altitude, i ? from : "", to);
+            transitions += i > 0;
+            prev = word;
+        }
+    }
+    elapsed = now_ns() - start;
+    current = NULL;
+
+    qsort(latency, count, sizeof(uint32_t), cmp_u32);
+    printf("{\"summary\":{\"samples\":%u,\"transitions\":%u,\"seconds\":%.3f,\"per_second\":%.0f,"
+           "\"latency_ns\":{\"p50\":%u,\"p90\":%u,\"p99\":%u,\"p999\":%u,\"max\":%u},\"breached\":{",
+           count, transitions, elapsed / 1e9, count * 1e9 / (double)(elapsed ? elapsed : 1),
+           latency[(count - 1) / 2], latency[(uint64_t)(count - 1) * 90 / 100],
+           latency[(uint64_t)(count - 1) * 99 / 100], latency[(uint64_t)(count - 1) * 999 / 1000],
+           latency[count - 1]);
+    for (b = 0; b < NBITS; b++) {
+        printf("%s\"%s\":%u", b ? "," : "", bit_names[b], breached[b]);
+    }
+    printf("}}}\n");
+    free(latency);
+    free(samples);
+    npnt_reset_handle(&handle);
+    return 0;
+
+fail:
+    free(latency);
+    free(samples);
+    npnt_reset_handle(&handle);
+    return 1;
+}
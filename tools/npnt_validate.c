@@ -0,0 +1,611 @@
+/*
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * npnt-validate, checks permission artefacts the way the drone loads them,
+ * for servers receiving artefacts into spool directories.
+ *
+ * The parent reads the DGCA key from dgca_pubkey.pem once and then forks
+ * the worker pool, so every worker starts with the trust store in memory.
+ * The library loads on one thread per process, each worker loads one
+ * artefact at a time on its own handle. The parent hands out paths over a
+ * pipe per worker and writes the result line each one sends back to
+ * stdout, in completion order:
+ *   {"file", "result", "error", "bytes", "load_us", "stages_us":{...},
+ *    "fence":{"vertices", "lat_min", "lat_max", "lon_min", "lon_max"},
+ *    "max_altitude", "flight_start", "flight_end", "recurring"}
+ * Fence and flight fields are only there for loaded artefacts, stages
+ * only in builds with NPNT_TRACE. A worker that dies is reported for the
+ * artefact it had and replaced.
+ *
+ * Files ending in .json go to npnt_set_permart_json, all others to
+ * npnt_set_permart_file. With -w the given directories are watched with
+ * inotify after they are read, until SIGINT or SIGTERM. The last line is
+ * the summary, with artefacts per second from the first hand out to the
+ * last result.
+ *
+ * Usage: npnt-validate [-j workers] [-w] dir|file...
+ */
+
+#include <npnt.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define VALIDATE_MAX_WORKERS    64
+#define VALIDATE_MAX_DIRS       16
+#define VALIDATE_LINE           (8 * PATH_MAX)      //result line, file name escaped
+
+typedef struct {
+    pid_t pid;
+    int task_fd;                //paths to the worker
+    int result_fd;              //result lines from the worker
+    char* task;                 //artefact the worker has, NULL if idle
+    char line[VALIDATE_LINE];   //result received so far
+    size_t len;
+} worker_s;
+
+typedef struct {
+    char** paths;
+    uint32_t head, count, max;
+} queue_s;
+
+static worker_s workers[VALIDATE_MAX_WORKERS];
+static uint32_t nworkers;
+static queue_s queue;
+static volatile sig_atomic_t stop;
+
+//Per artefact stage durations, filled by the trace callback in the worker
+static uint64_t stage_begin[NPNT_TRACE_STAGES];
+static uint64_t stage_ns[NPNT_TRACE_STAGES];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static const char* error_name(int8_t ret)
+{
+    switch (ret) {
+    case 0:
+        return "ok";
+    case NPNT_INV_ART:
+        return "invalid artefact";
+    case NPNT_INV_AUTH:
+        return "not signed by trusted key";
+    case NPNT_INV_STATE:
+        return "invalid state";
+    case NPNT_ALREADY_SET:
+        return "already set";
+    case NPNT_PARSE_FAILED:
+        return "parse failed";
+    case NPNT_INV_DGST:
+        return "digest mismatch";
+    case NPNT_INV_SIGN:
+        return "invalid signature";
+    case NPNT_BAD_FENCE:
+        return "bad fence";
+    case NPNT_INV_FPARAMS:
+        return "invalid flight parameters";
+    case NPNT_INV_BAD_ALT:
+        return "invalid altitude";
+    default:
+        return "unknown";
+    }
+}
+
+//Appends str as JSON string, returns new length
+static size_t json_string(char* out, size_t len, size_t size, const char* str)
+{
+    const char* hex = "0123456789abcdef";
+    unsigned char c;
+
+    if (len + 1 < size) {
+        out[len++] = '"';
+    }
+    for (; *str && len + 7 < size; str++) {
+        c = (unsigned char)*str;
+        if (c == '"' || c == '\\') {
+            out[len++] = '\\';
+            out[len++] = c;
+        } else if (c < 0x20) {
+            len += snprintf(&out[len], size - len, "\\u00%c%c", hex[c >> 4], hex[c & 15]);
+        } else {
+            out[len++] = c;
+        }
+    }
+    if (len + 1 < size) {
+        out[len++] = '"';
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static void on_trace(const npnt_trace_event_s* ev, void* ctx)
+{
+    (void)ctx;
+    if (ev->stage >= NPNT_TRACE_STAGES) {
+        return;
+    }
+    if (ev->begin) {
+        stage_begin[ev->stage] = ev->ts_ns;
+    } else {
+        stage_ns[ev->stage] += ev->ts_ns - stage_begin[ev->stage];
+    }
+}
+
+static int8_t load_json(npnt_s* handle, const char* path)
+{
+    uint8_t* buf = NULL;
+    struct stat st;
+    ssize_t n;
+    size_t got = 0;
+    int8_t ret = NPNT_INV_ART;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NPNT_INV_ART;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size <= 0 || (uint64_t)st.st_size >= UINT32_MAX) {
+        goto fail;
+    }
+    buf = (uint8_t*)malloc((size_t)st.st_size);
+    if (!buf) {
+        goto fail;
+    }
+    while (got < (size_t)st.st_size) {
+        n = read(fd, buf + got, (size_t)st.st_size - got);
+        if (n <= 0) {
+            goto fail;
+        }
+        got += (size_t)n;
+    }
+    ret = npnt_set_permart_json(handle, buf, (uint32_t)got);
+fail:
+    free(buf);
+    close(fd);
+    return ret;
+}
+
+//Loads one artefact on a fresh handle and writes its result line, '0' or '1' for ok first
+static size_t validate(const char* path, char* line, size_t size)
+{
+    npnt_s handle;
+    const npnt_permit_info_s* info;
+    struct stat st;
+    float lat_min, lat_max, lon_min, lon_max;
+    size_t len, plen = strlen(path);
+    uint64_t t0, t1;
+    uint32_t i;
+    int8_t ret;
+
+    memset(stage_ns, 0, sizeof(stage_ns));
+    npnt_init_handle(&handle);
+    t0 = now_ns();
+    if (plen > 5 && strcmp(path + plen - 5, ".json") == 0) {
+        ret = load_json(&handle, path);
+    } else {
+        ret = npnt_set_permart_file(&handle, path);
+    }
+    t1 = now_ns();
+
+    len = snprintf(line, size, "%c{\"file\":", ret == 0 ? '0' : '1');
+    len = json_string(line, len, size, path);
+    len += snprintf(&line[len], size - len, ",\"result\":%d,\"error\":\"%s\",\"bytes\":%lld,\"load_us\":%.1f",
+                    ret, error_name(ret), stat(path, &st) == 0 ? (long long)st.st_size : -1LL,
+                    (double)(t1 - t0) / 1e3);
+    if (stage_ns[NPNT_TRACE_LOAD]) {
+        len += snprintf(&line[len], size - len, ",\"stages_us\":{");
+        for (i = NPNT_TRACE_LOAD + 1; i < NPNT_TRACE_STAGES; i++) {
+            len += snprintf(&line[len], size - len, "%s\"%s\":%.1f", i > NPNT_TRACE_LOAD + 1 ? "," : "",
+                            npnt_trace_stage_name(i), (double)stage_ns[i] / 1e3);
+        }
+        len += snprintf(&line[len], size - len, "}");
+    }
+    info = handle.permit.info;
+    if (ret == 0 && info && info->nverts) {
+        lat_min = lat_max = info->vertlat[0];
+        lon_min = lon_max = info->vertlon[0];
+        for (i = 1; i < info->nverts; i++) {
+            lat_min = info->vertlat[i] < lat_min ? info->vertlat[i] : lat_min;
+            lat_max = info->vertlat[i] > lat_max ? info->vertlat[i] : lat_max;
+            lon_min = info->vertlon[i] < lon_min ? info->vertlon[i] : lon_min;
+            lon_max = info->vertlon[i] > lon_max ? info->vertlon[i] : lon_max;
+        }
+        len += snprintf(&line[len], size - len, ",\"fence\":{\"vertices\":%u,\"lat_min\":%.7f,\"lat_max\":%.7f,"
+                        "\"lon_min\":%.7f,\"lon_max\":%.7f},\"max_altitude\":%.1f,\"flight_start\":%lld,"
+                        "\"flight_end\":%lld,\"recurring\":%s", info->nverts, lat_min, lat_max, lon_min, lon_max,
+                        handle.permit.maxAltitude, (long long)handle.permit.flightStart,
+                        (long long)handle.permit.flightEnd, handle.permit.window_len ? "true" : "false");
+    }
+    npnt_reset_handle(&handle);
+    if (len + 3 > size) {
+        len = size - 3;
+    }
+    line[len++] = '}';
+    line[len++] = '\n';
+    line[len] = '\0';
+    return len;
+}
+
+static int write_all(int fd, const char* data, size_t len)
+{
+    ssize_t n;
+
+    while (len) {
+        n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void worker_run(int task_fd, int result_fd)
+{
+    static char line[VALIDATE_LINE];
+    char path[PATH_MAX + 2];
+    FILE* in = fdopen(task_fd, "r");
+    size_t len;
+
+    signal(SIGINT, SIG_IGN);
+    signal(SIGTERM, SIG_DFL);
+    npnt_trace_set_callback(on_trace, NULL);
+    while (in && fgets(path, sizeof(path), in)) {
+        path[strcspn(path, "\n")] = '\0';
+        len = validate(path, line, sizeof(line));
+        if (write_all(result_fd, line, len) < 0) {
+            break;
+        }
+    }
+    _exit(0);
+}
+
+static int worker_spawn(worker_s* w)
+{
+    int task[2], result[2];
+    uint32_t i;
+
+    if (pipe(task) < 0) {
+        return -1;
+    }
+    if (pipe(result) < 0) {
+        close(task[0]);
+        close(task[1]);
+        return -1;
+    }
+    fflush(stdout);
+    w->pid = fork();
+    if (w->pid < 0) {
+        close(task[0]);
+        close(task[1]);
+        close(result[0]);
+        close(result[1]);
+        return -1;
+    }
+    if (w->pid == 0) {
+        for (i = 0; i < nworkers; i++) {
+            if (&workers[i] != w && workers[i].pid > 0) {
+                close(workers[i].task_fd);
+                close(workers[i].result_fd);
+            }
+        }
+        close(task[1]);
+        close(result[0]);
+        worker_run(task[0], result[1]);
+    }
+    close(task[0]);
+    close(result[1]);
+    w->task_fd = task[1];
+    w->result_fd = result[0];
+    w->task = NULL;
+    w->len = 0;
+    return 0;
+}
+
+static void worker_stop(worker_s* w)
+{
+    close(w->task_fd);
+    close(w->result_fd);
+    waitpid(w->pid, NULL, 0);
+    w->pid = 0;
+}
+
+static int queue_push(const char* dir, const char* name)
+{
+    char** grown;
+    char* path;
+    size_t len = (dir ? strlen(dir) + 1 : 0) + strlen(name) + 1;
+
+    if (len > PATH_MAX) {
+        return -1;
+    }
+    if (queue.head == queue.count) {
+        queue.head = queue.count = 0;
+    }
+    if (queue.count == queue.max) {
+        grown = (char**)realloc(queue.paths, (queue.max * 2 + 64) * sizeof(char*));
+        if (!grown) {
+            return -1;
+        }
+        queue.paths = grown;
+        queue.max = queue.max * 2 + 64;
+    }
+    path = (char*)malloc(len);
+    if (!path) {
+        return -1;
+    }
+    if (dir) {
+        snprintf(path, len, "%s/%s", dir, name);
+    } else {
+        snprintf(path, len, "%s", name);
+    }
+    queue.paths[queue.count++] = path;
+    return 0;
+}
+
+static int scan_dir(const char* dir)
+{
+    struct dirent* ent;
+    struct stat st;
+    char path[PATH_MAX];
+    DIR* d = opendir(dir);
+
+    if (!d) {
+        return -1;
+    }
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            queue_push(dir, ent->d_name);
+        }
+    }
+    closedir(d);
+    return 0;
+}
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop = 1;
+}
+
+static void usage(const char* prog)
+{
+    printf("Usage: %s [-j workers] [-w] dir|file...\n"
+           "  -j  worker processes (online CPUs), at most %u\n"
+           "  -w  keep watching the directories for new artefacts\n"
+           "Artefacts are verified against dgca_pubkey.pem in the working directory.\n"
+           "Prints one JSON line per artefact and a summary line.\n", prog, VALIDATE_MAX_WORKERS);
+}
+
+int main(int argc, char** argv)
+{
+    const char* dirs[VALIDATE_MAX_DIRS];
+    int wds[VALIDATE_MAX_DIRS];
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd fds[VALIDATE_MAX_WORKERS + 1];
+    worker_s* polled[VALIDATE_MAX_WORKERS + 1];
+    struct sigaction sa;
+    struct stat st;
+    uint64_t done = 0, ok = 0, first = 0, last = 0;
+    uint32_t ndirs = 0, busy, nfds, i, k;
+    bool watch = false;
+    int inotify_fd = -1, opt;
+    ssize_t n;
+    char* nl;
+
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    nworkers = n < 1 ? 1 : n > VALIDATE_MAX_WORKERS ? VALIDATE_MAX_WORKERS : (uint32_t)n;
+    while ((opt = getopt(argc, argv, "j:wh")) != -1) {
+        switch (opt) {
+        case 'j':
+            nworkers = (uint32_t)atoi(optarg);
+            if (nworkers == 0 || nworkers > VALIDATE_MAX_WORKERS) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'w':
+            watch = true;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind == argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    //Trust store stays loaded in the parent and every worker forked from it
+    {
+        npnt_s handle;
+        uint8_t digest[20] = {0}, signature[1] = {0};
+        FILE* fp = fopen("dgca_pubkey.pem", "r");
+
+        if (!fp) {
+            printf("can't read dgca_pubkey.pem\n");
+            return 1;
+        }
+        fclose(fp);
+        npnt_init_handle(&handle);
+        npnt_check_authenticity(&handle, digest, sizeof(digest), signature, sizeof(signature));
+    }
+
+    if (watch) {
+        inotify_fd = inotify_init1(IN_CLOEXEC);
+        if (inotify_fd < 0) {
+            printf("inotify unavailable\n");
+            return 1;
+        }
+    }
+    for (i = optind; i < (uint32_t)argc; i++) {
+        if (stat(argv[i], &st) < 0) {
+            printf("can't read %s\n", argv[i]);
+            return 1;
+        }
+        if (!S_ISDIR(st.st_mode)) {
+            queue_push(NULL, argv[i]);
+            continue;
+        }
+        if (watch) {
+            if (ndirs == VALIDATE_MAX_DIRS) {
+                printf("at most %u directories\n", VALIDATE_MAX_DIRS);
+                return 1;
+            }
+            //watch before reading, so nothing arrives unseen in between
+            wds[ndirs] = inotify_add_watch(inotify_fd, argv[i], IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wds[ndirs] < 0) {
+                printf("can't watch %s\n", argv[i]);
+                return 1;
+            }
+            dirs[ndirs++] = argv[i];
+        }
+        scan_dir(argv[i]);
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    for (i = 0; i < nworkers; i++) {
+        if (worker_spawn(&workers[i]) < 0) {
+            printf("can't start workers\n");
+            return 1;
+        }
+    }
+
+    for (;;) {
+        busy = 0;
+        for (i = 0; i < nworkers; i++) {
+            worker_s* w = &workers[i];
+
+            if (!w->task && !stop && queue.head < queue.count) {
+                w->task = queue.paths[queue.head++];
+                if (!first) {
+                    first = now_ns();
+                }
+                //a write to a dead worker shows when its result is read
+                if (write_all(w->task_fd, w->task, strlen(w->task)) == 0) {
+                    write_all(w->task_fd, "\n", 1);
+                }
+            }
+            busy += w->task != NULL;
+        }
+        if (busy == 0 && (stop || (!watch && queue.head == queue.count))) {
+            break;
+        }
+
+        nfds = 0;
+        if (watch && !stop) {
+            fds[nfds].fd = inotify_fd;
+            fds[nfds].events = POLLIN;
+            polled[nfds++] = NULL;
+        }
+        for (i = 0; i < nworkers; i++) {
+            if (workers[i].task) {
+                fds[nfds].fd = workers[i].result_fd;
+                fds[nfds].events = POLLIN;
+                polled[nfds++] = &workers[i];
+            }
+        }
+        if (poll(fds, nfds, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (k = 0; k < nfds; k++) {
+            worker_s* w = polled[k];
+
+            if (!(fds[k].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            if (!w) {
+                n = read(inotify_fd, events, sizeof(events));
+                for (i = 0; n > 0 && i < (uint32_t)n; ) {
+                    const struct inotify_event* ev = (const struct inotify_event*)&events[i];
+                    uint32_t d;
+
+                    for (d = 0; d < ndirs; d++) {
+                        if (wds[d] == ev->wd && ev->len && ev->name[0] != '.') {
+                            queue_push(dirs[d], ev->name);
+                        }
+                    }
+                    i += sizeof(struct inotify_event) + ev->len;
+                }
+                continue;
+            }
+            n = read(w->result_fd, &w->line[w->len], sizeof(w->line) - w->len);
+            if (n <= 0) {
+                //the worker died on this artefact, report it and start another
+                printf("{\"file\":");
+                w->len = json_string(w->line, 0, sizeof(w->line), w->task);
+                printf("%s,\"result\":null,\"error\":\"worker died\"}\n", w->line);
+                done++;
+                last = now_ns();
+                free(w->task);
+                worker_stop(w);
+                if (worker_spawn(w) < 0) {
+                    printf("can't restart worker\n");
+                    return 1;
+                }
+                continue;
+            }
+            w->len += (size_t)n;
+            nl = (char*)memchr(w->line, '\n', w->len);
+            if (!nl) {
+                continue;
+            }
+            fwrite(&w->line[1], 1, (size_t)(nl - w->line), stdout);
+            fflush(stdout);
+            ok += w->line[0] == '0';
+            done++;
+            last = now_ns();
+            w->len = 0;
+            free(w->task);
+            w->task = NULL;
+        }
+    }
+
+    for (i = 0; i < nworkers; i++) {
+        worker_stop(&workers[i]);
+    }
+    for (; queue.head < queue.count; queue.head++) {
+        free(queue.paths[queue.head]);
+    }
+    free(queue.paths);
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+    }
+    printf("{\"summary\":{\"artefacts\":%llu,\"ok\":%llu,\"failed\":%llu,\"workers\":%u,\"seconds\":%.3f,"
+           "\"per_second\":%.1f}}\n", (unsigned long long)done, (unsigned long long)ok,
+           (unsigned long long)(done - ok), nworkers, first ? (double)(last - first) / 1e9 : 0.0,
+           last > first ? done * 1e9 / (double)(last - first) : 0.0);
+    return 0;
+}